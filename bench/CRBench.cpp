@@ -0,0 +1,664 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+// Headless CudaRaster benchmark, sweeping scene and pipeline parameters.
+// Every combination of the lists below is rendered 'count' times and one
+// record per configuration is written as CSV or JSON.
+//
+// Usage: CRBench <pipe.cu> [options]
+//   -tris <list>     Triangle counts (default 100000).
+//   -pattern <list>  SceneGenerator patterns: uniform, subpixel, slivers,
+//                    overdraw, nearplane, guardband (default uniform).
+//   -size <list>     Pattern size in pixels, 0 = pattern default (default 0).
+//   -res <list>      Resolutions, WxH (default 1024x768).
+//   -msaa <list>     Samples per pixel, 1/2/4/8 (default 1).
+//   -flags <list>    Render modes from d(epth), l(erp), b(lend); "-" for 
+//                    none (default d).
+//   -warps <list>    FineRaster warps per SM, 0 = pipe maximum (default 0).
+//   -n <count>       Timed draws per configuration (default 10).
+//   -capture <file>  Draw the geometry of the first draw of a RasterCapture
+//                    instead of generated triangles (ignores -tris/-pattern/-size).
+//   -pipe <name>     Pixel pipe name (default PixelPipe_passthrough).
+//   -seed <n>        Seed of the generated scenes (default 1).
+//   -u16             Use 16-bit indices (scenes must have < 65536 vertices).
+//   -vcache          Reorder triangles and vertices with MeshOptimizer and
+//                    print the ACMR before/after to stderr.
+//   -sort <curve>    Sort triangles along a morton or hilbert curve of their
+//                    screen-space centroids, after -vcache. Only applied to
+//                    order-independent configurations (d without b).
+//   -clusters <n>    Cull clusters of n triangles with MeshClusters before
+//                    the draw and print the culling stats to stderr. 
+//                    Generated scenes only (identity posToClip).
+//   -draws <n>       Submit each scene as a batch of n draw ranges with
+//                    drawTriangles(ranges), 0 = a single draw (default 0).
+//   -chunk <n>       Split draws into chunks of at most n triangles with
+//                    setMaxChunkTris(), 0 = only when needed (default 0).
+//   -json            Write JSON instead of CSV.
+//   -o <file>        Output file (default stdout).
+//   -I <dir>         Additional include directory for the pipe (repeatable).
+//
+// Lists are comma separated, e.g. "-msaa 1,4 -flags -,d,dlb".
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/Timer.hpp"
+#include "gpu/CudaCompiler.hpp"
+#include "cudaraster/CudaRaster.hpp"
+#include "cudaraster/RasterCapture.hpp"
+#include "cudaraster/MeshClusters.hpp"
+#include "cudaraster/MeshOptimizer.hpp"
+#include "cudaraster/SceneGenerator.hpp"
+#include "PipeUtils.hpp"
+
+using namespace FW;
+
+
+namespace {
+
+struct Options
+{
+  std::string               pipeFile;
+  std::string               pipeName;
+  std::string               captureFile;
+  std::string               outFile;
+  std::vector<std::string>  includes;
+
+  std::vector<int>          numTris;
+  std::vector<SceneGenerator::Pattern> patterns;
+  std::vector<F32>          triSizes;
+  std::vector<Vec2i>        resolutions;
+  std::vector<int>          numSamples;
+  std::vector<std::string>  flags;
+  std::vector<int>          fineWarps;
+
+  int                       numIterations;
+  U32                       seed;
+  bool                      index16;
+  bool                      vcache;
+  MeshOptimizer::Curve      sortCurve;    // Curve_Max = off.
+  int                       clusterSize;  // 0 = off.
+  int                       numDraws;     // 0 = single draw.
+  int                       maxChunkTris; // 0 = no limit.
+  bool                      json;
+
+  Options(void) 
+    : pipeName("PixelPipe_passthrough"), numIterations(10), seed(1), index16(false), vcache(false),
+      sortCurve(MeshOptimizer::Curve_Max), clusterSize(0), numDraws(0), maxChunkTris(0), json(false) 
+  {}
+};
+
+struct Scene
+{
+  std::vector<U8>   vertices;   // Shaded vertices, clip space.
+  std::vector<U8>   indices;    // Vec3i per triangle, or 3 * U16 (indexFormat).
+  S32               indexFormat;
+  S32               numTris;
+  std::string       pattern;    // "capture" for captured geometry.
+  F32               size;
+  F64               numFragments;   // Estimated from the covered area.
+};
+
+struct Result
+{
+  F64 setupTime, binTime, coarseTime, fineTime, wallTime;
+};
+
+//------------------------------------------------------------------------
+
+void printUsage(void)
+{
+  printf( "Usage: CRBench <pipe.cu> [-tris list] [-pattern list] [-size list] [-res list] "
+          "[-msaa list] [-flags list] [-warps list] [-n count] "
+          "[-capture file] [-pipe name] [-seed n] [-u16] [-vcache] [-sort curve] [-clusters n] [-draws n] [-chunk n] [-json] [-o file] [-I dir]...\n");
+}
+
+std::vector<std::string> splitList(const std::string& s)
+{
+  std::vector<std::string> res;
+  size_t pos = 0u;
+
+  for (;;)
+  {
+    size_t end = s.find(',', pos);
+    res.push_back(s.substr(pos, end - pos));
+    if (end == std::string::npos) {
+      break;
+    }
+    pos = end + 1;
+  }
+  return res;
+}
+
+bool parseIntList(const std::string& s, std::vector<int>& out, int minValue)
+{
+  std::vector<std::string> items = splitList(s);
+  out.clear();
+
+  for (size_t i = 0u; i < items.size(); ++i)
+  {
+    char* end;
+    long v = strtol(items[i].c_str(), &end, 10);
+    if (items[i].empty() || *end != '\0' || v < minValue) {
+      return false;
+    }
+    out.push_back((int)v);
+  }
+  return true;
+}
+
+bool parseFloatList(const std::string& s, std::vector<F32>& out, F32 minValue)
+{
+  std::vector<std::string> items = splitList(s);
+  out.clear();
+
+  for (size_t i = 0u; i < items.size(); ++i)
+  {
+    char* end;
+    F32 v = (F32)strtod(items[i].c_str(), &end);
+    if (items[i].empty() || *end != '\0' || v < minValue) {
+      return false;
+    }
+    out.push_back(v);
+  }
+  return true;
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+  std::vector<std::string> positional;
+  bool ok = true;
+
+  for (int i = 1; i < argc && ok; ++i)
+  {
+    std::string arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+
+    if (arg == "-tris" && hasValue) {
+      ok = parseIntList(argv[++i], opt.numTris, 1);
+    } else if (arg == "-size" && hasValue) {
+      ok = parseFloatList(argv[++i], opt.triSizes, 0.0f);
+    } else if (arg == "-pattern" && hasValue) {
+      std::vector<std::string> items = splitList(argv[++i]);
+      opt.patterns.clear();
+      for (size_t j = 0u; j < items.size() && ok; ++j)
+      {
+        opt.patterns.push_back(SceneGenerator::findPattern(items[j].c_str()));
+        ok = (opt.patterns.back() != SceneGenerator::Pattern_Max);
+      }
+    } else if (arg == "-msaa" && hasValue) {
+      ok = parseIntList(argv[++i], opt.numSamples, 1);
+    } else if (arg == "-warps" && hasValue) {
+      ok = parseIntList(argv[++i], opt.fineWarps, 0);
+    } else if (arg == "-res" && hasValue) {
+      std::vector<std::string> items = splitList(argv[++i]);
+      opt.resolutions.clear();
+      for (size_t j = 0u; j < items.size() && ok; ++j)
+      {
+        Vec2i r;
+        ok = (sscanf(items[j].c_str(), "%dx%d", &r.x, &r.y) == 2 && min(r) > 0);
+        opt.resolutions.push_back(r);
+      }
+    } else if (arg == "-flags" && hasValue) {
+      opt.flags = splitList(argv[++i]);
+      for (size_t j = 0u; j < opt.flags.size() && ok; ++j) {
+        ok = (opt.flags[j].find_first_not_of("-dlb") == std::string::npos);
+      }
+    } else if (arg == "-n" && hasValue) {
+      opt.numIterations = atoi(argv[++i]);
+    } else if (arg == "-capture" && hasValue) {
+      opt.captureFile = argv[++i];
+    } else if (arg == "-pipe" && hasValue) {
+      opt.pipeName = argv[++i];
+    } else if (arg == "-seed" && hasValue) {
+      opt.seed = (U32)strtoul(argv[++i], NULL, 10);
+    } else if (arg == "-u16") {
+      opt.index16 = true;
+    } else if (arg == "-vcache") {
+      opt.vcache = true;
+    } else if (arg == "-sort" && hasValue) {
+      opt.sortCurve = MeshOptimizer::findCurve(argv[++i]);
+      ok = (opt.sortCurve != MeshOptimizer::Curve_Max);
+    } else if (arg == "-clusters" && hasValue) {
+      opt.clusterSize = atoi(argv[++i]);
+      ok = (opt.clusterSize > 0);
+    } else if (arg == "-draws" && hasValue) {
+      opt.numDraws = atoi(argv[++i]);
+      ok = (opt.numDraws >= 0);
+    } else if (arg == "-chunk" && hasValue) {
+      opt.maxChunkTris = atoi(argv[++i]);
+      ok = (opt.maxChunkTris >= 0);
+    } else if (arg == "-json") {
+      opt.json = true;
+    } else if (arg == "-o" && hasValue) {
+      opt.outFile = argv[++i];
+    } else if (arg == "-I" && hasValue) {
+      opt.includes.push_back(argv[++i]);
+    } else if (arg[0] == '-') {
+      ok = false;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+
+  if (!ok || positional.size() != 1 || opt.numIterations <= 0) {
+    return false;
+  }
+  opt.pipeFile = positional[0];
+
+  // Defaults.
+  if (opt.numTris.empty())      opt.numTris.push_back(100000);
+  if (opt.patterns.empty())     opt.patterns.push_back(SceneGenerator::Pattern_Uniform);
+  if (opt.triSizes.empty())     opt.triSizes.push_back(0.0f);
+  if (opt.resolutions.empty())  opt.resolutions.push_back(Vec2i(1024, 768));
+  if (opt.numSamples.empty())   opt.numSamples.push_back(1);
+  if (opt.flags.empty())        opt.flags.push_back("d");
+  if (opt.fineWarps.empty())    opt.fineWarps.push_back(0);
+
+  // A capture brings its own geometry.
+  if (!opt.captureFile.empty())
+  {
+    opt.numTris.resize(1);
+    opt.patterns.resize(1);
+    opt.triSizes.resize(1);
+  }
+  return true;
+}
+
+U32 getRenderModeFlags(const std::string& flags)
+{
+  U32 res = 0;
+  if (flags.find('d') != std::string::npos) res |= RenderModeFlag_EnableDepth;
+  if (flags.find('l') != std::string::npos) res |= RenderModeFlag_EnableLerp;
+  return res;
+}
+
+//------------------------------------------------------------------------
+
+void generateScene( Scene& scene, SceneGenerator& generator, 
+                    const SceneGenerator::Params& params, int vertexStructSize)
+{
+  generator.generate(params);
+
+  scene.numTris      = generator.getNumTris();
+  scene.indexFormat  = IndexFormat_U32;
+  scene.pattern      = SceneGenerator::getPatternName(params.pattern);
+  scene.size         = generator.getParams().size;
+  scene.numFragments = generator.getCoveredArea();
+
+  scene.vertices.resize((size_t)generator.getNumVertices() * vertexStructSize);
+  scene.indices.resize((size_t)scene.numTris * sizeof(Vec3i));
+  generator.writeShadedVertices(&scene.vertices[0], vertexStructSize);
+  generator.writeIndices(&scene.indices[0]);
+}
+
+// Geometry of the first draw of a capture. The fragment count is estimated
+// from the clip-space area of the triangles in front of the camera.
+void loadScene(Scene& scene, const RasterCapture& capture, const Vec2i& viewport)
+{
+  if (capture.getNumDraws() == 0) {
+    fail("CRBench: Empty capture!");
+  }
+
+  const RasterCapture::Draw& d = capture.getDraw(0);
+  scene.vertices = capture.getBlob(d.vertexBlob);
+  scene.indices  = capture.getBlob(d.indexBlob);
+  scene.numTris  = d.numTris;
+
+  // Widen 16-bit captures, -u16 packs them again.
+  scene.indexFormat = IndexFormat_U32;
+  if (d.indexFormat == IndexFormat_U16 && d.numTris > 0)
+  {
+    std::vector<U8> wide((size_t)d.numTris * sizeof(Vec3i));
+    const U16* src = (const U16*)&scene.indices[0];
+    for (int i = 0; i < d.numTris * 3; ++i) {
+      ((S32*)&wide[0])[i] = src[i];
+    }
+    scene.indices.swap(wide);
+  }
+  scene.pattern  = "capture";
+  scene.size     = 0.0f;
+
+  F64 area = 0.0;
+  for (int i = 0; i < d.numTris; ++i)
+  {
+    const Vec3i& idx = ((const Vec3i*)&scene.indices[0])[i];
+    Vec2f p[3];
+    bool  visible = true;
+
+    for (int j = 0; j < 3; ++j)
+    {
+      const Vec4f& c = *(const Vec4f*)&scene.vertices[(size_t)idx[j] * d.pipeSpec.vertexStructSize];
+      visible = visible && (c.w > 0.0f);
+      p[j] = Vec2f(c.x, c.y) / max(c.w, 1.0e-6f) * 0.5f * Vec2f(viewport);
+    }
+
+    if (visible) {
+      area += fabs((F64)((p[1].x - p[0].x) * (p[2].y - p[0].y) - 
+                         (p[2].x - p[0].x) * (p[1].y - p[0].y))) * 0.5;
+    }
+  }
+
+  scene.numFragments = area;
+}
+
+void packIndices16(Scene& scene)
+{
+  std::vector<U8> packed((size_t)scene.numTris * 3 * sizeof(U16));
+  const S32* src = (const S32*)&scene.indices[0];
+
+  for (int i = 0; i < scene.numTris * 3; ++i)
+  {
+    if (src[i] < 0 || src[i] > 0xFFFF) {
+      fail("CRBench: -u16 with vertex index %d!", src[i]);
+    }
+    ((U16*)&packed[0])[i] = (U16)src[i];
+  }
+
+  scene.indices.swap(packed);
+  scene.indexFormat = IndexFormat_U16;
+}
+
+// Consecutive ranges of the scene indices, sharing both buffers.
+void splitDraws(std::vector<CudaRaster::DrawRange>& ranges, const Scene& scene, int numDraws, 
+                Buffer* vertices, Buffer* indices)
+{
+  S64 triBytes = (scene.indexFormat == IndexFormat_U16) ? 3 * sizeof(U16) : sizeof(Vec3i);
+  ranges.resize(numDraws);
+
+  for (int i = 0; i < numDraws; ++i)
+  {
+    S32 first = (S32)((S64)scene.numTris * i / numDraws);
+    S32 end   = (S32)((S64)scene.numTris * (i + 1) / numDraws);
+
+    CudaRaster::DrawRange& r = ranges[i];
+    r.vertexBuffer = vertices;
+    r.indexBuffer  = indices;
+    r.indexOfs     = first * triBytes;
+    r.numTris      = end - first;
+    r.indexFormat  = scene.indexFormat;
+  }
+}
+
+void draw(CudaRaster& raster, const std::vector<CudaRaster::DrawRange>& ranges)
+{
+  if (ranges.empty()) {
+    raster.drawTriangles();
+  } else {
+    raster.drawTriangles(&ranges[0], (int)ranges.size());
+  }
+}
+
+//------------------------------------------------------------------------
+
+class Writer
+{
+  private:
+    FILE* m_file;
+    bool  m_json;
+    int   m_numRecords;
+
+  public:
+    Writer(FILE* file, bool json) : m_file(file), m_json(json), m_numRecords(0)
+    {
+      if (m_json) {
+        fprintf(m_file, "[\n");
+      } else {
+        fprintf( m_file, "tris,pattern,size,width,height,samples,flags,fine_warps,"
+                         "setup_ms,bin_ms,coarse_ms,fine_ms,total_ms,wall_ms,"
+                         "mtris_per_s,mfrags_per_s\n");
+      }
+    }
+
+    ~Writer(void)
+    {
+      if (m_json) {
+        fprintf(m_file, "\n]\n");
+      }
+      fflush(m_file);
+    }
+
+    void write( const Scene& scene, const Vec2i& res, int samples, 
+                const std::string& flags, int fineWarps, const Result& r)
+    {
+      F64 total = r.setupTime + r.binTime + r.coarseTime + r.fineTime;
+      F64 mtris  = (F64)scene.numTris / max(total, 1.0e-9) * 1.0e-6;
+      F64 mfrags = scene.numFragments / max(total, 1.0e-9) * 1.0e-6;
+
+      if (m_json)
+      {
+        fprintf( m_file, 
+                 "%s  { \"tris\": %d, \"pattern\": \"%s\", \"size\": %g, \"width\": %d, \"height\": %d, "
+                 "\"samples\": %d, \"flags\": \"%s\", \"fine_warps\": %d, "
+                 "\"setup_ms\": %.4f, \"bin_ms\": %.4f, \"coarse_ms\": %.4f, "
+                 "\"fine_ms\": %.4f, \"total_ms\": %.4f, \"wall_ms\": %.4f, "
+                 "\"mtris_per_s\": %.3f, \"mfrags_per_s\": %.3f }",
+                 (m_numRecords) ? ",\n" : "",
+                 scene.numTris, scene.pattern.c_str(), scene.size, res.x, res.y, samples, flags.c_str(), fineWarps,
+                 r.setupTime * 1.0e3, r.binTime * 1.0e3, r.coarseTime * 1.0e3,
+                 r.fineTime * 1.0e3, total * 1.0e3, r.wallTime * 1.0e3, mtris, mfrags);
+      }
+      else
+      {
+        fprintf( m_file, 
+                 "%d,%s,%g,%d,%d,%d,%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%.3f\n",
+                 scene.numTris, scene.pattern.c_str(), scene.size, res.x, res.y, samples, flags.c_str(), fineWarps,
+                 r.setupTime * 1.0e3, r.binTime * 1.0e3, r.coarseTime * 1.0e3,
+                 r.fineTime * 1.0e3, total * 1.0e3, r.wallTime * 1.0e3, mtris, mfrags);
+      }
+
+      fflush(m_file);
+      m_numRecords++;
+    }
+};
+
+//------------------------------------------------------------------------
+
+void runSweeps(const Options& opt, const RasterCapture& capture, FILE* out)
+{
+  CudaCompiler compiler;
+  initPipeCompiler(compiler, opt.pipeFile, opt.includes);
+
+  CudaRaster raster;
+  raster.init();
+  raster.setMaxChunkTris(opt.maxChunkTris);
+
+  Buffer vertices;
+  Buffer indices;
+  Scene  scene;
+  SceneGenerator generator;
+
+  Writer writer(out, opt.json);
+
+  for (size_t iRes = 0u; iRes < opt.resolutions.size(); ++iRes)
+  for (size_t iMsaa = 0u; iMsaa < opt.numSamples.size(); ++iMsaa)
+  {
+    const Vec2i& res     = opt.resolutions[iRes];
+    int          samples = opt.numSamples[iMsaa];
+
+    CudaSurface colorBuffer(res, CudaSurface::FORMAT_RGBA8, samples);
+    CudaSurface depthBuffer(res, CudaSurface::FORMAT_DEPTH32, samples);
+    raster.setSurfaces(&colorBuffer, &depthBuffer);
+
+    for (size_t iFlags = 0u; iFlags < opt.flags.size(); ++iFlags)
+    {
+      const std::string& flags = opt.flags[iFlags];
+
+      PixelPipeSpec spec;
+      memset(&spec, 0, sizeof(spec));
+      spec.samplesLog2     = colorBuffer.getSamplesLog2();
+      spec.renderModeFlags = getRenderModeFlags(flags);
+      spec.profilingMode   = ProfilingMode_Default;
+      strcpy(spec.blendShaderName, (flags.find('b') != std::string::npos) ? "BlendSrcOver" : "BlendReplace");
+
+      CudaModule* module = compilePixelPipe(compiler, spec);
+
+      for (size_t iWarps = 0u; iWarps < opt.fineWarps.size(); ++iWarps)
+      {
+        raster.setMaxFineWarps(opt.fineWarps[iWarps]);
+        raster.setPixelPipe(module, opt.pipeName);
+
+        int vertexStructSize = raster.getPipeSpec().vertexStructSize;
+
+        for (size_t iTris = 0u; iTris < opt.numTris.size(); ++iTris)
+        for (size_t iPattern = 0u; iPattern < opt.patterns.size(); ++iPattern)
+        for (size_t iSize = 0u; iSize < opt.triSizes.size(); ++iSize)
+        {
+          if (capture.getNumDraws()) 
+          {
+            loadScene(scene, capture, res);
+            if (capture.getDraw(0).pipeSpec.vertexStructSize != vertexStructSize) {
+              fail("CRBench: Captured vertices do not match '%s'!", opt.pipeName.c_str());
+            }
+          } 
+          else 
+          {
+            SceneGenerator::Params params;
+            params.pattern  = opt.patterns[iPattern];
+            params.numTris  = opt.numTris[iTris];
+            params.size     = opt.triSizes[iSize];
+            params.viewport = res;
+            params.seed     = opt.seed;
+            generateScene(scene, generator, params, vertexStructSize);
+          }
+
+          if (opt.vcache && scene.numTris > 0)
+          {
+            MeshOptimizer::Report report = MeshOptimizer::optimize(
+              (Vec3i*)&scene.indices[0], scene.numTris, &scene.vertices[0], 
+              (int)(scene.vertices.size() / vertexStructSize), vertexStructSize);
+            fprintf(stderr, "CRBench: %s\n", report.toString().c_str());
+          }
+
+          if (opt.sortCurve != MeshOptimizer::Curve_Max && scene.numTris > 0 && 
+              MeshOptimizer::canReorder(raster.getPipeSpec()))
+          {
+            MeshOptimizer::sortSpatially(
+              (Vec3i*)&scene.indices[0], scene.numTris, &scene.vertices[0], 
+              (int)(scene.vertices.size() / vertexStructSize), vertexStructSize, true, opt.sortCurve);
+          }
+
+          if (opt.clusterSize > 0 && scene.numTris > 0 && !capture.getNumDraws())
+          {
+            MeshClusters clusters;
+            std::vector<Vec3i> visible;
+            clusters.build( (const Vec3i*)&scene.indices[0], scene.numTris, &scene.vertices[0], 
+                            (int)(scene.vertices.size() / vertexStructSize), vertexStructSize, opt.clusterSize);
+            MeshClusters::Stats stats = clusters.cull(visible, Mat4f());
+            fprintf(stderr, "CRBench: %s\n", stats.toString().c_str());
+
+            scene.numTris = (S32)visible.size();
+            scene.indices.resize(visible.size() * sizeof(Vec3i));
+            if (!visible.empty()) {
+              memcpy(&scene.indices[0], &visible[0], scene.indices.size());
+            }
+          }
+
+          if (opt.index16 && scene.indexFormat != IndexFormat_U16 && scene.numTris > 0) {
+            packIndices16(scene);
+          }
+
+          vertices.set(&scene.vertices[0], (S64)scene.vertices.size());
+          // Culling may leave no triangles at all.
+          indices.set((scene.indices.empty()) ? NULL : &scene.indices[0], (S64)scene.indices.size());
+          raster.setVertexBuffer(&vertices, 0);
+          raster.setIndexBuffer(&indices, 0, scene.numTris, scene.indexFormat);
+
+          std::vector<CudaRaster::DrawRange> ranges;
+          splitDraws(ranges, scene, opt.numDraws, &vertices, &indices);
+
+          // Warm up (buffer growth, caches), then time.
+          raster.deferredClear();
+          draw(raster, ranges);
+          raster.getStats();
+
+          Result r;
+          memset(&r, 0, sizeof(r));
+          Timer timer;
+
+          for (int iter = 0; iter < opt.numIterations; ++iter)
+          {
+            timer.start();
+            raster.deferredClear();
+            draw(raster, ranges);
+            CudaRaster::Stats stats = raster.getStats();
+            r.wallTime += timer.end();
+
+            r.setupTime  += stats.setupTime;
+            r.binTime    += stats.binTime;
+            r.coarseTime += stats.coarseTime;
+            r.fineTime   += stats.fineTime;
+          }
+
+          F64 scale = 1.0 / opt.numIterations;
+          r.setupTime  *= scale;
+          r.binTime    *= scale;
+          r.coarseTime *= scale;
+          r.fineTime   *= scale;
+          r.wallTime   *= scale;
+
+          writer.write(scene, res, samples, flags, raster.getNumFineWarps(), r);
+        }
+      }
+    }
+
+    raster.setSurfaces(NULL, NULL);
+  }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  if (!parseOptions(argc, argv, opt))
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  CudaModule::setGLInterop(false);
+
+  RasterCapture capture;
+  if (!opt.captureFile.empty()) {
+    capture.load(opt.captureFile);
+  }
+
+  FILE* out = stdout;
+  if (!opt.outFile.empty() && (out = fopen(opt.outFile.c_str(), "w")) == NULL) {
+    fail("CRBench: Cannot open '%s'!", opt.outFile.c_str());
+  }
+
+  runSweeps(opt, capture, out);
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  return EXIT_SUCCESS;
+}
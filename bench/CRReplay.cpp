@@ -0,0 +1,383 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+// Replays a RasterCapture file without a window, see CudaRaster::setCapture().
+//
+// Usage: CRReplay <capture> <pipe.cu> [options]
+//   -n <count>       Number of times the whole capture is replayed (default 10).
+//   -e <stages>      Emulate stages on the host, any of "s", "b", "c", "f".
+//   -c               Read hardware counters around the emulated stages.
+//   -p <mode>        Override the profiling mode: default, counters, timers.
+//   -I <dir>         Additional include directory for the pipe (repeatable).
+//   -s <stage> <out> Save a RasterSnapshot taken before setup, bin, coarse 
+//                    or fine during the first replay, see CRStageBench.
+//   -d <draw>        Draw to snapshot (default 0).
+//   -j <file>        Write the profile of the last draw as JSON.
+//   -t <file>        Write a Chrome trace-event JSON of the timed replays.
+//   -m <prefix>      Write per-tile heatmaps of the last draw as 
+//                    <prefix>.<channel>.pfm / .ppm, see RasterHeatmap.
+//
+// The pipe source must define the pipes named in the capture; each distinct
+// PixelPipeSpec is compiled once with the defines used by the test app.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/Timer.hpp"
+#include "gpu/CudaCompiler.hpp"
+#include "cudaraster/CudaRaster.hpp"
+#include "cudaraster/RasterCapture.hpp"
+#include "cudaraster/RasterHeatmap.hpp"
+#include "cudaraster/RasterHistory.hpp"
+#include "cudaraster/RasterProfile.hpp"
+#include "cudaraster/RasterSnapshot.hpp"
+#include "cudaraster/RasterTrace.hpp"
+#include "PipeUtils.hpp"
+
+using namespace FW;
+
+
+namespace {
+
+struct Options
+{
+  std::string               captureFile;
+  std::string               pipeFile;
+  std::vector<std::string>  includes;
+  int                       numIterations;
+  int                       profilingMode;  // -1 : as captured.
+  CudaRaster::DebugParams   debug;
+  int                       snapshotStage;  // -1 : none.
+  int                       snapshotDraw;
+  std::string               snapshotFile;
+  std::string               profileFile;
+  std::string               traceFile;
+  std::string               heatmapPrefix;
+  bool                      perfCounters;
+
+  Options(void) 
+    : numIterations(10), profilingMode(-1), snapshotStage(-1), snapshotDraw(0),
+      perfCounters(false)
+  {}
+};
+
+struct Pipe
+{
+  PixelPipeSpec spec;
+  std::string   name;
+  CudaModule*   module;
+};
+
+struct DrawTimes
+{
+  F64 setup, bin, coarse, fine, wall;
+  DrawTimes(void) : setup(0.0), bin(0.0), coarse(0.0), fine(0.0), wall(0.0) {}
+};
+
+void printUsage(void)
+{
+  printf( "Usage: CRReplay <capture> <pipe.cu> [-n count] [-e sbcf] [-c] "
+          "[-p default|counters|timers] [-I dir]... [-s stage file [-d draw]] "
+          "[-j file] [-t file] [-m prefix]\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+  std::vector<std::string> positional;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+
+    if (arg == "-n" && hasValue) {
+      opt.numIterations = atoi(argv[++i]);
+    } else if (arg == "-I" && hasValue) {
+      opt.includes.push_back(argv[++i]);
+    } else if (arg == "-e" && hasValue) {
+      const char* s = argv[++i];
+      opt.debug.emulateTriangleSetup = (strchr(s, 's') != NULL);
+      opt.debug.emulateBinRaster     = (strchr(s, 'b') != NULL);
+      opt.debug.emulateCoarseRaster  = (strchr(s, 'c') != NULL);
+      opt.debug.emulateFineRaster    = (strchr(s, 'f') != NULL);
+    } else if (arg == "-c") {
+      opt.perfCounters = true;
+    } else if (arg == "-p" && hasValue) {
+      std::string mode = argv[++i];
+      if      (mode == "default")  opt.profilingMode = ProfilingMode_Default;
+      else if (mode == "counters") opt.profilingMode = ProfilingMode_Counters;
+      else if (mode == "timers")   opt.profilingMode = ProfilingMode_Timers;
+      else return false;
+    } else if (arg == "-s" && i + 2 < argc) {
+      std::string stage = argv[++i];
+      opt.snapshotFile  = argv[++i];
+      for (int j = 0; j < CudaRaster::Stage_Max; ++j) {
+        if (stage == RasterSnapshot::getStageName((CudaRaster::Stage)j)) {
+          opt.snapshotStage = j;
+        }
+      }
+      if (opt.snapshotStage < 0) return false;
+    } else if (arg == "-d" && hasValue) {
+      opt.snapshotDraw = atoi(argv[++i]);
+    } else if (arg == "-j" && hasValue) {
+      opt.profileFile = argv[++i];
+    } else if (arg == "-t" && hasValue) {
+      opt.traceFile = argv[++i];
+    } else if (arg == "-m" && hasValue) {
+      opt.heatmapPrefix = argv[++i];
+    } else if (arg[0] == '-') {
+      return false;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+
+  if (positional.size() != 2 || opt.numIterations <= 0) {
+    return false;
+  }
+
+  opt.captureFile = positional[0];
+  opt.pipeFile    = positional[1];
+  return true;
+}
+
+// Returns the compiled pipe matching the draw, compiling it on first use.
+const Pipe& getPipe(std::vector<Pipe>& pipes, CudaCompiler& compiler, 
+                    const RasterCapture::Draw& d, const Options& opt)
+{
+  PixelPipeSpec spec = d.pipeSpec;
+  if (opt.profilingMode >= 0) {
+    spec.profilingMode = opt.profilingMode;
+  }
+
+  for (size_t i = 0; i < pipes.size(); ++i) {
+    if (pipes[i].name == d.pipeName && isSamePipeSpec(pipes[i].spec, spec)) {
+      return pipes[i];
+    }
+  }
+
+  Pipe p;
+  p.spec   = spec;
+  p.name   = d.pipeName;
+  p.module = compilePixelPipe(compiler, spec);
+
+  pipes.push_back(p);
+  return pipes.back();
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  if (!parseOptions(argc, argv, opt))
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  // No window: plain CUDA context and CUDA-array surfaces.
+  CudaModule::setGLInterop(false);
+
+  RasterCapture capture;
+  capture.load(opt.captureFile);
+
+  int numDraws = capture.getNumDraws();
+  printf( "CRReplay: %d draws, %d unique buffers, %.2f MB\n", 
+          numDraws, capture.getNumBlobs(), 
+          (F64)capture.getTotalBytes() * (1.0 / (1 << 20)));
+
+  if (numDraws == 0) {
+    return EXIT_SUCCESS;
+  }
+
+  if (opt.snapshotStage >= 0 && (opt.snapshotDraw < 0 || opt.snapshotDraw >= numDraws)) {
+    fail("CRReplay: Draw %d out of range!", opt.snapshotDraw);
+  }
+
+  CudaCompiler compiler;
+  initPipeCompiler(compiler, opt.pipeFile, opt.includes);
+
+  CudaRaster raster;
+  raster.init();
+  raster.setDebugParams(opt.debug);
+  raster.setHistorySize(numDraws * max(opt.numIterations, 1));
+
+  if (opt.perfCounters && !raster.setPerfCounters(true)) {
+    printf("CRReplay: Hardware counters unavailable (see /proc/sys/kernel/perf_event_paranoid)\n");
+  }
+
+  std::vector<Pipe>       pipes;
+  std::vector<DrawTimes>  times(numDraws);
+  CudaSurface*            colorBuffer = NULL;
+  CudaSurface*            depthBuffer = NULL;
+  Buffer                  vertices;
+  Buffer                  indices;
+  Timer                   timer;
+  int                     lastProfilingMode = ProfilingMode_Default;
+  RasterTrace             trace;
+  RasterHeatmap           heatmap;
+
+  // Iteration 0 compiles pipes and warms up caches, it is not timed.
+  for (int iter = 0; iter <= opt.numIterations; ++iter)
+  {
+    if (iter == 1) {
+      raster.resetHistory();
+    }
+    if (iter == 1 && !opt.traceFile.empty()) {
+      raster.setTrace(&trace);
+    }
+    // Heatmaps are taken during the untimed iteration.
+    raster.setHeatmap((iter == 0 && !opt.heatmapPrefix.empty()) ? &heatmap : NULL);
+
+    for (int i = 0; i < numDraws; ++i)
+    {
+      const RasterCapture::Draw& d = capture.getDraw(i);
+      
+      if (!colorBuffer || colorBuffer->getSize() != d.viewportSize ||
+          colorBuffer->getNumSamples() != d.numSamples)
+      {
+        delete colorBuffer;
+        delete depthBuffer;
+        colorBuffer = new CudaSurface(d.viewportSize, CudaSurface::FORMAT_RGBA8,   d.numSamples);
+        depthBuffer = new CudaSurface(d.viewportSize, CudaSurface::FORMAT_DEPTH32, d.numSamples);
+      }
+
+      const Pipe& pipe = getPipe(pipes, compiler, d, opt);
+      raster.setSurfaces(colorBuffer, depthBuffer);
+      raster.setPixelPipe(pipe.module, pipe.name);
+      capture.apply(i, raster, vertices, indices);
+      lastProfilingMode = pipe.spec.profilingMode;
+
+      RasterSnapshot snapshot((CudaRaster::Stage)max(opt.snapshotStage, 0));
+      if (iter == 0 && i == opt.snapshotDraw && opt.snapshotStage >= 0) {
+        raster.setSnapshot(&snapshot);
+      }
+
+      timer.start();
+      raster.drawTriangles();
+      CudaRaster::Stats stats = raster.getStats();
+      F64 wall = timer.end();
+
+      if (iter == 0) 
+      {
+        if (snapshot.isValid())
+        {
+          snapshot.save(opt.snapshotFile);
+          printf( "CRReplay: Saved %s snapshot of draw %d to '%s' (%.2f MB)\n", 
+                  RasterSnapshot::getStageName(snapshot.getStage()), i, 
+                  opt.snapshotFile.c_str(), 
+                  (F64)snapshot.getTotalBytes() * (1.0 / (1 << 20)));
+        }
+        continue;
+      }
+
+      DrawTimes& t = times[i];
+      t.setup  += stats.setupTime;
+      t.bin    += stats.binTime;
+      t.coarse += stats.coarseTime;
+      t.fine   += stats.fineTime;
+      t.wall   += wall;
+    }
+  }
+
+  // Report averages in milliseconds.
+  F64 scale = 1.0e3 / opt.numIterations;
+  DrawTimes total;
+
+  printf("\n%6s %8s %10s %10s %10s %10s %10s\n", 
+         "draw", "tris", "setup", "bin", "coarse", "fine", "wall");
+
+  for (int i = 0; i < numDraws; ++i)
+  {
+    const DrawTimes& t = times[i];
+    printf( "%6d %8d %10.3f %10.3f %10.3f %10.3f %10.3f\n", 
+            i, capture.getDraw(i).numTris, 
+            t.setup * scale, t.bin * scale, t.coarse * scale, 
+            t.fine * scale, t.wall * scale);
+
+    total.setup  += t.setup;
+    total.bin    += t.bin;
+    total.coarse += t.coarse;
+    total.fine   += t.fine;
+    total.wall   += t.wall;
+  }
+
+  printf( "%6s %8s %10.3f %10.3f %10.3f %10.3f %10.3f\n", "total", "", 
+          total.setup * scale, total.bin * scale, total.coarse * scale, 
+          total.fine * scale, total.wall * scale);
+
+  printf("\nPer-draw distribution:\n%s", raster.getHistory()->toString().c_str());
+
+  RasterProfile profile = raster.getProfile();
+  if (lastProfilingMode != ProfilingMode_Default || !profile.perf.empty()) {
+    printf("\nLast draw:\n%s\n", profile.toString().c_str());
+  }
+
+  if (!opt.profileFile.empty())
+  {
+    FILE* file = fopen(opt.profileFile.c_str(), "w");
+    if (!file) {
+      fail("CRReplay: Cannot open '%s'!", opt.profileFile.c_str());
+    }
+    fputs(profile.toJSON().c_str(), file);
+    fclose(file);
+  }
+
+  if (!opt.traceFile.empty())
+  {
+    raster.setTrace(NULL);
+    trace.save(opt.traceFile);
+    printf( "CRReplay: Saved trace to '%s' (%lld events dropped)\n", 
+            opt.traceFile.c_str(), (long long)trace.getNumDropped());
+  }
+
+  if (!opt.heatmapPrefix.empty())
+  {
+    printf("\nLast draw, per tile (%d x %d):\n", heatmap.getSizeTiles().x, heatmap.getSizeTiles().y);
+
+    for (int i = 0; i < RasterHeatmap::Channel_Max; ++i)
+    {
+      RasterHeatmap::Channel c = (RasterHeatmap::Channel)i;
+      if (c == RasterHeatmap::Channel_FineTime && !heatmap.hasFineTime()) {
+        continue;
+      }
+
+      std::string name = opt.heatmapPrefix + "." + RasterHeatmap::getChannelName(c);
+      heatmap.savePFM(name + ".pfm", c);
+      heatmap.savePPM(name + ".ppm", c);
+      printf( "%10s  max %12.6g  mean %12.6g  -> %s.pfm/.ppm\n", 
+              RasterHeatmap::getChannelName(c), heatmap.getMax(c), heatmap.getMean(c), 
+              name.c_str());
+    }
+  }
+
+  delete colorBuffer;
+  delete depthBuffer;
+  return EXIT_SUCCESS;
+}
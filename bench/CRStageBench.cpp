@@ -0,0 +1,187 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+// Runs a single CudaRaster stage in a loop on a recorded RasterSnapshot 
+// (see CRReplay -s), so one stage can be tuned on real-world inputs 
+// without timing the whole pipeline.
+//
+// Usage: CRStageBench <snapshot> <pipe.cu> [options]
+//   -n <count>       Number of timed launches (default 100).
+//   -e               Emulate the stage on the host instead.
+//   -I <dir>         Additional include directory for the pipe (repeatable).
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "base/Timer.hpp"
+#include "gpu/CudaCompiler.hpp"
+#include "cudaraster/CudaRaster.hpp"
+#include "cudaraster/RasterSnapshot.hpp"
+#include "PipeUtils.hpp"
+
+using namespace FW;
+
+
+namespace {
+
+struct Options
+{
+  std::string               snapshotFile;
+  std::string               pipeFile;
+  std::vector<std::string>  includes;
+  int                       numIterations;
+  bool                      emulate;
+
+  Options(void) : numIterations(100), emulate(false) {}
+};
+
+void printUsage(void)
+{
+  printf("Usage: CRStageBench <snapshot> <pipe.cu> [-n count] [-e] [-I dir]...\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& opt)
+{
+  std::vector<std::string> positional;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+
+    if (arg == "-n" && hasValue) {
+      opt.numIterations = atoi(argv[++i]);
+    } else if (arg == "-I" && hasValue) {
+      opt.includes.push_back(argv[++i]);
+    } else if (arg == "-e") {
+      opt.emulate = true;
+    } else if (arg[0] == '-') {
+      return false;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+
+  if (positional.size() != 2 || opt.numIterations <= 0) {
+    return false;
+  }
+
+  opt.snapshotFile = positional[0];
+  opt.pipeFile     = positional[1];
+  return true;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+  Options opt;
+  if (!parseOptions(argc, argv, opt))
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  CudaModule::setGLInterop(false);
+
+  RasterSnapshot snapshot;
+  snapshot.load(opt.snapshotFile);
+
+  CudaRaster::Stage stage = snapshot.getStage();
+  printf( "CRStageBench: %s, %d tris, %dx%d x%d, %.2f MB\n", 
+          RasterSnapshot::getStageName(stage), snapshot.getNumTris(), 
+          snapshot.getViewportSize().x, snapshot.getViewportSize().y, 
+          snapshot.getNumSamples(), 
+          (F64)snapshot.getTotalBytes() * (1.0 / (1 << 20)));
+
+  CudaCompiler compiler;
+  initPipeCompiler(compiler, opt.pipeFile, opt.includes);
+  CudaModule* module = compilePixelPipe(compiler, snapshot.getPipeSpec());
+
+  CudaSurface colorBuffer(snapshot.getViewportSize(), CudaSurface::FORMAT_RGBA8,   snapshot.getNumSamples());
+  CudaSurface depthBuffer(snapshot.getViewportSize(), CudaSurface::FORMAT_DEPTH32, snapshot.getNumSamples());
+
+  CudaRaster raster;
+  raster.init();
+  raster.setSurfaces(&colorBuffer, &depthBuffer);
+  raster.setPixelPipe(module, snapshot.getPipeName());
+
+  if (opt.emulate)
+  {
+    CudaRaster::DebugParams debug;
+    debug.emulateTriangleSetup = (stage == CudaRaster::Stage_Setup);
+    debug.emulateBinRaster     = (stage == CudaRaster::Stage_Bin);
+    debug.emulateCoarseRaster  = (stage == CudaRaster::Stage_Coarse);
+    debug.emulateFineRaster    = (stage == CudaRaster::Stage_Fine);
+    raster.setDebugParams(debug);
+  }
+
+  Buffer vertices;
+  Buffer indices;
+  snapshot.apply(raster, vertices, indices);
+
+  // Warm up, then time each launch. reset() happens outside the timings.
+  raster.launchStage(stage);
+
+  std::vector<F64> gpuTimes;
+  std::vector<F64> wallTimes;
+  Timer timer;
+
+  for (int i = 0; i < opt.numIterations; ++i)
+  {
+    snapshot.reset(raster);
+    CudaModule::sync(false);
+
+    timer.start();
+    gpuTimes.push_back(raster.launchStage(stage));
+    wallTimes.push_back(timer.end());
+  }
+
+  std::sort(gpuTimes.begin(), gpuTimes.end());
+  std::sort(wallTimes.begin(), wallTimes.end());
+
+  F64 gpuSum = 0.0;
+  F64 wallSum = 0.0;
+  for (int i = 0; i < opt.numIterations; ++i)
+  {
+    gpuSum  += gpuTimes[i];
+    wallSum += wallTimes[i];
+  }
+
+  int n = opt.numIterations;
+  printf("\n%6s %10s %10s %10s %10s\n", "", "min", "median", "mean", "max");
+  printf( "%6s %10.3f %10.3f %10.3f %10.3f\n", "gpu", 
+          gpuTimes[0] * 1.0e3, gpuTimes[n / 2] * 1.0e3, 
+          gpuSum / n * 1.0e3, gpuTimes[n - 1] * 1.0e3);
+  printf( "%6s %10.3f %10.3f %10.3f %10.3f\n", "wall", 
+          wallTimes[0] * 1.0e3, wallTimes[n / 2] * 1.0e3, 
+          wallSum / n * 1.0e3, wallTimes[n - 1] * 1.0e3);
+  printf("(milliseconds over %d launches)\n", n);
+
+  return EXIT_SUCCESS;
+}
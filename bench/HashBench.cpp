@@ -0,0 +1,134 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+// Throughput comparison of hashBuffer() (Jenkins) against hashBuffer64()
+// and the incremental Hasher, plus a consistency check between the two
+// 64-bit entry points.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "base/Hash.hpp"
+#include "base/Timer.hpp"
+
+using namespace FW;
+
+
+namespace {
+
+volatile U64 g_sink;
+
+// Runs 'func' on the buffer until at least 'minTime' seconds have elapsed
+// and returns the throughput in GB/s.
+template <class Func>
+F64 measure(Func func, const U8* data, int size, F64 minTime = 0.2)
+{
+  S64   iters = 0;
+  U64   acc   = 0;
+  Timer timer(true);
+
+  do
+  {
+    for (int i = 0; i < 16; ++i) {
+      acc += func(data, size);
+    }
+    iters += 16;
+  } while (timer.getElapsed() < minTime);
+
+  F64 elapsed = timer.getElapsed();
+  g_sink = acc;
+  return ((F64)iters * size) / elapsed * 1.0e-9;
+}
+
+U64 runJenkins  (const U8* p, int n) { return hashBuffer(p, n); }
+U64 runJenkinsU (const U8* p, int n) { return hashBuffer(p + 1, n - 1); }
+U64 runHash64   (const U8* p, int n) { return hashBuffer64(p, n); }
+U64 runHash64U  (const U8* p, int n) { return hashBuffer64(p + 1, n - 1); }
+
+U64 runHasher(const U8* p, int n) 
+{
+  // Feed odd-sized slices to exercise the stripe carry-over.
+  Hasher h;
+  int chunk = 4093;
+  for (int ofs = 0; ofs < n; ofs += chunk) {
+    h.update(p + ofs, min(chunk, n - ofs));
+  }
+  return h.finalize();
+}
+
+void checkConsistency(const std::vector<U8>& data)
+{
+  for (int size = 0; size < 512; ++size)
+  {
+    U64 ref = hashBuffer64(&data[0], size);
+    
+    for (int split = 0; split <= size; split += 7)
+    {
+      Hasher h;
+      h.update(&data[0], split);
+      h.update(&data[split], size - split);
+      if (h.finalize() != ref) {
+        fail("Hasher mismatch (size %d, split %d)", size, split);
+      }
+    }
+
+    if (size > 0 && hashBuffer64(&data[1], size - 1) == hashBuffer64(&data[0], size)) {
+      fail("hashBuffer64 collision on shifted input (size %d)", size);
+    }
+  }
+}
+
+} // namespace
+
+
+int main(void)
+{
+  const int maxSize = 16 << 20;
+  std::vector<U8> data(maxSize + 16);
+
+  srand(1);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (U8)rand();
+  }
+
+  checkConsistency(data);
+
+  static const int sizes[] = { 16, 64, 256, 4 << 10, 64 << 10, 1 << 20, 16 << 20 };
+  
+  printf("%10s %14s %14s %14s %14s %14s\n", 
+         "bytes", "jenkins", "jenkins_u", "hash64", "hash64_u", "hasher");
+  
+  for (int i = 0; i < (int)FW_ARRAY_SIZE(sizes); ++i)
+  {
+    int n = sizes[i];
+    printf("%10d %11.2f GB/s %11.2f GB/s %11.2f GB/s %11.2f GB/s %11.2f GB/s\n", n,
+           measure(runJenkins,  &data[0], n),
+           measure(runJenkinsU, &data[0], n),
+           measure(runHash64,   &data[0], n),
+           measure(runHash64U,  &data[0], n),
+           measure(runHasher,   &data[0], n));
+  }
+  
+  return EXIT_SUCCESS;
+}
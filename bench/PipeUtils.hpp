@@ -0,0 +1,80 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef BENCH_PIPEUTILS_HPP_
+#define BENCH_PIPEUTILS_HPP_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gpu/CudaCompiler.hpp"
+#include "cudaraster/cuda/PixelPipe.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Pixel pipe compilation shared by the bench tools. Uses the same defines
+// and include directories as the test application (see SceneCR::initPipe).
+//------------------------------------------------------------------------
+
+inline void initPipeCompiler( CudaCompiler& compiler, const std::string& pipeFile,
+                              const std::vector<std::string>& includes)
+{
+  compiler.setSourceFile(pipeFile);
+  compiler.include("../src/framework");
+  compiler.include("../src/");
+  for (size_t i = 0u; i < includes.size(); ++i) {
+    compiler.include(includes[i]);
+  }
+}
+
+inline bool isSamePipeSpec(const PixelPipeSpec& a, const PixelPipeSpec& b)
+{
+  return (a.samplesLog2      == b.samplesLog2      &&
+          a.vertexStructSize == b.vertexStructSize &&
+          a.renderModeFlags  == b.renderModeFlags  &&
+          a.profilingMode    == b.profilingMode    &&
+          strcmp(a.blendShaderName, b.blendShaderName) == 0);
+}
+
+// Compiles the pipe for 'spec', fails on error.
+inline CudaModule* compilePixelPipe(CudaCompiler& compiler, const PixelPipeSpec& spec)
+{
+  compiler.clearDefines();
+  compiler.define("SAMPLES_LOG2",      spec.samplesLog2);
+  compiler.define("RENDER_MODE_FLAGS", (int)spec.renderModeFlags);
+  compiler.define("BLEND_SHADER",      spec.blendShaderName);
+  compiler.define("CR_PROFILING_MODE", spec.profilingMode);
+
+  CudaModule* module = compiler.compile();
+  if (!module) {
+    fail("Failed to compile the pixel pipe!");
+  }
+  return module;
+}
+
+} // namespace FW
+
+#endif //BENCH_PIPEUTILS_HPP_
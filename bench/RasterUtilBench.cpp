@@ -0,0 +1,370 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+// Host microbenchmark of the rasterization primitives (see RasterUtil.hpp).
+// Every fast variant is first cross-checked against its reference over the
+// same randomized inputs, then each function is timed in ns per call.
+//
+// Usage: RasterUtilBench [count] [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "base/Timer.hpp"
+#include "cudaraster/RasterUtil.hpp"
+
+using namespace FW;
+
+
+namespace {
+
+struct Edge     // Relative to a tile (cover8x8) or a pixel (coverMSAA).
+{
+  S32 ox, oy, dx, dy;
+  U32 flips;
+};
+
+struct Tri      // setupPleq() inputs.
+{
+  Vec3f values;
+  Vec2i v0, d1, d2;
+  S32   area;
+};
+
+struct ClipTri  // clipTriangleWithFrustum() inputs.
+{
+  Vec4f v0, v1, v2, d1, d2;
+};
+
+volatile U64 g_sink;
+U64          g_lut[CR_COVER8X8_LUT_SIZE];
+
+//------------------------------------------------------------------------
+
+// xorshift32, so that inputs only depend on the seed.
+U32 randomU32(U32& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+F32 randomF32(U32& state)
+{
+  return (F32)(randomU32(state) >> 8) * (1.0f / (1 << 24));
+}
+
+// Snapped vertex inside a CR_MAXVIEWPORT_SIZE viewport, in subpixels 
+// relative to its center, as stored in CRTriangleHeader.
+Vec2i randomVertex(U32& state)
+{
+  S32 range = CR_MAXVIEWPORT_SIZE << CR_SUBPIXEL_LOG2;
+  return Vec2i((S32)(randomU32(state) % range), (S32)(randomU32(state) % range)) - range / 2;
+}
+
+// Edge vector with a log-uniform length, from 1 subpixel to the viewport.
+Vec2i randomDelta(U32& state)
+{
+  F32 len   = exp2f(randomF32(state) * (F32)(CR_MAXVIEWPORT_LOG2 + CR_SUBPIXEL_LOG2));
+  F32 angle = randomF32(state) * 2.0f * FW_PI;
+  Vec2i d = Vec2i((S32)floorf(cosf(angle) * len + 0.5f), (S32)floorf(sinf(angle) * len + 0.5f));
+  return (d == Vec2i(0)) ? Vec2i(1, 0) : d;
+}
+
+// Both endpoints inside the viewport, cellLog2 = size of the cell the
+// origin is relative to (tile or pixel).
+Edge randomEdge(U32& state, int cellLog2)
+{
+  S32   half = (CR_MAXVIEWPORT_SIZE << CR_SUBPIXEL_LOG2) / 2;
+  Vec2i p0   = randomVertex(state);
+  Vec2i d    = randomDelta(state);
+  Vec2i p1   = max(min(p0 + d, Vec2i(half - 1)), Vec2i(-half));
+  d = p1 - p0;
+  if (d == Vec2i(0)) {
+    d.x = (p0.x > 0) ? -1 : 1;
+  }
+
+  // Mostly cells near the edge, so that masks are not trivially empty.
+  Vec2i onEdge = p0 + Vec2i(Vec2f(d) * randomF32(state));
+  Vec2i jitter = Vec2i((S32)(randomU32(state) % 64u), (S32)(randomU32(state) % 64u)) - 32;
+  Vec2i cell   = ((onEdge + jitter * (1 << CR_SUBPIXEL_LOG2) + half) >> (cellLog2 + CR_SUBPIXEL_LOG2));
+  cell = max(min(cell, Vec2i((CR_MAXVIEWPORT_SIZE >> cellLog2) - 1)), Vec2i(0));
+  Vec2i base = (cell << (cellLog2 + CR_SUBPIXEL_LOG2)) - ((CR_MAXVIEWPORT_SIZE - 1) << (CR_SUBPIXEL_LOG2 - 1));
+
+  Edge e;
+  e.ox    = p0.x - base.x;
+  e.oy    = p0.y - base.y;
+  e.dx    = d.x;
+  e.dy    = d.y;
+  e.flips = (U8)cover8x8_selectFlips(d.x, d.y);
+  return e;
+}
+
+Tri randomTri(U32& state)
+{
+  Tri t;
+  do
+  {
+    t.v0 = randomVertex(state) + (CR_MAXVIEWPORT_SIZE << (CR_SUBPIXEL_LOG2 - 1));
+    t.d1 = randomDelta(state);
+    t.d2 = randomDelta(state);
+    t.area = t.d1.x * t.d2.y - t.d1.y * t.d2.x;
+  } while (t.area <= 0 || (S64)t.d1.x * t.d2.y - (S64)t.d1.y * t.d2.x != t.area);
+
+  for (int i = 0; i < 3; ++i) {
+    t.values[i] = (F32)CR_DEPTH_MIN + randomF32(state) * (F32)(CR_DEPTH_MAX - CR_DEPTH_MIN);
+  }
+  return t;
+}
+
+ClipTri randomClipTri(U32& state)
+{
+  Vec4f v[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    F32 w = 0.1f + randomF32(state) * 10.0f;
+    for (int j = 0; j < 3; ++j) {
+      v[i][j] = (randomF32(state) * 4.0f - 2.0f) * w;
+    }
+    v[i].w = w;
+  }
+
+  ClipTri t;
+  t.v0 = v[0], t.v1 = v[1], t.v2 = v[2];
+  t.d1 = v[1] - v[0];
+  t.d2 = v[2] - v[0];
+  return t;
+}
+
+//------------------------------------------------------------------------
+
+// Runs 'func' over all inputs until at least 'minTime' seconds have 
+// elapsed and returns the time per call in nanoseconds.
+template <class T, class Func>
+F64 measure(Func func, const std::vector<T>& inputs, F64 minTime = 0.2)
+{
+  S64   calls = 0;
+  U64   acc   = 0;
+  Timer timer(true);
+
+  do
+  {
+    for (size_t i = 0u; i < inputs.size(); ++i) {
+      acc += func(inputs[i]);
+    }
+    calls += (S64)inputs.size();
+  } while (timer.getElapsed() < minTime);
+
+  F64 elapsed = timer.getElapsed();
+  g_sink = acc;
+  return elapsed / (F64)calls * 1.0e9;
+}
+
+U64 runExactRef       (const Edge& e) { return cover8x8_exact_ref(e.ox, e.oy, e.dx, e.dy); }
+U64 runExactNoLUT     (const Edge& e) { return cover8x8_exact_noLUT(e.ox, e.oy, e.dx, e.dy); }
+U64 runExactFast      (const Edge& e) { return cover8x8_exact_fast(e.ox, e.oy, e.dx, e.dy, e.flips, g_lut); }
+U64 runConsRef        (const Edge& e) { return cover8x8_conservative_ref(e.ox, e.oy, e.dx, e.dy); }
+U64 runConsNoLUT      (const Edge& e) { return cover8x8_conservative_noLUT(e.ox, e.oy, e.dx, e.dy); }
+U64 runConsFast       (const Edge& e) { return cover8x8_conservative_fast(e.ox, e.oy, e.dx, e.dy, e.flips, g_lut); }
+U64 runMissesTile     (const Edge& e) { return cover8x8_missesTile(e.ox, e.oy, e.dx, e.dy); }
+
+template <int SamplesLog2> U64 runMSAARef  (const Edge& e) { return coverMSAA_ref(SamplesLog2, e.ox, e.oy, e.dx, e.dy); }
+template <int SamplesLog2> U64 runMSAAFast (const Edge& e) { return coverMSAA_fast(SamplesLog2, e.ox, e.oy, e.dx, e.dy); }
+
+U64 runPleqRef(const Tri& t) 
+{ 
+  return (U32)setupPleq_ref(t.values, t.v0, t.d1, t.d2, t.area, 0).z; 
+}
+
+U64 runPleqFast(const Tri& t) 
+{ 
+  return (U32)setupPleq(t.values, t.v0, t.d1, t.d2, 1.0f / (F32)t.area, 0).z; 
+}
+
+U64 runClip(const ClipTri& t)
+{
+  F32 bary[18];
+  return clipTriangleWithFrustum(bary, &t.v0.x, &t.v1.x, &t.v2.x, &t.d1.x, &t.d2.x);
+}
+
+U64 runEncodeDepth(const U32& depth) { return encodeDepth(depth); }
+
+//------------------------------------------------------------------------
+
+typedef U64 (*EdgeFunc)(const Edge&);
+
+void checkEdges(const char* name, EdgeFunc func, EdgeFunc ref, const std::vector<Edge>& edges)
+{
+  for (size_t i = 0u; i < edges.size(); ++i)
+  {
+    const Edge& e = edges[i];
+    U64 a = func(e);
+    U64 b = ref(e);
+    if (a != b) {
+      fail( "%s mismatch: o = (%d, %d), d = (%d, %d): %016llx != %016llx", name, 
+            e.ox, e.oy, e.dx, e.dy, (unsigned long long)a, (unsigned long long)b);
+    }
+  }
+}
+
+// Plane values at the sample cells of the three vertices, compared to 
+// the F64 setup. The fixed-point setup loses precision on slivers, so 
+// this reports the error rather than failing.
+void checkPleq(const std::vector<Tri>& tris, int samplesLog2)
+{
+  U32 maxError  = 0u;
+  int numAbove  = 0;
+  int shift     = CR_SUBPIXEL_LOG2 - samplesLog2;
+
+  for (size_t i = 0u; i < tris.size(); ++i)
+  {
+    const Tri& t = tris[i];
+    Vec3i fast = setupPleq(t.values, t.v0, t.d1, t.d2, 1.0f / (F32)t.area, samplesLog2);
+    Vec3i ref  = setupPleq_ref(t.values, t.v0, t.d1, t.d2, t.area, samplesLog2);
+    Vec2i verts[3] = { t.v0, t.v0 + t.d1, t.v0 + t.d2 };
+
+    for (int j = 0; j < 3; ++j)
+    {
+      Vec2i s = verts[j] >> shift;
+      U32 a = (U32)fast.x * s.x + (U32)fast.y * s.y + (U32)fast.z;
+      U32 b = (U32)ref.x * s.x + (U32)ref.y * s.y + (U32)ref.z;
+      U32 error = (U32)FW::abs((S32)(a - b));
+      maxError = max(maxError, error);
+      numAbove += (error > CR_LERP_ERROR(samplesLog2)) ? 1 : 0;
+    }
+  }
+
+  printf( "setupPleq (%dx): max error %u, %d / %d values above CR_LERP_ERROR (%u)\n", 
+          1 << samplesLog2, maxError, numAbove, (int)tris.size() * 3, CR_LERP_ERROR(samplesLog2));
+}
+
+// Every clipped vertex must lie inside the frustum, up to rounding.
+void checkClip(const std::vector<ClipTri>& tris)
+{
+  for (size_t i = 0u; i < tris.size(); ++i)
+  {
+    const ClipTri& t = tris[i];
+    F32 bary[18];
+    int num = clipTriangleWithFrustum(bary, &t.v0.x, &t.v1.x, &t.v2.x, &t.d1.x, &t.d2.x);
+
+    for (int j = 0; j < num; ++j)
+    {
+      Vec4f p = t.v0 + t.d1 * bary[j * 2 + 0] + t.d2 * bary[j * 2 + 1];
+      F32 eps = 1.0e-4f * (t.v0.w + t.v1.w + t.v2.w);
+      if (fabsf(p.x) > p.w + eps || fabsf(p.y) > p.w + eps || fabsf(p.z) > p.w + eps) {
+        fail("clipTriangleWithFrustum: vertex outside the frustum (triangle %d)", (int)i);
+      }
+    }
+  }
+}
+
+void checkEncodeDepth(void)
+{
+  U32 prev = encodeDepth(0u);
+  for (U64 d = 1u; d <= FW_U32_MAX; d += 65521u)
+  {
+    U32 curr = encodeDepth((U32)d);
+    if (curr < prev || curr < CR_DEPTH_MIN || curr > CR_DEPTH_MAX) {
+      fail("encodeDepth: not monotonic / out of range at %u", (U32)d);
+    }
+    prev = curr;
+  }
+}
+
+void printRow(const char* name, F64 ns)
+{
+  printf("%-28s %9.2f ns\n", name, ns);
+}
+
+} // namespace
+
+
+int main(int argc, char *argv[])
+{
+  int count = (argc > 1) ? atoi(argv[1]) : (1 << 16);
+  U32 state = (argc > 2) ? max((U32)strtoul(argv[2], NULL, 10), 1u) : 1u;
+  if (count <= 0)
+  {
+    printf("Usage: RasterUtilBench [count] [seed]\n");
+    return EXIT_FAILURE;
+  }
+
+  cover8x8_setupLUT(g_lut);
+
+  std::vector<Edge>     tileEdges(count);
+  std::vector<Edge>     pixelEdges(count);
+  std::vector<Tri>      tris(count);
+  std::vector<ClipTri>  clipTris(count);
+  std::vector<U32>      depths(count);
+
+  for (int i = 0; i < count; ++i)
+  {
+    tileEdges[i]  = randomEdge(state, CR_TILE_LOG2);
+    pixelEdges[i] = randomEdge(state, 0);
+    tris[i]       = randomTri(state);
+    clipTris[i]   = randomClipTri(state);
+    depths[i]     = randomU32(state);
+  }
+
+  // Cross-check.
+
+  checkEdges("cover8x8_exact_noLUT",        runExactNoLUT, runExactRef, tileEdges);
+  checkEdges("cover8x8_exact_fast",         runExactFast,  runExactRef, tileEdges);
+  checkEdges("cover8x8_conservative_noLUT", runConsNoLUT,  runConsRef,  tileEdges);
+  checkEdges("cover8x8_conservative_fast",  runConsFast,   runConsRef,  tileEdges);
+  checkEdges("coverMSAA_fast (1x)",         runMSAAFast<0>, runMSAARef<0>, pixelEdges);
+  checkEdges("coverMSAA_fast (2x)",         runMSAAFast<1>, runMSAARef<1>, pixelEdges);
+  checkEdges("coverMSAA_fast (4x)",         runMSAAFast<2>, runMSAARef<2>, pixelEdges);
+  checkEdges("coverMSAA_fast (8x)",         runMSAAFast<3>, runMSAARef<3>, pixelEdges);
+  checkClip(clipTris);
+  checkEncodeDepth();
+
+  printf("%d inputs, all fast variants match their reference.\n", count);
+  for (int s = 0; s <= 3; ++s) {
+    checkPleq(tris, s);
+  }
+  printf("\n");
+
+  // Timing.
+
+  printRow("cover8x8_exact_ref",          measure(runExactRef,   tileEdges));
+  printRow("cover8x8_exact_noLUT",        measure(runExactNoLUT, tileEdges));
+  printRow("cover8x8_exact_fast",         measure(runExactFast,  tileEdges));
+  printRow("cover8x8_conservative_ref",   measure(runConsRef,    tileEdges));
+  printRow("cover8x8_conservative_noLUT", measure(runConsNoLUT,  tileEdges));
+  printRow("cover8x8_conservative_fast",  measure(runConsFast,   tileEdges));
+  printRow("cover8x8_missesTile",         measure(runMissesTile, tileEdges));
+  printRow("coverMSAA_ref (4x)",          measure(runMSAARef<2>,  pixelEdges));
+  printRow("coverMSAA_fast (4x)",         measure(runMSAAFast<2>, pixelEdges));
+  printRow("coverMSAA_ref (8x)",          measure(runMSAARef<3>,  pixelEdges));
+  printRow("coverMSAA_fast (8x)",         measure(runMSAAFast<3>, pixelEdges));
+  printRow("setupPleq_ref",               measure(runPleqRef,  tris));
+  printRow("setupPleq",                   measure(runPleqFast, tris));
+  printRow("clipTriangleWithFrustum",     measure(runClip,     clipTris));
+  printRow("encodeDepth",                 measure(runEncodeDepth, depths));
+
+  return EXIT_SUCCESS;
+}
@@ -22,7 +22,18 @@
  */
 
 #include "CudaRaster.hpp"
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
+#include <base/Timer.hpp>
+
+#include "RasterCapture.hpp"
+#include "RasterHeatmap.hpp"
+#include "RasterHistory.hpp"
+#include "RasterProfile.hpp"
+#include "RasterSnapshot.hpp"
+#include "RasterTrace.hpp"
+#include "RasterUtil.hpp"
 
 
 namespace FW {
@@ -31,10 +42,11 @@ namespace FW {
 
 static const struct
 {
+  const char* name;
   const char* format;
 } g_profCounters[] =
 {
-#define LAMBDA(ID, FORMAT) { FORMAT },
+#define LAMBDA(ID, FORMAT) { #ID, FORMAT },
   CR_PROFILING_COUNTERS(LAMBDA)
 #undef LAMBDA
 };
@@ -43,15 +55,49 @@ static const struct
 // XXX
 static const struct
 {
+  const char* name;
   S32         parent;
   const char* format;
 } g_profTimers[] =
 {
-#define LAMBDA(ID, PARENT, FORMAT) { (UPTR)&((CRProfTimerOrder*)NULL)->PARENT, FORMAT }, 
+#define LAMBDA(ID, PARENT, FORMAT) { #ID, (UPTR)&((CRProfTimerOrder*)NULL)->PARENT, FORMAT }, 
   CR_PROFILING_TIMERS(LAMBDA)
 #undef LAMBDA
 };
 
+//------------------------------------------------------------------------
+// Counters of the host-emulated stages, using the same IDs as CR_COUNT() so
+// that both backends fill the same ProfilingMode_Counters report. Each stage
+// accumulates locally and merges once at the end. Only collected when the
+// pixel pipe uses ProfilingMode_Counters.
+//------------------------------------------------------------------------
+
+struct CRHostCounters
+{
+  bool enabled;
+  S64 num   [sizeof(CRProfCounterOrder) - 1];
+  S64 denom [sizeof(CRProfCounterOrder) - 1];
+
+  CRHostCounters(bool on) : enabled(on) { memset(num, 0, sizeof(num)); memset(denom, 0, sizeof(denom)); }
+};
+
+#define CR_HOST_COUNT_INIT()          CRHostCounters hostCounters(m_pipeSpec.profilingMode == ProfilingMode_Counters)
+#define CR_HOST_COUNT(ID, NUM, DENOM) \
+  do { if (hostCounters.enabled) { int idx = (int)offsetof(CRProfCounterOrder, ID); \
+       hostCounters.num[idx] += (NUM); hostCounters.denom[idx] += (DENOM); } } while (0)
+#define CR_HOST_COUNT_MERGE()         mergeHostCounters(hostCounters.num, hostCounters.denom)
+
+// Module globals and textures accessed on every draw.
+static const HashKey<std::string> g_keyCrParams       ("c_crParams");
+static const HashKey<std::string> g_keyCrAtomics      ("g_crAtomics");
+static const HashKey<std::string> g_keyProfData       ("c_profData");
+static const HashKey<std::string> g_keyProfLaunchIdx  ("c_profLaunchIdx");
+
+// Headroom added to the buffers of drawTriangles().
+static const int maxSubtrisSlack  = 4096;     // x 81B    = 324KB
+static const int maxBinSegsSlack  = 256;      // x 2137B  = 534KB
+static const int maxTileSegsSlack = 4096;     // x 136B   = 544KB
+
 //------------------------------------------------------------------------
 
 CudaRaster::CudaRaster(void)
@@ -68,7 +114,19 @@ CudaRaster::CudaRaster(void)
       m_vertexOfs     (0),
       m_indexBuffer   (NULL),
       m_indexOfs      (0),
+      m_indexFormat   (IndexFormat_U32),
+      m_topology      (Topology_TriangleList),
+      m_restartIndex  (~0u),
       m_numTris       (0),
+      m_firstTri      (0),
+      m_maxChunkTris  (0),
+      m_numDraws      (0),
+      m_numRestarts   (0),
+      m_restartDirty  (false),
+      m_instanceBuffer(NULL),
+      m_instanceOfs   (0),
+      m_numInstances  (0),
+      m_instanceTris  (0),
 
       m_module        (NULL),
       m_setupKernel   (NULL),
@@ -77,11 +135,29 @@ CudaRaster::CudaRaster(void)
       m_fineKernel    (NULL),
       m_numSMs        (1),
       m_numFineWarps  (1),
+      m_maxFineWarps  (0),
 
       m_maxSubtris    (1),
       m_maxBinSegs    (1),
-      m_maxTileSegs   (1)
+      m_maxTileSegs   (1),
+
+      m_capture       (NULL),
+      m_snapshot      (NULL),
+      m_heatmap       (NULL),
+      m_history       (NULL),
+
+      m_trace         (NULL),
+      m_traceOwner    (NULL),
+      m_traceHost     (-1),
+      m_traceDevice   (-1),
+      m_traceLaunch   (0.0)
 {
+  memset(&m_vertexLayout, 0, sizeof(m_vertexLayout));
+
+  for (int i = 0; i < Stage_Max; ++i) {
+    RasterPerf::clearSample(m_perfStages[i]);
+  }
+  clearDrawStats();
 }
 
 CudaRaster::~CudaRaster(void)
@@ -91,6 +167,7 @@ CudaRaster::~CudaRaster(void)
   CudaModule::checkError("cuEventDestroy", cuEventDestroy(m_evCoarseBegin));
   CudaModule::checkError("cuEventDestroy", cuEventDestroy(m_evFineBegin));
   CudaModule::checkError("cuEventDestroy", cuEventDestroy(m_evFineEnd));
+  delete m_history;
 }
 
 //------------------------------------------------------------------------
@@ -183,6 +260,7 @@ void CudaRaster::deferredClear(const Vec4f& color, F32 depth)
 void CudaRaster::setPixelPipe(CudaModule* module, const std::string& name)
 {
   m_module = module;
+  m_pipeName = name;
   if (!module) {
     return;
   }
@@ -213,6 +291,10 @@ void CudaRaster::setPixelPipe(CudaModule* module, const std::string& name)
   CudaModule::checkError("cuFuncGetAttribute", res);
 
   m_numFineWarps = min(m_numFineWarps / 32, CR_FINE_MAX_WARPS);
+  
+  if (m_maxFineWarps > 0) {
+    m_numFineWarps = min(m_numFineWarps, m_maxFineWarps);
+  }
 }
 
 //------------------------------------------------------------------------
@@ -225,21 +307,251 @@ void CudaRaster::setVertexBuffer(Buffer* buf, S64 ofs)
 
 //------------------------------------------------------------------------
 
-void CudaRaster::setIndexBuffer(Buffer* buf, S64 ofs, int numTris)
+void CudaRaster::setVertexLayout(const VertexLayout* layout)
+{
+  memset(&m_vertexLayout, 0, sizeof(m_vertexLayout));
+  if (!layout) {
+    return;
+  }
+
+  if (layout->stride <= 0 || layout->stride % 4 != 0) {
+    fail("CudaRaster: Invalid vertex stride %d!", layout->stride);
+  }
+  if (layout->numVaryings < 0 || layout->numVaryings > CR_MAX_VARYINGS) {
+    fail("CudaRaster: Too many varyings in vertex layout!");
+  }
+
+  static const int attribBytes[VertexFormat_Max] = { 16, 12, 8, 8, 4, 4 };
+  for (int i = -1; i < layout->numVaryings; ++i)
+  {
+    const VertexLayout::Attrib& a = (i < 0) ? layout->position : layout->varyings[i];
+    if (a.format < 0 || a.format >= VertexFormat_Max) {
+      fail("CudaRaster: Invalid vertex format %d!", a.format);
+    }
+    if (a.offset < 0 || a.offset % 4 != 0 || a.offset + attribBytes[a.format] > layout->stride) {
+      fail("CudaRaster: Invalid vertex attribute offset %d!", a.offset);
+    }
+
+    CRVertexAttrib& dst = (i < 0) ? m_vertexLayout.position : m_vertexLayout.varyings[i];
+    dst.offset = a.offset;
+    dst.format = a.format;
+  }
+
+  m_vertexLayout.stride      = layout->stride;
+  m_vertexLayout.numVaryings = layout->numVaryings;
+}
+
+//------------------------------------------------------------------------
+
+S32 CudaRaster::getVertexStride(void) const
+{
+  return (m_vertexLayout.stride) ? m_vertexLayout.stride : m_pipeSpec.vertexStructSize;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::setIndexBuffer(Buffer* buf, S64 ofs, int numTris, int format)
 {
+  if (format != IndexFormat_U32 && format != IndexFormat_U16) {
+    fail("CudaRaster: Invalid index format %d!", format);
+  }
+  FW_ASSERT(ofs % ((format == IndexFormat_U16) ? sizeof(U16) : sizeof(S32)) == 0);
+
   m_indexBuffer = buf;
   m_indexOfs = ofs;
+  m_indexFormat = format;
+  m_topology = Topology_TriangleList;
   m_numTris = numTris;
+  m_restartHost.clear();
+  m_numRestarts = 0;
+  m_restartDirty = false;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::setIndexBuffer(Buffer* buf, S64 ofs, int numIndices, int format, int topology, U32 restartIndex)
+{
+  if (topology != Topology_TriangleList && topology != Topology_TriangleStrip && topology != Topology_TriangleFan) {
+    fail("CudaRaster: Invalid topology %d!", topology);
+  }
+  if (topology == Topology_TriangleList) {
+    FW_ASSERT(numIndices % 3 == 0);
+    setIndexBuffer(buf, ofs, numIndices / 3, format);
+    return;
+  }
+
+  setIndexBuffer(buf, ofs, max(numIndices - 2, 0), format);
+  m_topology = topology;
+  m_restartIndex = (format == IndexFormat_U16) ? (restartIndex & 0xFFFFu) : restartIndex;
+  m_restartDirty = true;
+}
+
+//------------------------------------------------------------------------
+
+S64 CudaRaster::getIndexBytes(void) const
+{
+  S64 indexBytes = (m_indexFormat == IndexFormat_U16) ? sizeof(U16) : sizeof(S32);
+  if (m_topology != Topology_TriangleList) {
+    return (m_numTris) ? (S64)(m_numTris + 2) * indexBytes : 0;
+  }
+  return (S64)m_numTris * indexBytes * 3;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::drawTriangles(const DrawRange* ranges, int numRanges)
+{
+  FW_ASSERT(numRanges >= 0 && (ranges || !numRanges));
+
+  if (!m_module)
+    fail("CudaRaster: Pixel pipe not set!");
+
+  // Nothing to draw, keep the current buffers and format.
+  if (!numRanges)
+    return;
+
+  int vertexSize  = getVertexStride();
+  int indexFormat = ranges[0].indexFormat;
+  int indexSize   = (indexFormat == IndexFormat_U16) ? sizeof(U16) : sizeof(S32);
+
+  // Unique buffers, in order of first use. Gathered regions stay aligned
+  // for int3 reads.
+
+  std::vector<Buffer*> vertexBufs, indexBufs;
+  std::vector<S64>     vertexBase, indexBase;
+  S64 vertexBytes = 0, indexBytes = 0;
+
+  for (int i = 0; i < numRanges; ++i)
+  {
+    const DrawRange& r = ranges[i];
+    if (!r.vertexBuffer || !r.indexBuffer)
+      fail("CudaRaster: Missing buffer in draw range %d!", i);
+    if (r.indexFormat != indexFormat)
+      fail("CudaRaster: Mixed index formats in draw ranges!");
+    FW_ASSERT(r.numTris >= 0 && r.vertexOfs % vertexSize == 0 && r.indexOfs % indexSize == 0);
+
+    if (std::find(vertexBufs.begin(), vertexBufs.end(), r.vertexBuffer) == vertexBufs.end())
+    {
+      vertexBufs.push_back(r.vertexBuffer);
+      vertexBase.push_back(vertexBytes);
+      vertexBytes += (r.vertexBuffer->getSize() + vertexSize - 1) / vertexSize * vertexSize;
+    }
+    if (std::find(indexBufs.begin(), indexBufs.end(), r.indexBuffer) == indexBufs.end())
+    {
+      indexBufs.push_back(r.indexBuffer);
+      indexBase.push_back(indexBytes);
+      indexBytes += (r.indexBuffer->getSize() + 15) & ~(S64)15;
+    }
+  }
+
+  Buffer* vertexBuffer = (vertexBufs.size() == 1) ? vertexBufs[0] : &m_drawVertices;
+  Buffer* indexBuffer  = (indexBufs.size() == 1) ? indexBufs[0] : &m_drawIndices;
+
+  if (vertexBufs.size() > 1)
+  {
+    m_drawVertices.resizeDiscard(vertexBytes);
+    for (size_t i = 0u; i < vertexBufs.size(); ++i)
+      m_drawVertices.setRange(vertexBase[i], *vertexBufs[i], 0, vertexBufs[i]->getSize());
+  }
+  if (indexBufs.size() > 1)
+  {
+    m_drawIndices.resizeDiscard(indexBytes);
+    for (size_t i = 0u; i < indexBufs.size(); ++i)
+      m_drawIndices.setRange(indexBase[i], *indexBufs[i], 0, indexBufs[i]->getSize());
+  }
+
+  // Draw table.
+
+  std::vector<CRDrawRange> table(numRanges);
+  S32 numTris = 0;
+
+  for (int i = 0; i < numRanges; ++i)
+  {
+    const DrawRange& r = ranges[i];
+    S64 vbase = (vertexBufs.size() > 1) ? vertexBase[std::find(vertexBufs.begin(), vertexBufs.end(), r.vertexBuffer) - vertexBufs.begin()] : 0;
+    S64 ibase = (indexBufs.size() > 1) ? indexBase[std::find(indexBufs.begin(), indexBufs.end(), r.indexBuffer) - indexBufs.begin()] : 0;
+
+    CRDrawRange& d = table[i];
+    d.firstTri   = numTris;
+    d.firstIndex = (S32)((ibase + r.indexOfs) / indexSize);
+    d.baseVertex = (S32)((vbase + r.vertexOfs) / vertexSize);
+    d.pad        = 0;
+    numTris     += r.numTris;
+  }
+
+  m_drawTable.set(&table[0], (S64)table.size() * sizeof(CRDrawRange));
+
+  // Draw with the batch in place of the current buffers.
+
+  Buffer* oldVertexBuffer = m_vertexBuffer;
+  S64     oldVertexOfs    = m_vertexOfs;
+  Buffer* oldIndexBuffer  = m_indexBuffer;
+  S64     oldIndexOfs     = m_indexOfs;
+  S32     oldIndexFormat  = m_indexFormat;
+  S32     oldTopology     = m_topology;
+  S32     oldNumTris      = m_numTris;
+
+  m_vertexBuffer = vertexBuffer;
+  m_vertexOfs    = 0;
+  m_indexBuffer  = indexBuffer;
+  m_indexOfs     = 0;
+  m_indexFormat  = indexFormat;
+  m_topology     = Topology_TriangleList;
+  m_numTris      = numTris;
+  m_numDraws     = numRanges;
+
+  drawTriangles();
+
+  m_vertexBuffer = oldVertexBuffer;
+  m_vertexOfs    = oldVertexOfs;
+  m_indexBuffer  = oldIndexBuffer;
+  m_indexOfs     = oldIndexOfs;
+  m_indexFormat  = oldIndexFormat;
+  m_topology     = oldTopology;
+  m_numTris      = oldNumTris;
+  m_numDraws     = 0;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::setInstanceBuffer(Buffer* buf, S64 ofs)
+{
+  m_instanceBuffer = buf;
+  m_instanceOfs = ofs;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::drawTrianglesInstanced(int numInstances)
+{
+  FW_ASSERT(numInstances >= 0);
+
+  if (!m_instanceBuffer)
+    fail("CudaRaster: Instance buffer not set!");
+
+  if (m_instanceBuffer->getSize() - m_instanceOfs < (S64)numInstances * (S64)sizeof(Mat4f))
+    fail("CudaRaster: Instance buffer too small for %d instances!", numInstances);
+
+  if ((S64)m_numTris * numInstances > FW_S32_MAX)
+    fail("CudaRaster: Too many instanced triangles!");
+
+  S32 numTris = m_numTris;
+
+  m_instanceTris = numTris;
+  m_numInstances = numInstances;
+  m_numTris      = numTris * numInstances;
+
+  drawTriangles();
+
+  m_numTris      = numTris;
+  m_numInstances = 0;
+  m_instanceTris = 0;
 }
 
 //------------------------------------------------------------------------
 
 void CudaRaster::drawTriangles(void)
 {  
-  int maxSubtrisSlack  = 4096;     // x 81B    = 324KB
-  int maxBinSegsSlack  = 256;      // x 2137B  = 534KB
-  int maxTileSegsSlack = 4096;     // x 136B   = 544KB
-
   // Check for errors.
   if (!m_bInitialized)
     fail("CudaRaster: not initialized!");
@@ -258,8 +570,75 @@ void CudaRaster::drawTriangles(void)
 
   if (m_pipeSpec.samplesLog2 != m_colorBuffer->getSamplesLog2())
     fail("CudaRaster: Mismatch in multisampling between pixel pipe and surface!");
+
+  F64 traceBegin = (m_trace) ? m_trace->getTime() : 0.0;
+
+  if (m_restartDirty)
+    updateRestartTable();
     
+  if (m_capture)
+    m_capture->record(*this);
+
+  if (m_snapshot)
+    m_snapshot->recordInput(*this);
+
+  if (m_heatmap)
+    m_heatmap->beginDraw(*this);
+
+
+  // Split the draw into chunks that fit CR_MAXSUBTRIS_SIZE and the
+  // budget of setMaxChunkTris(), drawn in order into the same surfaces.
+  S32 numTris   = m_numTris;
+  S32 chunkTris = max(min(numTris, CR_MAXSUBTRIS_SIZE - maxSubtrisSlack), 1);
+  if (m_maxChunkTris > 0)
+    chunkTris = min(chunkTris, m_maxChunkTris);
+
+  if (m_snapshot && numTris > chunkTris)
+    fail("CudaRaster: Cannot snapshot a draw split into chunks!");
+
+  clearDrawStats();
+
+  S32 firstTri = 0;
+  do
+  {
+    m_firstTri = firstTri;
+    m_numTris  = min(chunkTris, numTris - firstTri);
+
+    if (!drawChunk())
+    {
+      if (m_snapshot)
+        fail("CudaRaster: Cannot snapshot a draw split into chunks!");
+      chunkTris = max(m_numTris / 2, 1);
+      continue;
+    }
+
+    firstTri += m_numTris;
+    m_deferredClear = false;
+  }
+  while (firstTri < numTris);
+
+  m_firstTri = 0;
+  m_numTris  = numTris;
+
+  if (m_snapshot)
+  {
+    m_snapshot->recordOutput(*this);
+    m_snapshot = NULL;
+  }
+
+  if (m_history)
+    m_history->add(m_drawStats, m_drawAtomics);
 
+  if (m_trace)
+    m_trace->addSpan(m_traceHost, "drawTriangles", "host", traceBegin, m_trace->getTime(), m_numTris);
+
+  m_deferredClear = false;
+}
+
+//------------------------------------------------------------------------
+
+bool CudaRaster::drawChunk(void)
+{
   // Select batch size for BinRaster and estimate buffer sizes.
   {
     int roundSize  = CR_BIN_WARPS * 32;
@@ -277,22 +656,7 @@ void CudaRaster::drawTriangles(void)
   // Retry until successful.
   for (;;)
   {
-    // Allocate buffers.
-    if (m_maxSubtris > CR_MAXSUBTRIS_SIZE) {
-      fail("CudaRaster: CR_MAXSUBTRIS_SIZE exceeded!");
-    }
-    
-    m_triSubtris.resizeDiscard(m_maxSubtris * sizeof(U8));
-    m_triHeader.resizeDiscard(m_maxSubtris * sizeof(CRTriangleHeader));
-    m_triData.resizeDiscard(m_maxSubtris * sizeof(CRTriangleData));
-
-    m_binSegData.resizeDiscard(m_maxBinSegs * CR_BIN_SEG_SIZE * sizeof(S32));
-    m_binSegNext.resizeDiscard(m_maxBinSegs * sizeof(S32));
-    m_binSegCount.resizeDiscard(m_maxBinSegs * sizeof(S32));
-
-    m_tileSegData.resizeDiscard(m_maxTileSegs * CR_TILE_SEG_SIZE * sizeof(S32));
-    m_tileSegNext.resizeDiscard(m_maxTileSegs * sizeof(S32));
-    m_tileSegCount.resizeDiscard(m_maxTileSegs * sizeof(S32));
+    allocateBuffers();
 
     // No profiling => launch stages.
     if (m_pipeSpec.profilingMode == ProfilingMode_Default)
@@ -310,20 +674,20 @@ void CudaRaster::drawTriangles(void)
 
       m_profData.resizeDiscard(totalWarps * bytesPerWarp);
       m_profData.clear(0);
-      *(CUdeviceptr*)m_module->getGlobal("c_profData").getMutablePtrDiscard() = 
+      *(CUdeviceptr*)m_module->getGlobal(g_keyProfData).getMutablePtrDiscard() = 
                                                 m_profData.getMutableCudaPtr();
 
       int numLaunches = (m_pipeSpec.profilingMode == ProfilingMode_Timers) ? numTimers : 1;
       
       for (int i = 0; i < numLaunches; i++)
       {
-        *(S32*)m_module->getGlobal("c_profLaunchIdx").getMutablePtrDiscard() = i;
+        *(S32*)m_module->getGlobal(g_keyProfLaunchIdx).getMutablePtrDiscard() = i;
         launchStages();
       }
     }
 
     // No overflows => done.
-    const CRAtomics& atomics = *(const CRAtomics*)m_module->getGlobal("g_crAtomics").getPtr();
+    const CRAtomics& atomics = *(const CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getPtr();
     
     if (atomics.numSubtris <= m_maxSubtris && 
         atomics.numBinSegs <= m_maxBinSegs && 
@@ -332,19 +696,70 @@ void CudaRaster::drawTriangles(void)
       break;
     }
     
-    // Grow buffers and retry.
+    // Grow buffers and retry, unless the chunk must be split.
+    if (atomics.numSubtris + maxSubtrisSlack > CR_MAXSUBTRIS_SIZE && m_numTris > 1)
+      return false;
+
     m_maxSubtris = max(m_maxSubtris, atomics.numSubtris + maxSubtrisSlack);
     m_maxBinSegs = max(m_maxBinSegs, atomics.numBinSegs + maxBinSegsSlack);
     m_maxTileSegs = max(m_maxTileSegs, atomics.numTileSegs + maxTileSegsSlack);
   }
 
-  m_deferredClear = false;
+  if (m_heatmap)
+    m_heatmap->record(*this);
+
+  if (m_trace)
+    traceDeviceStages();
+
+  addChunkStats();
+  return true;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::allocateBuffers(void)
+{
+  if (m_maxSubtris > CR_MAXSUBTRIS_SIZE) {
+    fail("CudaRaster: CR_MAXSUBTRIS_SIZE exceeded!");
+  }
+  
+  m_triSubtris.resizeDiscard(m_maxSubtris * sizeof(U8));
+  m_triHeader.resizeDiscard(m_maxSubtris * sizeof(CRTriangleHeader));
+  m_triData.resizeDiscard(m_maxSubtris * sizeof(CRTriangleData));
+
+  m_binSegData.resizeDiscard(m_maxBinSegs * CR_BIN_SEG_SIZE * sizeof(S32));
+  m_binSegNext.resizeDiscard(m_maxBinSegs * sizeof(S32));
+  m_binSegCount.resizeDiscard(m_maxBinSegs * sizeof(S32));
+
+  m_tileSegData.resizeDiscard(m_maxTileSegs * CR_TILE_SEG_SIZE * sizeof(S32));
+  m_tileSegNext.resizeDiscard(m_maxTileSegs * sizeof(S32));
+  m_tileSegCount.resizeDiscard(m_maxTileSegs * sizeof(S32));
 }
 
 //------------------------------------------------------------------------
 
 CudaRaster::Stats CudaRaster::getStats(void)
 {
+    return m_drawStats;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::clearDrawStats(void)
+{
+    memset(&m_drawStats, 0, sizeof(Stats));
+    memset(&m_drawAtomics, 0, sizeof(CRAtomics));
+    for (int i = 0; i < Stage_Max; ++i)
+        RasterPerf::clearSample(m_drawPerf[i]);
+    m_drawProfData.clear();
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::addChunkStats(void)
+{
+    // The stage events, atomics and profiling data only hold the last 
+    // chunk => add them up for getStats(), getProfile() and the history.
     Stats stats;
     
     memset(&stats, 0, sizeof(Stats));
@@ -355,145 +770,201 @@ CudaRaster::Stats CudaRaster::getStats(void)
     cuEventElapsedTime(&stats.coarseTime,   m_evCoarseBegin,    m_evFineBegin);
     cuEventElapsedTime(&stats.fineTime,     m_evFineBegin,      m_evFineEnd);
 
-    stats.setupTime  *= 1.0e-3f;
-    stats.binTime    *= 1.0e-3f;
-    stats.coarseTime *= 1.0e-3f;
-    stats.fineTime   *= 1.0e-3f;
-    return stats;
+    m_drawStats.setupTime  += stats.setupTime * 1.0e-3f;
+    m_drawStats.binTime    += stats.binTime * 1.0e-3f;
+    m_drawStats.coarseTime += stats.coarseTime * 1.0e-3f;
+    m_drawStats.fineTime   += stats.fineTime * 1.0e-3f;
+
+    const CRAtomics& a = *(const CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getPtr();
+    m_drawAtomics.numSubtris     += a.numSubtris;
+    m_drawAtomics.binCounter     += a.binCounter;
+    m_drawAtomics.numBinSegs     += a.numBinSegs;
+    m_drawAtomics.coarseCounter  += a.coarseCounter;
+    m_drawAtomics.numTileSegs    += a.numTileSegs;
+    m_drawAtomics.numActiveTiles += a.numActiveTiles;
+    m_drawAtomics.fineCounter    += a.fineCounter;
+
+    for (int i = 0; i < Stage_Max; ++i)
+    for (int j = 0; j < RasterPerf::Event_Max; ++j)
+    {
+        S64 v = m_perfStages[i].values[j];
+        if (v != -1)
+            m_drawPerf[i].values[j] = max(m_drawPerf[i].values[j], (S64)0) + v;
+    }
+
+    if (m_pipeSpec.profilingMode != ProfilingMode_Default)
+    {
+        const U8* src = m_profData.getPtr();
+        if (m_drawProfData.size() != (size_t)m_profData.getSize())
+            m_drawProfData.assign((size_t)m_profData.getSize(), 0);
+
+        // Counters are S64 sums, timers U32 sums.
+        if (m_pipeSpec.profilingMode == ProfilingMode_Counters)
+        {
+            for (size_t i = 0u; i < m_drawProfData.size() / sizeof(S64); i++)
+                ((S64*)&m_drawProfData[0])[i] += ((const S64*)src)[i];
+        }
+        else
+        {
+            for (size_t i = 0u; i < m_drawProfData.size() / sizeof(U32); i++)
+                ((U32*)&m_drawProfData[0])[i] += ((const U32*)src)[i];
+        }
+    }
 }
 
 //------------------------------------------------------------------------
 
-std::string CudaRaster::getProfilingInfo(void)
+void CudaRaster::setHistorySize(int numFrames)
 {
-  char buffer[512];
-  
-  /**/
-  
-    std::string s("\n");
+  FW_ASSERT(numFrames >= 0);
 
-    if (!m_module) {
-        s += "Pixel pipe not set!\n";
-    }
+  if (numFrames == 0)
+  {
+    delete m_history;
+    m_history = NULL;
+  }
+  else if (!m_history)
+  {
+    m_history = new RasterHistory(numFrames);
+  }
+  else if (m_history->getCapacity() != numFrames)
+  {
+    m_history->setCapacity(numFrames);
+  }
+}
 
-    // ProfilingMode_Default.
-    if (m_pipeSpec.profilingMode == ProfilingMode_Default)
-    {        
-        Stats               stats           = getStats();
-        const CRAtomics&    atomics         = *(const CRAtomics*)m_module->getGlobal("g_crAtomics").getPtr();
-        F32                 pctCoef         = 100.0f / (stats.setupTime + stats.binTime + stats.coarseTime + stats.fineTime);
-        int                 bytesPerSubtri  = (int)(sizeof(U8) + sizeof(CRTriangleHeader) + sizeof(CRTriangleData));
-        int                 bytesPerBinSeg  = (CR_BIN_SEG_SIZE + 2) * (int)sizeof(S32);
-        int                 bytesPerTileSeg = (CR_TILE_SEG_SIZE + 2) * (int)sizeof(S32);
-
-        s += "ProfilingMode_Default\n";
-        s += "---------------------\n";
-        s += "\n";
-        
-        sprintf( buffer, "%-16s%.3f ms (%.0f%%)\n", "triangleSetup", 
-                 stats.setupTime * 1.0e3f, stats.setupTime * pctCoef);
-        s += buffer;
-                      
-        sprintf( buffer, "%-16s%.3f ms (%.0f%%)\n", "binRaster", 
-                 stats.binTime * 1.0e3f, stats.binTime * pctCoef);
-        s += buffer;
-                      
-        sprintf( buffer, "%-16s%.3f ms (%.0f%%)\n", "coarseRaster", 
-                stats.coarseTime * 1.0e3f, stats.coarseTime * pctCoef);
-        s += buffer;
-                      
-        sprintf( buffer, "%-16s%.3f ms (%.0f%%)\n", "fineRaster", 
-                 stats.fineTime * 1.0e3f, stats.fineTime * pctCoef);
-        s += buffer;
-        
-        s += "\n";
-        
-        sprintf( buffer, "%-16s%-10d(%.1f MB)\n", "numSubtris",   
-                 atomics.numSubtris,  (F32)(atomics.numSubtris * bytesPerSubtri) * exp2(-20));
-        s += buffer;
-        
-        sprintf(buffer, "%-16s%-10d(%.1f MB)\n", "numBinSegs",   
-                atomics.numBinSegs,  (F32)(atomics.numBinSegs * bytesPerBinSeg) * exp2(-20));
-        s += buffer;
-                      
-        sprintf(buffer, "%-16s%-10d(%.1f MB)\n", "numTileSegs",  
-                atomics.numTileSegs, (F32)(atomics.numTileSegs * bytesPerTileSeg) * exp2(-20));
-        s += buffer;
-    }
+//------------------------------------------------------------------------
 
-    // ProfilingMode_Counters.
-    else if (m_pipeSpec.profilingMode == ProfilingMode_Counters)
-    {
-        const S64*  counterPtr  = (const S64*)m_profData.getPtr();
-        int         numCounters = FW_ARRAY_SIZE(g_profCounters);
-        int         numWarps    = (int)m_profData.getSize() / (numCounters * 64 * (int)sizeof(S64));
+void CudaRaster::resetHistory(void)
+{
+  if (m_history) {
+    m_history->reset();
+  }
+}
 
-        s += "ProfilingMode_Counters\n";
-        s += "----------------------\n";
-        s += "\n";
+//------------------------------------------------------------------------
 
-        for (int i = 0; i < numCounters; i++)
-        {
-            S64 num = 0;
-            S64 denom = 0;
-            for (int j = 0; j < numWarps; j++)
-            for (int k = 0; k < 32; k++)
-            {
-                int idx = (j * numCounters + i) * 64 + k;
-                num += counterPtr[idx + 0];
-                denom += counterPtr[idx + 32];
-            }
-            sprintf( buffer, g_profCounters[i].format, (F64)num / max((F64)denom, 1.0));
-            s += buffer;            
-        }
+RasterProfile CudaRaster::getProfile(void)
+{
+  RasterProfile profile;
+
+  if (!m_module) {
+    return profile;
+  }
+
+  profile.profilingMode = m_pipeSpec.profilingMode;
+  profile.stats         = m_drawStats;
+  profile.atomics       = m_drawAtomics;
+
+  // Memory footprint.
+  int bytesPerSubtri  = (int)(sizeof(U8) + sizeof(CRTriangleHeader) + sizeof(CRTriangleData));
+  int bytesPerBinSeg  = (CR_BIN_SEG_SIZE + 2) * (int)sizeof(S32);
+  int bytesPerTileSeg = (CR_TILE_SEG_SIZE + 2) * (int)sizeof(S32);
+
+  profile.subtriBytes  = (S64)profile.atomics.numSubtris  * bytesPerSubtri;
+  profile.binSegBytes  = (S64)profile.atomics.numBinSegs  * bytesPerBinSeg;
+  profile.tileSegBytes = (S64)profile.atomics.numTileSegs * bytesPerTileSeg;
+
+  const Buffer* buffers[] = 
+  {
+    &m_triSubtris, &m_triHeader, &m_triData,
+    &m_binFirstSeg, &m_binTotal, &m_binSegData, &m_binSegNext, &m_binSegCount,
+    &m_activeTiles, &m_tileFirstSeg, &m_tileSegData, &m_tileSegNext, &m_tileSegCount,
+    &m_profData
+  };
+  for (int i = 0; i < (int)FW_ARRAY_SIZE(buffers); ++i) {
+    profile.allocatedBytes += buffers[i]->getSize();
+  }
+
+  // Host perf counters of the emulated stages.
+  for (int i = 0; i < Stage_Max; ++i)
+  {
+    if (!m_perf.isOpen() || !isEmulated((Stage)i)) {
+      continue;
     }
 
-    // ProfilingMode_Timers.
+    RasterProfile::PerfEntry e;
+    e.stage  = RasterSnapshot::getStageName((Stage)i);
+    e.sample = m_drawPerf[i];
+    profile.perf.push_back(e);
+  }
+
+  // ProfilingMode_Counters.
+  if (m_pipeSpec.profilingMode == ProfilingMode_Counters)
+  {
+    const S64*  counterPtr  = (m_drawProfData.empty()) ? NULL : (const S64*)&m_drawProfData[0];
+    int         numCounters = FW_ARRAY_SIZE(g_profCounters);
+    int         numWarps    = (int)m_drawProfData.size() / (numCounters * 64 * (int)sizeof(S64));
 
-    else if (m_pipeSpec.profilingMode == ProfilingMode_Timers)
+    for (int i = 0; i < numCounters; i++)
     {
-        const U32*  timerPtr    = (const U32*)m_profData.getPtr();
-        int         numTimers   = FW_ARRAY_SIZE(g_profTimers);
-        int         numWarps    = (int)m_profData.getSize() / (numTimers * 32 * (int)sizeof(U32));
+      S64 num = 0;
+      S64 denom = 0;
+      for (int j = 0; j < numWarps; j++)
+      for (int k = 0; k < 32; k++)
+      {
+        int idx = (j * numCounters + i) * 64 + k;
+        num += counterPtr[idx + 0];
+        denom += counterPtr[idx + 32];
+      }
 
-        std::vector<F64> timers;
-        for (int i = 0; i < numTimers; i++)
-        {
-            U64 launchTotal = 0;
-            for (int j = 0; j < numWarps; j++)
-            {
-                U32 warpTotal = 0;
-                for (int k = 0; k < 32; k++) {
-                  warpTotal += timerPtr[(j * numTimers + i) * 32 + k];
-                }
-                launchTotal += warpTotal;
-            }
-            timers.push_back((F64)launchTotal);
-        }
-        timers.push_back(0.0);
+      RasterProfile::Entry e;
+      e.name   = g_profCounters[i].name;
+      e.format = g_profCounters[i].format;
+      e.parent = -1;
+      e.num    = (F64)num;
+      e.denom  = (F64)denom;
+      e.value  = (F64)num / max((F64)denom, 1.0);
+      profile.counters.push_back(e);
+    }
+  }
 
-        s += "ProfilingMode_Timers\n";
-        s += "--------------------\n";
-        s += "\n";
-        for (int i = 0; i < numTimers; i++)
-        {
-          sprintf( buffer, g_profTimers[i].format, 
-                   timers[i] / max(timers[g_profTimers[i].parent], 1.0) * 100.0);
-          s += buffer;
+  // ProfilingMode_Timers.
+  else if (m_pipeSpec.profilingMode == ProfilingMode_Timers)
+  {
+    const U32*  timerPtr    = (m_drawProfData.empty()) ? NULL : (const U32*)&m_drawProfData[0];
+    int         numTimers   = FW_ARRAY_SIZE(g_profTimers);
+    int         numWarps    = (int)m_drawProfData.size() / (numTimers * 32 * (int)sizeof(U32));
+
+    std::vector<F64> timers;
+    for (int i = 0; i < numTimers; i++)
+    {
+      U64 launchTotal = 0;
+      for (int j = 0; j < numWarps; j++)
+      {
+        U32 warpTotal = 0;
+        for (int k = 0; k < 32; k++) {
+          warpTotal += timerPtr[(j * numTimers + i) * 32 + k];
         }
+        launchTotal += warpTotal;
+      }
+      timers.push_back((F64)launchTotal);
     }
+    timers.push_back(0.0);
 
-    else
+    for (int i = 0; i < numTimers; i++)
     {
-        s += "Invalid profiling mode!\n";
+      int parent = g_profTimers[i].parent;
+
+      RasterProfile::Entry e;
+      e.name   = g_profTimers[i].name;
+      e.format = g_profTimers[i].format;
+      e.parent = (parent < numTimers) ? parent : -1;
+      e.num    = timers[i];
+      e.denom  = timers[parent];
+      e.value  = timers[i] / max(timers[parent], 1.0) * 100.0;
+      profile.timers.push_back(e);
     }
+  }
 
-    s += "\n";
-    return s;
-  
-  /**/
-  
-  return "";
+  return profile;
+}
+
+//------------------------------------------------------------------------
+
+std::string CudaRaster::getProfilingInfo(void)
+{
+  return getProfile().toString();
 }
 
 //------------------------------------------------------------------------
@@ -505,17 +976,44 @@ void CudaRaster::setDebugParams(const DebugParams& p)
 
 //------------------------------------------------------------------------
 
-void CudaRaster::launchStages(void)
+void CudaRaster::setMaxFineWarps(int numWarps)
+{
+  FW_ASSERT(numWarps >= 0);
+  m_maxFineWarps = numWarps;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::setMaxChunkTris(int numTris)
+{
+  FW_ASSERT(numTris >= 0);
+  m_maxChunkTris = numTris;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::setParams(void)
 {
   assert( m_vertexBuffer->getSize() != 0 );
 
   // Set parameters.
   {
-    CRParams& p = *(CRParams*)m_module->getGlobal("c_crParams").getMutablePtrDiscard();
+    CRParams& p = *(CRParams*)m_module->getGlobal(g_keyCrParams).getMutablePtrDiscard();
 
     p.numTris           = m_numTris;
+    p.firstTri          = m_firstTri;
     p.vertexBuffer      = m_vertexBuffer->getCudaPtr(m_vertexOfs);
+    p.vertexLayout      = m_vertexLayout;
     p.indexBuffer       = m_indexBuffer->getCudaPtr(m_indexOfs);
+    p.indexFormat       = m_indexFormat;
+    p.topology          = m_topology;
+    p.numRestarts       = m_numRestarts;
+    p.restartTable      = (m_numRestarts) ? m_restartTable.getCudaPtr() : 0;
+    p.numDraws          = m_numDraws;
+    p.drawTable         = (m_numDraws) ? m_drawTable.getCudaPtr() : 0;
+    p.numInstances      = m_numInstances;
+    p.instanceTris      = (m_numInstances) ? m_instanceTris : m_numTris;
+    p.instanceBuffer    = (m_numInstances) ? m_instanceBuffer->getCudaPtr(m_instanceOfs) : 0;
 
     p.viewportWidth     = m_viewportSize.x;
     p.viewportHeight    = m_viewportSize.y;
@@ -557,25 +1055,15 @@ void CudaRaster::launchStages(void)
   }
   
 
-  // Initialize atomics.
-  {
-    CRAtomics& a        = *(CRAtomics*)m_module->getGlobal("g_crAtomics").getMutablePtrDiscard();
-    a.numSubtris        = m_numTris;
-    a.binCounter        = 0;
-    a.numBinSegs        = 0;
-    a.coarseCounter     = 0;
-    a.numTileSegs       = 0;
-    a.numActiveTiles    = 0;
-    a.fineCounter       = 0;
-  }
-
   // Bind textures and surfaces.
 
   CUdeviceptr vertexPtr = m_vertexBuffer->getCudaPtr(m_vertexOfs);
   S64 vertexSize = m_vertexBuffer->getSize() - m_vertexOfs;
 
 
-  m_module->setTexRef("t_vertexBuffer", vertexPtr, vertexSize, CU_AD_FORMAT_FLOAT, 4);
+  // Strided vertices are read from c_crParams.vertexBuffer instead.
+  if (!m_vertexLayout.stride)
+    m_module->setTexRef("t_vertexBuffer", vertexPtr, vertexSize, CU_AD_FORMAT_FLOAT, 4);
 
   m_module->setTexRef("t_triHeader", m_triHeader, CU_AD_FORMAT_UNSIGNED_INT32, 4);
 
@@ -584,112 +1072,253 @@ void CudaRaster::launchStages(void)
   m_module->setSurfRef("s_colorBuffer", m_colorBuffer->getCudaArray());
 
   m_module->setSurfRef("s_depthBuffer", m_depthBuffer->getCudaArray());
+}
 
+//------------------------------------------------------------------------
 
-  // Use 48KB of shmem and 16KB of L1.
-  bool oldPreferL1 = CudaModule::setPreferL1OverShared(false);
+void CudaRaster::launchStages(void)
+{
+  setParams();
 
-  // Launch triangleSetup().
-  CudaModule::checkError("cuEventRecord", cuEventRecord(m_evSetupBegin, NULL));
+  for (int i = 0; i < Stage_Max; ++i) {
+    RasterPerf::clearSample(m_perfStages[i]);
+  }
 
-  if (!m_debug.emulateTriangleSetup)
-  {
-    m_module->launchKernel( m_setupKernel,
-                            Vec2i(32, CR_SETUP_WARPS),
-                            (m_numTris - 1) / (CR_SETUP_WARPS * 32) + 1 );
+  if (m_trace) {
+    m_traceLaunch = m_trace->getTime();
   }
-  else
+
+  // Initialize atomics.
   {
-    emulateTriangleSetup();
-    m_triSubtris.getCudaPtr();
-    m_triHeader.getCudaPtr();
-    m_triData.getCudaPtr();
+    CRAtomics& a        = *(CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getMutablePtrDiscard();
+    a.numSubtris        = m_numTris;
+    a.binCounter        = 0;
+    a.numBinSegs        = 0;
+    a.coarseCounter     = 0;
+    a.numTileSegs       = 0;
+    a.numActiveTiles    = 0;
+    a.fineCounter       = 0;
   }
 
-  // Launch binRaster().
-  CudaModule::checkError("cuEventRecord", cuEventRecord(m_evBinBegin, NULL));
+  // Use 48KB of shmem and 16KB of L1.
+  bool oldPreferL1 = CudaModule::setPreferL1OverShared(false);
 
-  if (!m_debug.emulateBinRaster)
-  {
-    m_module->launchKernel( m_binKernel, 
-                            Vec2i(32, CR_BIN_WARPS), 
-                            Vec2i(CR_BIN_STREAMS_SIZE, 1));
+  for (int i = 0; i < Stage_Max; ++i) {
+    runStage((Stage)i);
   }
-  else
+
+  CudaModule::checkError("cuEventRecord", cuEventRecord(m_evFineEnd, NULL));
+
+  // Restore shmem/L1 size.
+  CudaModule::setPreferL1OverShared(oldPreferL1);
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::runStage(Stage stage)
+{
+  F64 traceBegin = (m_trace) ? m_trace->getTime() : 0.0;
+  bool emulated  = isEmulated(stage);
+  bool perf      = emulated && m_perf.isOpen();
+
+  CudaModule::checkError("cuEventRecord", cuEventRecord(getStageEvent(stage), NULL));
+
+  if (perf) {
+    m_perf.begin();
+  }
+
+  switch (stage)
   {
-    emulateBinRaster();
-    m_binFirstSeg.getCudaPtr();
-    m_binTotal.getCudaPtr();
-    m_binSegData.getCudaPtr();
-    m_binSegNext.getCudaPtr();
-    m_binSegCount.getCudaPtr();
+    case Stage_Setup: // triangleSetup()
+      if (!m_debug.emulateTriangleSetup)
+      {
+        m_module->launchKernel( m_setupKernel,
+                                Vec2i(32, CR_SETUP_WARPS),
+                                (m_numTris - 1) / (CR_SETUP_WARPS * 32) + 1 );
+      }
+      else
+      {
+        emulateTriangleSetup();
+        m_triSubtris.getCudaPtr();
+        m_triHeader.getCudaPtr();
+        m_triData.getCudaPtr();
+      }
+    break;
+
+    case Stage_Bin: // binRaster()
+      if (!m_debug.emulateBinRaster)
+      {
+        m_module->launchKernel( m_binKernel, 
+                                Vec2i(32, CR_BIN_WARPS), 
+                                Vec2i(CR_BIN_STREAMS_SIZE, 1));
+      }
+      else
+      {
+        emulateBinRaster();
+        m_binFirstSeg.getCudaPtr();
+        m_binTotal.getCudaPtr();
+        m_binSegData.getCudaPtr();
+        m_binSegNext.getCudaPtr();
+        m_binSegCount.getCudaPtr();
+      }
+    break;
+
+    case Stage_Coarse: // coarseRaster()
+      if (!m_debug.emulateCoarseRaster)
+      {
+        m_module->launchKernel( m_coarseKernel,
+                                Vec2i(32, CR_COARSE_WARPS),
+                                Vec2i(m_numSMs, 1));
+      }
+      else
+      {
+        emulateCoarseRaster();
+        m_activeTiles.getCudaPtr();
+        m_tileFirstSeg.getCudaPtr();
+        m_tileSegData.getCudaPtr();
+        m_tileSegNext.getCudaPtr();
+        m_tileSegCount.getCudaPtr();
+      }
+    break;
+
+    case Stage_Fine: // fineRaster()
+      if (!m_debug.emulateFineRaster)
+      {
+        m_module->launchKernel( m_fineKernel,
+                                Vec2i(32, m_numFineWarps),
+                                Vec2i(m_numSMs, 1));
+      }
+      else
+      {
+        emulateFineRaster();
+      }
+    break;
+
+    default:
+      FW_ASSERT(false);
+    break;
   }
 
-  // Launch coarseRaster().
-  CudaModule::checkError("cuEventRecord", cuEventRecord(m_evCoarseBegin, NULL));
+  if (perf) {
+    m_perf.end(m_perfStages[stage]);
+  }
 
-  if (!m_debug.emulateCoarseRaster)
+  if (m_trace)
   {
-    m_module->launchKernel( m_coarseKernel,
-                            Vec2i(32, CR_COARSE_WARPS),
-                            Vec2i(m_numSMs, 1));
+    m_trace->addSpan( m_traceHost, RasterSnapshot::getStageName(stage), 
+                      (emulated) ? "emulate" : "launch", traceBegin, m_trace->getTime());
   }
-  else
+}
+
+//------------------------------------------------------------------------
+
+F32 CudaRaster::launchStage(Stage stage)
+{
+  FW_ASSERT(stage >= 0 && stage < Stage_Max);
+
+  if (!m_module || !m_colorBuffer || !m_vertexBuffer || !m_indexBuffer)
+    fail("CudaRaster: State not set, see RasterSnapshot::apply()!");
+
+  setParams();
+
+  bool oldPreferL1 = CudaModule::setPreferL1OverShared(false);
+  runStage(stage);
+
+  CUevent stageEnd = getStageEvent(stage + 1);
+  CudaModule::checkError("cuEventRecord", cuEventRecord(stageEnd, NULL));
+  CudaModule::setPreferL1OverShared(oldPreferL1);
+
+  F32 time = 0.0f;
+  CudaModule::checkError("cuEventSynchronize", cuEventSynchronize(stageEnd));
+  CudaModule::checkError("cuEventElapsedTime", 
+                         cuEventElapsedTime(&time, getStageEvent(stage), stageEnd));
+  return time * 1.0e-3f;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::setTrace(RasterTrace* trace)
+{
+  // Register once per trace, re-attaching reuses the slots.
+  if (trace && trace != m_traceOwner)
   {
-    emulateCoarseRaster();
-    m_activeTiles.getCudaPtr();
-    m_tileFirstSeg.getCudaPtr();
-    m_tileSegData.getCudaPtr();
-    m_tileSegNext.getCudaPtr();
-    m_tileSegCount.getCudaPtr();
+    m_traceHost   = trace->addThread("CudaRaster host");
+    m_traceDevice = trace->addThread("CudaRaster device");
+    m_traceOwner  = trace;
   }
+  m_trace = trace;
+}
 
-  // Launch fineRaster().
-  CudaModule::checkError("cuEventRecord", cuEventRecord(m_evFineBegin, NULL));
+//------------------------------------------------------------------------
 
-  if (!m_debug.emulateFineRaster)
-  {
-    m_module->launchKernel( m_fineKernel,
-                            Vec2i(32, m_numFineWarps),
-                            Vec2i(m_numSMs, 1));
+void CudaRaster::traceDeviceStages(void)
+{
+  // CUDA events only give relative times => start at the host launch time.
+  CudaModule::sync(false);
+
+  F32 ms[Stage_Max + 1];
+  ms[0] = 0.0f;
+  for (int i = 1; i <= Stage_Max; ++i) {
+    CudaModule::checkError("cuEventElapsedTime", 
+                           cuEventElapsedTime(&ms[i], m_evSetupBegin, getStageEvent(i)));
+  }
+
+  for (int i = 0; i < Stage_Max; ++i) {
+    m_trace->addSpan( m_traceDevice, RasterSnapshot::getStageName((Stage)i), "device", 
+                      m_traceLaunch + ms[i] * 1.0e3, m_traceLaunch + ms[i + 1] * 1.0e3);
   }
-  else
+}
+
+//------------------------------------------------------------------------
+
+const HashKey<std::string>& CudaRaster::getAtomicsKey(void)
+{
+  return g_keyCrAtomics;
+}
+
+//------------------------------------------------------------------------
+
+bool CudaRaster::isEmulated(Stage stage) const
+{
+  switch (stage)
   {
-    emulateFineRaster();
+    case Stage_Setup:   return m_debug.emulateTriangleSetup;
+    case Stage_Bin:     return m_debug.emulateBinRaster;
+    case Stage_Coarse:  return m_debug.emulateCoarseRaster;
+    case Stage_Fine:    return m_debug.emulateFineRaster;
+    default:            return false;
   }
+}
 
-  CudaModule::checkError("cuEventRecord", cuEventRecord(m_evFineEnd, NULL));
+//------------------------------------------------------------------------
 
-  // Restore shmem/L1 size.
-  CudaModule::setPreferL1OverShared(oldPreferL1);
+bool CudaRaster::setPerfCounters(bool enable)
+{
+  if (!enable) {
+    m_perf.close();
+  } else if (!m_perf.isOpen()) {
+    m_perf.open();
+  }
+  return m_perf.isOpen();
 }
 
 //------------------------------------------------------------------------
 
-Vec3i CudaRaster::setupPleq(const Vec3f& values, const Vec2i& v0,
-                            const Vec2i& d1, const Vec2i& d2, 
-                            S32 area, int samplesLog2)
+CUevent CudaRaster::getStageEvent(int stage)
 {
-  F64 t0 = (F64)values.x;
-  F64 t1 = (F64)values.y - t0;
-  F64 t2 = (F64)values.z - t0;
-  F64 xc = (t1 * (F64)d2.y - t2 * (F64)d1.y) / (F64)area;
-  F64 yc = (t2 * (F64)d1.x - t1 * (F64)d2.x) / (F64)area;
-
-  Vec2i center = (v0 * 2 + min(d1.x, d2.x, 0) + max(d1.x, d2.x, 0)) >> (CR_SUBPIXEL_LOG2 - samplesLog2 + 1);
-  Vec2i vc = v0 - (center << (CR_SUBPIXEL_LOG2 - samplesLog2));
-
-  Vec3i pleq;
-  pleq.x = (U32)(S64)floor(xc * exp2(CR_SUBPIXEL_LOG2 - samplesLog2) + 0.5);
-  pleq.y = (U32)(S64)floor(yc * exp2(CR_SUBPIXEL_LOG2 - samplesLog2) + 0.5);
-  pleq.z = (U32)(S64)floor(t0 - xc * (F64)vc.x - yc * (F64)vc.y + 0.5);
-  pleq.z -= pleq.x * center.x + pleq.y * center.y;
-  return pleq;
+  switch (stage)
+  {
+    case Stage_Setup:   return m_evSetupBegin;
+    case Stage_Bin:     return m_evBinBegin;
+    case Stage_Coarse:  return m_evCoarseBegin;
+    case Stage_Fine:    return m_evFineBegin;
+    default:            return m_evFineEnd;
+  }
 }
 
 //------------------------------------------------------------------------
 
-bool CudaRaster::setupTriangle(
+int CudaRaster::setupTriangle(
     int triIdx,
     const Vec4f& v0, const Vec4f& v1, const Vec4f& v2,
     const Vec2f& b0, const Vec2f& b1, const Vec2f& b2,
@@ -707,7 +1336,7 @@ bool CudaRaster::setupTriangle(
     // Backfacing or degenerate => cull.
     S32 area = d1.x * d2.y - d1.y * d2.x;
     if (area <= 0)
-        return false;
+        return 1;
 
     // AABB falls between samples => cull.
     Vec2i lo = min(p0, p1, p2);
@@ -719,7 +1348,7 @@ bool CudaRaster::setupTriangle(
     Vec2i hic = (hi + bias) & -sampleSize;
 
     if (loc.x > hic.x || loc.y > hic.y)
-        return false;
+        return 2;
 
     // AABB covers 1 or 2 samples => cull if they are not covered.
     int diff = hic.x + hic.y - loc.x - loc.y;
@@ -736,7 +1365,7 @@ bool CudaRaster::setupTriangle(
         if (e0 < 0 || e1 < 0 || e2 < 0)
         {
             if (diff == 0)
-                return false;
+                return 2;
 
             hic -= bias;
             t0 = p0 - hic;
@@ -747,7 +1376,7 @@ bool CudaRaster::setupTriangle(
             e2 = (S64)t2.x * t0.y - (S64)t2.y * t0.x;
 
             if (e0 < 0 || e1 < 0 || e2 < 0)
-                return false;
+                return 2;
         }
     }
 
@@ -760,10 +1389,10 @@ bool CudaRaster::setupTriangle(
 
     Vec2i wv0 = p0 + (m_viewportSize << (CR_SUBPIXEL_LOG2 - 1));
     Vec2i zv0 = wv0 - (1 << (CR_SUBPIXEL_LOG2 - m_samplesLog2 - 1));
-    Vec3i zpleq = setupPleq(zvert, zv0, d1, d2, area, m_samplesLog2);
-    Vec3i wpleq = setupPleq(wvert, wv0, d1, d2, area, m_samplesLog2 + 1);
-    Vec3i upleq = setupPleq(uvert, wv0, d1, d2, area, m_samplesLog2 + 1);
-    Vec3i vpleq = setupPleq(vvert, wv0, d1, d2, area, m_samplesLog2 + 1);
+    Vec3i zpleq = setupPleq_ref(zvert, zv0, d1, d2, area, m_samplesLog2);
+    Vec3i wpleq = setupPleq_ref(wvert, wv0, d1, d2, area, m_samplesLog2 + 1);
+    Vec3i upleq = setupPleq_ref(uvert, wv0, d1, d2, area, m_samplesLog2 + 1);
+    Vec3i vpleq = setupPleq_ref(vvert, wv0, d1, d2, area, m_samplesLog2 + 1);
     U32 zmin = (U32)max(floor(min(zvert) + 0.5f) - CR_LERP_ERROR(m_samplesLog2), 0.0f);
     U32 zslope = (U32)min(((U64)abs(zpleq.x) + abs(zpleq.y)) * (m_numSamples / 2), (U64)FW_U32_MAX);
 
@@ -786,7 +1415,154 @@ bool CudaRaster::setupTriangle(
     U32 f12 = (U8)cover8x8_selectFlips(d2.x - d1.x, d2.y - d1.y);
     U32 f20 = (U8)cover8x8_selectFlips(-d2.x, -d2.y);
 	th.misc = (zmin & 0xfffff000u) | (f01 << 6) | (f12 << 2) | (f20 >> 2);
-    return true;
+    return 0;
+}
+
+//------------------------------------------------------------------------
+
+S32 CudaRaster::readIndex(const U8* indexBuffer, int i) const
+{
+    if (m_indexFormat == IndexFormat_U16)
+        return ((const U16*)indexBuffer)[i];
+    return ((const S32*)indexBuffer)[i];
+}
+
+//------------------------------------------------------------------------
+
+Vec3i CudaRaster::readTriangleIndices(const U8* indexBuffer, const CRDrawRange* draws, int triIdx) const
+{
+    if (m_topology != Topology_TriangleList)
+    {
+        std::vector<S32>::const_iterator it = std::upper_bound(m_restartHost.begin(), m_restartHost.end(), triIdx + 2);
+        int first = (it != m_restartHost.begin()) ? it[-1] + 1 : 0;
+        if (first > triIdx)
+            return Vec3i(-1);
+
+        if (m_topology == Topology_TriangleFan)
+            return Vec3i(readIndex(indexBuffer, first), readIndex(indexBuffer, triIdx + 1), readIndex(indexBuffer, triIdx + 2));
+        if (((triIdx - first) & 1) != 0)
+            return Vec3i(readIndex(indexBuffer, triIdx + 1), readIndex(indexBuffer, triIdx), readIndex(indexBuffer, triIdx + 2));
+        return Vec3i(readIndex(indexBuffer, triIdx), readIndex(indexBuffer, triIdx + 1), readIndex(indexBuffer, triIdx + 2));
+    }
+
+    int firstIndex = triIdx * 3;
+    int baseVertex = 0;
+
+    if (draws)
+    {
+        int lo = 0, hi = m_numDraws - 1;
+        while (lo < hi)
+        {
+            int mid = (lo + hi + 1) >> 1;
+            if (draws[mid].firstTri <= triIdx)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        firstIndex = draws[lo].firstIndex + (triIdx - draws[lo].firstTri) * 3;
+        baseVertex = draws[lo].baseVertex;
+    }
+
+    Vec3i vidx;
+    if (m_indexFormat == IndexFormat_U16)
+    {
+        const U16* idx16 = (const U16*)indexBuffer + firstIndex;
+        vidx = Vec3i(idx16[0], idx16[1], idx16[2]);
+    }
+    else
+        vidx = *(const Vec3i*)((const S32*)indexBuffer + firstIndex);
+
+    return vidx + baseVertex;
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::updateRestartTable(void)
+{
+    // Lists have no restarts. A batch draws lists over the current buffers,
+    // so leave a pending strip or fan table to its own draw.
+    if (m_topology == Topology_TriangleList)
+        return;
+
+    m_restartDirty = false;
+    m_restartHost.clear();
+    m_numRestarts = 0;
+    if (m_numTris == 0)
+        return;
+
+    const U8* indexBuffer = m_indexBuffer->getPtr(m_indexOfs);
+    for (int i = 0; i < m_numTris + 2; i++)
+        if ((U32)readIndex(indexBuffer, i) == m_restartIndex)
+            m_restartHost.push_back(i);
+
+    m_numRestarts = (S32)m_restartHost.size();
+    if (m_numRestarts)
+        m_restartTable.set(&m_restartHost[0], (S64)m_restartHost.size() * sizeof(S32));
+}
+
+//------------------------------------------------------------------------
+
+Vec4f CudaRaster::readVertexAttrib(const U8* vertexBuffer, int vertIdx, int attribIdx) const
+{
+    const CRVertexLayout& layout = m_vertexLayout;
+    if (!layout.stride)
+        return ((const Vec4f*)(vertexBuffer + (size_t)vertIdx * m_pipeSpec.vertexStructSize))[attribIdx];
+
+    if (attribIdx > layout.numVaryings)
+        return Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+
+    const CRVertexAttrib& a = (attribIdx) ? layout.varyings[attribIdx - 1] : layout.position;
+    return decodeVertexAttrib(vertexBuffer + (size_t)vertIdx * layout.stride, a.offset, a.format);
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::readFlattened(std::vector<U8>& vertices, std::vector<Vec3i>& indices)
+{
+    if (m_restartDirty)
+        updateRestartTable();
+
+    const U8*          vertexBuffer = m_vertexBuffer->getPtr(m_vertexOfs);
+    const U8*          indexBuffer  = m_indexBuffer->getPtr(m_indexOfs);
+    const CRDrawRange* draws        = (m_numDraws) ? (const CRDrawRange*)m_drawTable.getPtr() : NULL;
+
+    int vertexSize   = m_pipeSpec.vertexStructSize;
+    int numVerts     = (int)((m_vertexBuffer->getSize() - m_vertexOfs) / getVertexStride());
+    int numInstances = max(m_numInstances, 1);
+    int instanceTris = (m_numInstances) ? m_instanceTris : m_numTris;
+
+    vertices.resize((size_t)numVerts * vertexSize * numInstances);
+    indices.resize(m_numTris);
+
+    for (int instanceIdx = 0; instanceIdx < numInstances; instanceIdx++)
+    {
+        U8* dst = (vertices.empty()) ? NULL : &vertices[(size_t)numVerts * vertexSize * instanceIdx];
+        if (dst && m_vertexLayout.stride)
+        {
+            for (int i = 0; i < numVerts; i++)
+                for (int j = 0; j < vertexSize / (int)sizeof(Vec4f); j++)
+                    ((Vec4f*)(dst + (size_t)i * vertexSize))[j] = readVertexAttrib(vertexBuffer, i, j);
+        }
+        else if (dst)
+            memcpy(dst, vertexBuffer, (size_t)numVerts * vertexSize);
+
+        if (m_numInstances)
+        {
+            const Mat4f& m = ((const Mat4f*)m_instanceBuffer->getPtr(m_instanceOfs))[instanceIdx];
+            for (int i = 0; i < numVerts; i++)
+            {
+                Vec4f& clipPos = *(Vec4f*)(dst + (size_t)i * vertexSize);
+                clipPos = m * clipPos;
+            }
+        }
+
+        // Restarts become degenerate triangles, culled by TriangleSetup.
+        for (int triIdx = 0; triIdx < instanceTris; triIdx++)
+        {
+            Vec3i vidx = readTriangleIndices(indexBuffer, draws, triIdx);
+            indices[instanceIdx * instanceTris + triIdx] = max(vidx, 0) + numVerts * instanceIdx;
+        }
+    }
 }
 
 //------------------------------------------------------------------------
@@ -794,24 +1570,45 @@ bool CudaRaster::setupTriangle(
 void CudaRaster::emulateTriangleSetup(void)
 {
     const U8*               vertexBuffer    = (const U8*)m_vertexBuffer->getPtr(m_vertexOfs);
-    const Vec3i*            indexBuffer     = (const Vec3i*)m_indexBuffer->getPtr(m_indexOfs);
+    const U8*               indexBuffer     = (const U8*)m_indexBuffer->getPtr(m_indexOfs);
+    const CRDrawRange*      draws           = (m_numDraws) ? (const CRDrawRange*)m_drawTable.getPtr() : NULL;
+    const Mat4f*            instances       = (m_numInstances) ? (const Mat4f*)m_instanceBuffer->getPtr(m_instanceOfs) : NULL;
 
-    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal("g_crAtomics").getMutablePtr();
+    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getMutablePtr();
     U8*                     triSubtris      = (U8*)m_triSubtris.getMutablePtr();
     CRTriangleHeader*       triHeader       = (CRTriangleHeader*)m_triHeader.getMutablePtr();
     CRTriangleData*         triData         = (CRTriangleData*)m_triData.getMutablePtr();
 
+    CR_HOST_COUNT_INIT();
+
     for (int triIdx = 0; triIdx < m_numTris; triIdx++)
     {
-        const Vec3i& vidx = indexBuffer[triIdx];
+        int drawTriIdx  = m_firstTri + triIdx;
+        int instanceIdx = (instances) ? drawTriIdx / m_instanceTris : 0;
+        Vec3i vidx = readTriangleIndices(indexBuffer, draws, drawTriIdx - instanceIdx * m_instanceTris);
+        if (vidx.x < 0) // Primitive restart.
+        {
+            triSubtris[triIdx] = 0;
+            continue;
+        }
+
         int numVerts = 3;
         bool needToClip = true;
 
+        CR_HOST_COUNT(SetupViewportCull, 0, 1);
+        CR_HOST_COUNT(SetupBackfaceCull, 0, 1);
+        CR_HOST_COUNT(SetupBetweenPixelsCull, 0, 1);
+        CR_HOST_COUNT(SetupClipped, 0, 1);
+
         // Read vertices.
 
         Vec4f v[9];
         for (int i = 0; i < 3; i++)
-            v[i] = *(const Vec4f*)(vertexBuffer + vidx[i] * m_pipeSpec.vertexStructSize);
+            v[i] = readVertexAttrib(vertexBuffer, vidx[i], 0);
+
+        if (instances)
+            for (int i = 0; i < 3; i++)
+                v[i] = instances[instanceIdx] * v[i];
 
         // Outside view frustum => cull.
 
@@ -822,6 +1619,7 @@ void CudaRaster::emulateTriangleSetup(void)
             (v[0].z < -v[0].w && v[1].z < -v[1].w && v[2].z < -v[2].w) ||
             (v[0].z > +v[0].w && v[1].z > +v[1].w && v[2].z > +v[2].w))
         {
+            CR_HOST_COUNT(SetupViewportCull, 100, 0);
             numVerts = 0;
             needToClip = false;
         }
@@ -856,6 +1654,8 @@ void CudaRaster::emulateTriangleSetup(void)
 
         if (needToClip)
         {
+            CR_HOST_COUNT(SetupClipped, 100, 0);
+
             Vec4f v0 = v[0];
             Vec4f d1 = v[1] - v[0];
             Vec4f d2 = v[2] - v[0];
@@ -876,8 +1676,16 @@ void CudaRaster::emulateTriangleSetup(void)
         for (int i = 0; i < numVerts - 2; i++)
         {
             int subtriIdx = (numSubtris == 0) ? triIdx : min(atomics.numSubtris + numSubtris, m_maxSubtris - 1);
-            if (setupTriangle(subtriIdx, v[0], v[i + 1], v[i + 2], b[0], b[i + 1], b[i + 2], vidx))
+            int res = setupTriangle(subtriIdx, v[0], v[i + 1], v[i + 2], b[0], b[i + 1], b[i + 2], vidx);
+            if (res == 0)
                 numSubtris++;
+
+            // Only the unclipped path reports why it culled, as on the GPU.
+            if (!needToClip)
+            {
+                CR_HOST_COUNT(SetupBackfaceCull, (res == 1) ? 100 : 0, 0);
+                CR_HOST_COUNT(SetupBetweenPixelsCull, (res == 2) ? 100 : 0, 0);
+            }
         }
         triSubtris[triIdx] = (U8)numSubtris;
 
@@ -894,6 +1702,8 @@ void CudaRaster::emulateTriangleSetup(void)
             atomics.numSubtris += numSubtris;
         }
     }
+
+    CR_HOST_COUNT_MERGE();
 }
 
 //------------------------------------------------------------------------
@@ -905,13 +1715,15 @@ void CudaRaster::emulateBinRaster(void)
     const U8*               triSubtris      = (const U8*)m_triSubtris.getPtr();
     const CRTriangleHeader* triHeader       = (const CRTriangleHeader*)m_triHeader.getPtr();
 
-    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal("g_crAtomics").getMutablePtr();
+    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getMutablePtr();
     S32*                    binFirstSeg     = (S32*)m_binFirstSeg.getMutablePtr();
     S32*                    binTotal        = (S32*)m_binTotal.getMutablePtr();
     S32*                    binSegData      = (S32*)m_binSegData.getMutablePtr();
     S32*                    binSegNext      = (S32*)m_binSegNext.getMutablePtr();
     S32*                    binSegCount		= (S32*)m_binSegCount.getMutablePtr();
 
+    CR_HOST_COUNT_INIT();
+
     if (atomics.numSubtris > m_maxSubtris)
         return;
 
@@ -929,8 +1741,11 @@ void CudaRaster::emulateBinRaster(void)
 
     // Loop over batches.
 
-    for (int batchIdx = 0; batchIdx * m_binBatchSize < m_numTris; batchIdx++)
+    int numBatches = (m_numTris - 1) / m_binBatchSize + 1;
+    for (int batchIdx = 0; batchIdx < numBatches; batchIdx++)
     {
+        F64 traceBegin = (m_trace) ? m_trace->getTime() : 0.0;
+
         // Collect triangles.
 
         batchTris.clear();
@@ -939,6 +1754,7 @@ void CudaRaster::emulateBinRaster(void)
         for (int triIdx = batchStart; triIdx < batchEnd; triIdx++)
         {
     			int numSubtris = triSubtris[triIdx];
+          CR_HOST_COUNT(SetupSamplesPerTri, 0, (numSubtris != 0) ? 1 : 0);
           for (int subtriIdx = 0; subtriIdx < numSubtris; subtriIdx++) {
             batchTris.push_back((triIdx << 3) | ((numSubtris == 1) ? 7 : subtriIdx));
           }
@@ -964,6 +1780,16 @@ void CudaRaster::emulateBinRaster(void)
             Vec2i lo = v0 + min(0, d01, d02);
             Vec2i hi = v0 + max(0, d01, d02);
 
+            if (hostCounters.enabled)
+            {
+                int binLog = CR_BIN_LOG2 + CR_TILE_LOG2 + CR_SUBPIXEL_LOG2;
+                int binLoX = clamp(lo.x >> binLog, 0, m_sizeBins.x - 1);
+                int binLoY = clamp(lo.y >> binLog, 0, m_sizeBins.y - 1);
+                int binHiX = clamp(hi.x >> binLog, 0, m_sizeBins.x - 1);
+                int binHiY = clamp(hi.y >> binLog, 0, m_sizeBins.y - 1);
+                CR_HOST_COUNT(BinTriBBArea, (binHiX - binLoX + 1) * (binHiY - binLoY + 1), 1);
+            }
+
             // Check against each bin.
 
             for (int binIdx = 0; binIdx < m_numBins; binIdx++)
@@ -1020,7 +1846,16 @@ void CudaRaster::emulateBinRaster(void)
           }
           idxInSeg[i] = CR_BIN_SEG_SIZE;
         }
+
+        if (m_trace)
+        {
+            F64 traceEnd = m_trace->getTime();
+            m_trace->addSpan(m_traceHost, "batch", "bin", traceBegin, traceEnd, batchIdx);
+            m_trace->addCounter(m_traceHost, "batchQueue", traceEnd, numBatches - batchIdx - 1);
+        }
     }
+
+    CR_HOST_COUNT_MERGE();
 }
 
 //------------------------------------------------------------------------
@@ -1036,7 +1871,7 @@ void CudaRaster::emulateCoarseRaster(void)
     const S32*              binSegNext      = (const S32*)m_binSegNext.getPtr();
     const S32*              binSegCount     = (const S32*)m_binSegCount.getPtr();
 
-    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal("g_crAtomics").getMutablePtr();
+    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getMutablePtr();
     S32*                    activeTiles     = (S32*)m_activeTiles.getMutablePtr();
     S32*                    tileFirstSeg    = (S32*)m_tileFirstSeg.getMutablePtr();
     S32*                    tileSegData     = (S32*)m_tileSegData.getMutablePtr();
@@ -1044,8 +1879,9 @@ void CudaRaster::emulateCoarseRaster(void)
     S32*                    tileSegCount    = (S32*)m_tileSegCount.getMutablePtr();
 
     std::vector<S32> mergedTris;
-    std::vector<S32> currSeg(NULL, m_numTiles);
-    std::vector<S32> idxInSeg(NULL, m_numTiles);
+    std::vector<S32> currSeg(m_numTiles);
+    std::vector<S32> idxInSeg(m_numTiles);
+    CR_HOST_COUNT_INIT();
 
     if (atomics.numSubtris > m_maxSubtris || atomics.numBinSegs > m_maxBinSegs)
         return;
@@ -1061,6 +1897,7 @@ void CudaRaster::emulateCoarseRaster(void)
 
     for (int binIdx = 0; binIdx < m_numBins; binIdx++)
     {
+        F64 traceBegin = (m_trace) ? m_trace->getTime() : 0.0;
         int binTileX = (binIdx % m_sizeBins.x) * CR_BIN_SIZE;
         int binTileY = (binIdx / m_sizeBins.x) * CR_BIN_SIZE;
 
@@ -1093,6 +1930,8 @@ void CudaRaster::emulateCoarseRaster(void)
           }
         }
 
+        CR_HOST_COUNT(CoarseBins, (!mergedTris.empty() || m_deferredClear) ? 1 : 0, 0);
+
         // Rasterize each triangle into tiles.
         for (int mergedIdx = 0; mergedIdx < mergedTris.size(); ++mergedIdx)
         {
@@ -1162,7 +2001,17 @@ void CudaRaster::emulateCoarseRaster(void)
               // Append to the current segment.
               tileSegData[currSeg[si] * CR_TILE_SEG_SIZE + idxInSeg[si]] = triIdx;
               idxInSeg[si]++;
+              CR_HOST_COUNT(CoarseEmitsPerTri, 1, 0);
             }
+
+            CR_HOST_COUNT(CoarseEmitsPerTri, 0, 1);
+        }
+
+        if (m_trace)
+        {
+            F64 traceEnd = m_trace->getTime();
+            m_trace->addSpan(m_traceHost, "bin", "coarse", traceBegin, traceEnd, binIdx);
+            m_trace->addCounter(m_traceHost, "binQueue", traceEnd, m_numBins - binIdx - 1);
         }
     }
 
@@ -1177,6 +2026,8 @@ void CudaRaster::emulateCoarseRaster(void)
 		if (idxInSeg[i] != CR_TILE_SEG_SIZE)
 			tileSegCount[currSeg[i]] = idxInSeg[i];
     }
+
+    CR_HOST_COUNT_MERGE();
 }
 
 //------------------------------------------------------------------------
@@ -1189,7 +2040,7 @@ void CudaRaster::emulateFineRaster(void)
     const CRTriangleHeader* triHeader       = (const CRTriangleHeader*)m_triHeader.getPtr();
     const CRTriangleData*   triData         = (const CRTriangleData*)m_triData.getPtr();
 
-    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal("g_crAtomics").getMutablePtr();
+    CRAtomics&              atomics         = *(CRAtomics*)m_module->getGlobal(g_keyCrAtomics).getMutablePtr();
     const S32*              activeTiles     = (S32*)m_activeTiles.getPtr();
     const S32*              tileFirstSeg    = (S32*)m_tileFirstSeg.getPtr();
     const S32*              tileSegData     = (S32*)m_tileSegData.getPtr();
@@ -1199,8 +2050,9 @@ void CudaRaster::emulateFineRaster(void)
     bool                    enableBlend     = (std::string(m_pipeSpec.blendShaderName) == "BlendSrcOver");
 
     std::vector<S32> mergedTris;
-    std::vector<U32> colorBuffer(NULL, m_sizePixels.y * m_sizePixels.x * m_numSamples);
-    std::vector<U32> depthBuffer(NULL, m_sizePixels.y * m_sizePixels.x * m_numSamples);
+    std::vector<U32> colorBuffer(m_sizePixels.y * m_sizePixels.x * m_numSamples);
+    std::vector<U32> depthBuffer(m_sizePixels.y * m_sizePixels.x * m_numSamples);
+    CR_HOST_COUNT_INIT();
 
     if (atomics.numSubtris > m_maxSubtris || atomics.numBinSegs > m_maxBinSegs || atomics.numTileSegs > m_maxTileSegs)
         return;
@@ -1216,31 +2068,16 @@ void CudaRaster::emulateFineRaster(void)
     }
     else // Otherwise => download framebuffer.
     {
-      CUDA_MEMCPY2D copy;
-      copy.srcXInBytes    = 0;
-      copy.srcY           = 0;
-      copy.srcMemoryType  = CU_MEMORYTYPE_ARRAY;
-      copy.srcArray       = m_colorBuffer->getCudaArray();
-      copy.dstXInBytes    = 0;
-      copy.dstY           = 0;
-      copy.dstMemoryType  = CU_MEMORYTYPE_HOST;
-      copy.dstHost        = &colorBuffer[0];
-      copy.dstPitch       = m_sizePixels.x * m_numSamples * sizeof(U32);
-      copy.WidthInBytes   = m_sizePixels.x * m_numSamples * sizeof(U32);
-      copy.Height         = m_sizePixels.y;
-
-      CudaModule::checkError("cuMemcpy2D", cuMemcpy2D(&copy));
-
-      copy.srcArray       = m_depthBuffer->getCudaArray();
-      copy.dstHost        = &depthBuffer[0];
-
-      CudaModule::checkError("cuMemcpy2D", cuMemcpy2D(&copy));
+      m_colorBuffer->download(&colorBuffer[0]);
+      m_depthBuffer->download(&depthBuffer[0]);
     }
 
     // Process each tile-triangle intersection.
 
     for (int activeIdx = 0; activeIdx<atomics.numActiveTiles; ++activeIdx)
     {
+      F64 traceBegin = (m_trace) ? m_trace->getTime() : 0.0;
+      F64 tileBegin  = (m_heatmap) ? Timer::queryTime() : 0.0;
       int tileIdx = activeTiles[activeIdx];
       Vec2i tilePixelPos = Vec2i( tileIdx % m_sizeTiles.x, 
                                   tileIdx / m_sizeTiles.x) * CR_TILE_SIZE;
@@ -1252,6 +2089,8 @@ void CudaRaster::emulateFineRaster(void)
           mergedTris.push_back(tileSegData[segIdx * CR_TILE_SEG_SIZE + i]);
         }
       }
+      CR_HOST_COUNT(FineTriPerTile, (S64)mergedTris.size(), 1);
+      CR_HOST_COUNT(FineFragPerTile, 0, 1);
 
       // Rasterize each triangle into framebuffer.
       for (int mergedIdx = 0; mergedIdx < mergedTris.size(); ++mergedIdx)
@@ -1266,9 +2105,9 @@ void CudaRaster::emulateFineRaster(void)
         const CRTriangleHeader& th  = triHeader[dataIdx];
         const CRTriangleData&   td  = triData[dataIdx];
         
-        const GouraudVertex& vd0 = *(const GouraudVertex*)(vertexBuffer + td.vi0 * m_pipeSpec.vertexStructSize);
-        const GouraudVertex& vd1 = *(const GouraudVertex*)(vertexBuffer + td.vi1 * m_pipeSpec.vertexStructSize);
-        const GouraudVertex& vd2 = *(const GouraudVertex*)(vertexBuffer + td.vi2 * m_pipeSpec.vertexStructSize);
+        Vec4f col0 = readVertexAttrib(vertexBuffer, td.vi0, 1);
+        Vec4f col1 = readVertexAttrib(vertexBuffer, td.vi1, 1);
+        Vec4f col2 = readVertexAttrib(vertexBuffer, td.vi2, 1);
 
         Vec2i v0 = Vec2i(th.v0x, th.v0y) + m_viewportSize * (CR_SUBPIXEL_SIZE / 2);
         Vec2i v1 = Vec2i(th.v1x, th.v1y) + m_viewportSize * (CR_SUBPIXEL_SIZE / 2);
@@ -1289,6 +2128,8 @@ void CudaRaster::emulateFineRaster(void)
         if (d1.y > 0 || (d1.y == 0 && d1.x <= 0)) b1--;
         if (d2.y > 0 || (d2.y == 0 && d2.x <= 0)) b2--;
 
+        CR_HOST_COUNT(FineFragPerTri, 0, 1);
+
         // Check against each pixel.
 
         for (int pixelIdx = 0; pixelIdx < CR_TILE_SQR; pixelIdx++)
@@ -1332,6 +2173,12 @@ void CudaRaster::emulateFineRaster(void)
               writeMask |= 1 << i;
           }
 
+          CR_HOST_COUNT(FineFragPerTile, 1, 0);
+          CR_HOST_COUNT(FineFragPerTri, 1, 0);
+          CR_HOST_COUNT(SetupSamplesPerTri, popc32(coverMask), 0);
+          CR_HOST_COUNT(FineZKill, (coverMask != 0 && writeMask == 0) ? 100 : 0, 1);
+          CR_HOST_COUNT(FineMSAAKill, (coverMask == 0) ? 100 : 0, 1);
+
           // No samples to write => skip shader & ROP.
 
           if (writeMask == 0)
@@ -1341,7 +2188,7 @@ void CudaRaster::emulateFineRaster(void)
 
           Vec4f color;
           if ((m_pipeSpec.renderModeFlags & RenderModeFlag_EnableLerp) == 0)
-              color = vd2.color;
+              color = col2;
           else
           {
               int ctr = selectMSAACentroid(m_samplesLog2, coverMask);
@@ -1350,7 +2197,7 @@ void CudaRaster::emulateFineRaster(void)
               F32 w = 1.0f / (F32)(td.wx * sampleX + td.wy * sampleY + td.wb);
               F32 u = w * (F32)(td.ux * sampleX + td.uy * sampleY + td.ub);
               F32 v = w * (F32)(td.vx * sampleX + td.vy * sampleY + td.vb);
-              color = vd0.color + (vd1.color - vd0.color) * u + (vd2.color - vd0.color) * v;
+              color = col0 + (col1 - col0) * u + (col2 - col0) * v;
           }
 
           // Blend.
@@ -1376,30 +2223,44 @@ void CudaRaster::emulateFineRaster(void)
           }
         }
       }
+
+      if (m_heatmap) {
+        m_heatmap->setFineTime(tileIdx, (F32)(Timer::queryTime() - tileBegin));
+      }
+
+      if (m_trace)
+      {
+        F64 traceEnd = m_trace->getTime();
+        m_trace->addSpan(m_traceHost, "tile", "fine", traceBegin, traceEnd, tileIdx);
+        m_trace->addCounter(m_traceHost, "tileQueue", traceEnd, atomics.numActiveTiles - activeIdx - 1);
+      }
     }
 
+    CR_HOST_COUNT_MERGE();
+
     // Upload framebuffer.
-    {
-        CUDA_MEMCPY2D copy;
-        copy.srcXInBytes    = 0;
-        copy.srcY           = 0;
-        copy.srcMemoryType  = CU_MEMORYTYPE_HOST;
-        copy.srcHost        = &colorBuffer[0];
-        copy.srcPitch       = m_sizePixels.x * m_numSamples * sizeof(U32);
-        copy.dstXInBytes    = 0;
-        copy.dstY           = 0;
-        copy.dstMemoryType  = CU_MEMORYTYPE_ARRAY;
-        copy.dstArray       = m_colorBuffer->getCudaArray();
-        copy.WidthInBytes   = m_sizePixels.x * m_numSamples * sizeof(U32);
-        copy.Height         = m_sizePixels.y;
-
-        CudaModule::checkError("cuMemcpy2D", cuMemcpy2D(&copy));
-
-        copy.srcHost        = &depthBuffer[0];
-        copy.dstArray       = m_depthBuffer->getCudaArray();
-
-        CudaModule::checkError("cuMemcpy2D", cuMemcpy2D(&copy));
-    }
+    m_colorBuffer->upload(&colorBuffer[0]);
+    m_depthBuffer->upload(&depthBuffer[0]);
+}
+
+//------------------------------------------------------------------------
+
+void CudaRaster::mergeHostCounters(const S64* num, const S64* denom)
+{
+  // Counters are only read back in ProfilingMode_Counters, see getProfile().
+  if (m_pipeSpec.profilingMode != ProfilingMode_Counters) {
+    return;
+  }
+
+  // Accumulate into the first lane of the first warp.
+  S64* counterPtr  = (S64*)m_profData.getMutablePtr();
+  int  numCounters = FW_ARRAY_SIZE(g_profCounters);
+
+  for (int i = 0; i < numCounters; ++i)
+  {
+    counterPtr[i * 64 + 0]  += num[i];
+    counterPtr[i * 64 + 32] += denom[i];
+  }
 }
 
 } // namespace FW
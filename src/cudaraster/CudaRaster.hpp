@@ -26,22 +26,46 @@
 #define CUDARASTER_CUDARASTER_HPP_
 
 #include <string>
+#include <vector>
 #include <gpu/Buffer.hpp>
 #include <gpu/CudaModule.hpp>
 
 #include "CudaSurface.hpp"
+#include "RasterPerf.hpp"
 #include "cuda/PixelPipe.hpp"
 #include "cuda/PrivateDefs.hpp"
 
 
 namespace FW {
+
+class RasterCapture;
+class RasterHeatmap;
+class RasterHistory;
+class RasterProfile;
+class RasterSnapshot;
+class RasterTrace;
+
 //------------------------------------------------------------------------
 // CudaRaster host-side public interface.
 //------------------------------------------------------------------------
 
 class CudaRaster
 {
+  friend class RasterCapture;
+  friend class RasterHeatmap;
+  friend class RasterSnapshot;
+
   public:
+    enum Stage
+    {
+      Stage_Setup = 0,  // TriangleSetup.
+      Stage_Bin,        // BinRaster.
+      Stage_Coarse,     // CoarseRaster.
+      Stage_Fine,       // FineRaster.
+
+      Stage_Max
+    };
+
     struct Stats // Statistics for the previous call to drawTriangles().
     {
       F32 setupTime;  // Seconds spent in TriangleSetup.
@@ -50,6 +74,50 @@ class CudaRaster
       F32 fineTime;   // Seconds spent in FineRaster.
     };
 
+    struct DrawRange // One mesh of drawTriangles(ranges, numRanges).
+    {
+      Buffer* vertexBuffer;
+      S64     vertexOfs;        // Multiple of the vertex struct size.
+      Buffer* indexBuffer;
+      S64     indexOfs;
+      S32     numTris;
+      S32     indexFormat;      // IndexFormat_XXX, the same for every range.
+
+      DrawRange(void)
+        : vertexBuffer(NULL), vertexOfs(0), indexBuffer(NULL), indexOfs(0), 
+          numTris(0), indexFormat(IndexFormat_U32)
+      {}
+    };
+
+    struct VertexLayout // Strided vertex input, see setVertexLayout().
+    {
+      struct Attrib
+      {
+        S32 offset;             // Bytes from the start of the vertex, multiple of 4.
+        S32 format;             // VertexFormat_XXX in PixelPipe.hpp.
+      };
+
+      S32     stride;           // Bytes per vertex, multiple of 4.
+      Attrib  position;         // Read as clipPos.
+      S32     numVaryings;      // Up to CR_MAX_VARYINGS, others read as (0, 0, 0, 1).
+      Attrib  varyings[CR_MAX_VARYINGS];
+
+      VertexLayout(S32 stride_ = 0, S32 positionOfs = 0, S32 positionFormat = VertexFormat_F32x4)
+        : stride(stride_), numVaryings(0)
+      {
+        position.offset = positionOfs;
+        position.format = positionFormat;
+      }
+
+      void addVarying(S32 offset, S32 format)
+      {
+        FW_ASSERT(numVaryings < CR_MAX_VARYINGS);
+        varyings[numVaryings].offset = offset;
+        varyings[numVaryings].format = format;
+        numVaryings++;
+      }
+    };
+
     struct DebugParams // Host-side emulation of individual stages, for debugging purposes.
     {
       bool emulateTriangleSetup;
@@ -81,7 +149,28 @@ class CudaRaster
     S64     m_vertexOfs;
     Buffer* m_indexBuffer;
     S64     m_indexOfs;
+    S32     m_indexFormat;
+    S32     m_topology;
+    U32     m_restartIndex;
     S32     m_numTris;
+    S32     m_firstTri;       // Of the current chunk, m_numTris long.
+    S32     m_maxChunkTris;   // Requested by setMaxChunkTris(), 0 = no limit.
+    S32     m_numDraws;       // > 0 during a batch, see m_drawTable.
+    CRVertexLayout m_vertexLayout;  // stride = 0 => ShadedVertexSubclass.
+
+    Buffer  m_drawVertices;   // Gathered by drawTriangles(ranges).
+    Buffer  m_drawIndices;
+    Buffer  m_drawTable;      // CRDrawRange per range.
+
+    Buffer  m_restartTable;   // Positions of restart indices, see CRParams.
+    std::vector<S32> m_restartHost;  // Same, searched by the host paths.
+    S32     m_numRestarts;
+    bool    m_restartDirty;   // Scan the indices on the next draw.
+
+    Buffer* m_instanceBuffer;
+    S64     m_instanceOfs;
+    S32     m_numInstances;   // > 0 during drawTrianglesInstanced().
+    S32     m_instanceTris;   // m_numTris = m_instanceTris * m_numInstances.
 
     // Surfaces.
     Vec2i   m_viewportSize;
@@ -96,6 +185,7 @@ class CudaRaster
 
     // Pixel pipe.
     CudaModule*    m_module;
+    std::string    m_pipeName;
     CUfunction     m_setupKernel;
     CUfunction     m_binKernel;
     CUfunction     m_coarseKernel;
@@ -104,6 +194,7 @@ class CudaRaster
     
     S32 m_numSMs;
     S32 m_numFineWarps;
+    S32 m_maxFineWarps;   // Requested by setMaxFineWarps(), 0 = no limit.
 
 
     // Buffers.
@@ -139,6 +230,26 @@ class CudaRaster
     
     DebugParams m_debug;
     
+    RasterCapture* m_capture;
+    RasterSnapshot* m_snapshot;
+    RasterHeatmap* m_heatmap;
+    RasterHistory* m_history;
+
+    RasterPerf  m_perf;
+    RasterPerf::Sample m_perfStages[Stage_Max];   // Last launchStages().
+
+    // Summed over the chunks of the last drawTriangles(), see addChunkStats().
+    Stats       m_drawStats;
+    CRAtomics   m_drawAtomics;
+    RasterPerf::Sample m_drawPerf[Stage_Max];
+    std::vector<U8> m_drawProfData;   // Same layout as m_profData.
+
+    RasterTrace* m_trace;
+    RasterTrace* m_traceOwner; // Trace holding the slots below, kept across setTrace(NULL).
+    S32     m_traceHost;      // Thread slots in m_traceOwner.
+    S32     m_traceDevice;
+    F64     m_traceLaunch;    // Host time of the last launchStages().
+    
 
   public:
     CudaRaster(void);
@@ -154,26 +265,121 @@ class CudaRaster
 
     // See CR_DEFINE_PIXEL_PIPE() in PixelPipe.hpp.
     void setPixelPipe(CudaModule* module, const std::string& name);
+    const PixelPipeSpec& getPipeSpec(void) const { return m_pipeSpec; }
     void setVertexBuffer(Buffer* buf, S64 ofs);
-    void setIndexBuffer(Buffer* buf, S64 ofs, int numTris);
+    // Read vertices through 'layout' instead of ShadedVertexSubclass, e.g.
+    // an interleaved buffer wrapped with Buffer::wrapCPU() (NULL = reset).
+    void setVertexLayout(const VertexLayout* layout);
+    S32  getVertexStride(void) const;   // Bytes per vertex of the vertex buffer.
+    // 'format' is one of IndexFormat_XXX in PixelPipe.hpp.
+    void setIndexBuffer(Buffer* buf, S64 ofs, int numTris, int format = IndexFormat_U32);
+    // Strip or fan of 'numIndices' (Topology_XXX), started over after each 
+    // index equal to 'restartIndex' in the index format (0xFFFF for U16 by
+    // default). Scanned for restarts on the next draw, set again after 
+    // modifying the indices.
+    void setIndexBuffer(Buffer* buf, S64 ofs, int numIndices, int format, int topology, U32 restartIndex = ~0u);
+    int  getIndexFormat(void) const { return m_indexFormat; }
+    int  getTopology(void) const { return m_topology; }
+    S64  getIndexBytes(void) const;   // Size of the current index range.
     
-    // Draw all triangles specified by the current index buffer.
+    // Draw all triangles specified by the current index buffer. Draws that
+    // do not fit CR_MAXSUBTRIS_SIZE are split into chunks, drawn in order.
     void drawTriangles(void);
 
+    // Also split draws into chunks of at most 'numTris' triangles, which 
+    // bounds the size of the internal buffers (0 = no limit).
+    void setMaxChunkTris(int numTris);
+
+    // Draw several meshes in one pass of the four stages, in order. Ranges
+    // sharing a vertex or index buffer use it in place, others are gathered
+    // into internal buffers. The vertex and index buffers set above are 
+    // left untouched, and an empty list draws nothing.
+    void drawTriangles(const DrawRange* ranges, int numRanges);
+
+    // Draw the triangles of the current index buffer 'numInstances' times.
+    // TriangleSetup transforms the clipPos of instance i by the i-th Mat4f
+    // of the instance buffer; fragment shaders get i as m_instanceIdx.
+    void setInstanceBuffer(Buffer* buf, S64 ofs);
+    void drawTrianglesInstanced(int numInstances);
+
     Stats getStats (void);
+
+    // Keep the Stats and CRAtomics of the last 'numFrames' draws (0 = off).
+    // getHistory() is NULL when off.
+    void setHistorySize(int numFrames);
+    const RasterHistory* getHistory(void) const { return m_history; }
+    void resetHistory(void);
     
     // See CR_PROFILING_MODE in PixelPipe.hpp.
-    std::string getProfilingInfo(void);
+    RasterProfile getProfile(void);
+    std::string getProfilingInfo(void);   // getProfile().toString()
     
     void setDebugParams(const DebugParams& p);
 
-  private:
-    void launchStages(void);
+    // Limit the warps per SM used by FineRaster (0 = as many as the pixel 
+    // pipe allows, up to CR_FINE_MAX_WARPS). Takes effect on setPixelPipe().
+    void setMaxFineWarps(int numWarps);
+    int  getNumFineWarps(void) const { return m_numFineWarps; }
+
+    // Record every subsequent drawTriangles() into 'capture' (NULL to stop).
+    void setCapture(RasterCapture* capture) { m_capture = capture; }
+    RasterCapture* getCapture(void) const { return m_capture; }
+
+    // Record the state before one stage of the next drawTriangles() into 
+    // 'snapshot', see RasterSnapshot. Detached once recorded.
+    void setSnapshot(RasterSnapshot* snapshot) { m_snapshot = snapshot; }
+
+    // Record the per-tile load of every subsequent drawTriangles() into 
+    // 'heatmap' (NULL to stop), see RasterHeatmap.
+    void setHeatmap(RasterHeatmap* heatmap) { m_heatmap = heatmap; }
+    RasterHeatmap* getHeatmap(void) const { return m_heatmap; }
+
+    // Read hardware counters around each emulated stage (DebugParams), 
+    // reported by getProfile(). Counters belong to the calling thread, 
+    // which must also issue the draws. Returns false if none is available.
+    bool setPerfCounters(bool enable);
 
-    Vec3i setupPleq(const Vec3f& values, const Vec2i& v0, const Vec2i& d1, 
-                    const Vec2i& d2, S32 area, int samplesLog2);
+    // Record draws, stages and emulated bin / tile tasks into 'trace' (NULL
+    // to stop). Waits for each draw to complete to read the stage times.
+    void setTrace(RasterTrace* trace);
+    RasterTrace* getTrace(void) const { return m_trace; }
 
-    bool setupTriangle( int triIdx, 
+    // Run a single stage on the state restored by RasterSnapshot::apply() 
+    // and return its time in seconds. getStats() is left untouched.
+    F32 launchStage(Stage stage);
+
+  private:
+    bool drawChunk(void);   // false => too many subtriangles, split it.
+    void allocateBuffers(void);
+    void setParams(void);
+    void launchStages(void);
+    void runStage(Stage stage);
+    CUevent getStageEvent(int stage);   // Stage_Max => end of FineRaster.
+    bool isEmulated(Stage stage) const;
+    void traceDeviceStages(void);
+    void clearDrawStats(void);
+    void addChunkStats(void);
+
+    // Key of g_crAtomics in m_module, shared with RasterSnapshot and RasterHeatmap.
+    static const HashKey<std::string>& getAtomicsKey(void);
+
+    // Indices of triangle 'triIdx' of the current draw or batch, rebased.
+    // x = -1 if a strip or fan restarts within the triangle.
+    S32   readIndex(const U8* indexBuffer, int i) const;
+    Vec3i readTriangleIndices(const U8* indexBuffer, const CRDrawRange* draws, int triIdx) const;
+    void  updateRestartTable(void);
+
+    // Attribute 'attribIdx' of a vertex, 0 = clipPos, i = varying i - 1.
+    Vec4f readVertexAttrib(const U8* vertexBuffer, int vertIdx, int attribIdx) const;
+
+    // Current batch, instanced draw, strip, fan or strided vertices as a 
+    // triangle list of ShadedVertexSubclass, for RasterCapture and 
+    // RasterSnapshot. Instances get their own transformed vertices.
+    bool  isFlattened(void) const { return m_numDraws > 0 || m_numInstances > 0 || m_vertexLayout.stride > 0 || m_topology != Topology_TriangleList; }
+    void  readFlattened(std::vector<U8>& vertices, std::vector<Vec3i>& indices);
+
+    // 0 = success, 1 = backfacing or degenerate, 2 = between samples.
+    int setupTriangle(  int triIdx, 
                         const Vec4f& v0, const Vec4f& v1, const Vec4f& v2, 
                         const Vec2f& b0, const Vec2f& b1, const Vec2f& b2,
                         const Vec3i& vidx);
@@ -183,6 +389,9 @@ class CudaRaster
     void emulateCoarseRaster(void);
     void emulateFineRaster(void);
 
+    // Add the counters of an emulated stage to m_profData, see CR_HOST_PROFILING.
+    void mergeHostCounters(const S64* num, const S64* denom);
+
   private:
     CudaRaster (const CudaRaster&);             // forbidden
     CudaRaster& operator= (const CudaRaster&);  // forbidden
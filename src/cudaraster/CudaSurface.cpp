@@ -25,7 +25,10 @@
 #include "CudaSurface.hpp"
 
 #include <cassert>
+#include <cstring>
+#if FW_USE_GL
 #include <cudaGL.h>             // CUDA driver API OpenGL interoperability
+#endif
 #include "base/Defs.hpp"
 #include "gpu/CudaModule.hpp"
 
@@ -37,8 +40,11 @@ namespace FW {
 //------------------------------------------------------------------------
 
 CudaSurface::CudaSurface(const Vec2i& size, Format format, int numSamples)
-  : m_isMapped  (false),
-    m_cudaArray (0)
+  : m_glTexture     (0),
+    m_cudaResource  (NULL),
+    m_isMapped      (false),
+    m_cudaArray     (0),
+    m_ownsArray     (false)
 {
   // Check parameters.
   if (min(size) <= 0) {
@@ -61,6 +67,32 @@ CudaSurface::CudaSurface(const Vec2i& size, Format format, int numSamples)
     fail("CudaSurface: numSamples must be a power of two!");
   }
 
+  // Initialize.
+  m_size        = size;
+  m_roundedSize = (size + CR_TILE_SIZE - 1) & -CR_TILE_SIZE;
+  m_textureSize = m_roundedSize * Vec2i(numSamples, 1);
+  m_format      = format;
+  m_numSamples  = numSamples;
+
+  // Headless => plain CUDA array with surface load/store.
+  CudaModule::staticInit();
+  
+  if (!CudaModule::isGLInterop())
+  {
+    CUDA_ARRAY3D_DESCRIPTOR desc;
+    desc.Width       = m_textureSize.x;
+    desc.Height      = m_textureSize.y;
+    desc.Depth       = 0;
+    desc.Format      = (format == FORMAT_RGBA8) ? CU_AD_FORMAT_UNSIGNED_INT8 : CU_AD_FORMAT_UNSIGNED_INT32;
+    desc.NumChannels = (format == FORMAT_RGBA8) ? 4 : 1;
+    desc.Flags       = CUDA_ARRAY3D_SURFACE_LDST;
+
+    CudaModule::checkError("cuArray3DCreate", cuArray3DCreate(&m_cudaArray, &desc));
+    m_ownsArray = true;
+    return;
+  }
+
+#if FW_USE_GL
   // Identify format.
   int glInternal, glFormat, glType;
 
@@ -83,13 +115,6 @@ CudaSurface::CudaSurface(const Vec2i& size, Format format, int numSamples)
     return;
   }
 
-  // Initialize.
-  m_size        = size;
-  m_roundedSize = (size + CR_TILE_SIZE - 1) & -CR_TILE_SIZE;
-  m_textureSize = m_roundedSize * Vec2i(numSamples, 1);
-  m_format      = format;
-  m_numSamples  = numSamples;
-
   // Create GL texture.
   glGenTextures(1, &m_glTexture);
   glBindTexture(GL_TEXTURE_2D, m_glTexture);
@@ -100,29 +125,36 @@ CudaSurface::CudaSurface(const Vec2i& size, Format format, int numSamples)
   GLContext::checkErrors();
 
   // Register to CUDA.
-  CudaModule::staticInit(); // 
-
   CUresult res = cuGraphicsGLRegisterImage( &m_cudaResource, 
                                             m_glTexture, 
                                             GL_TEXTURE_2D, 
                                             CU_GRAPHICS_REGISTER_FLAGS_SURFACE_LDST);
   CudaModule::checkError("cuGraphicsGLRegisterImage", res);
+#endif
 }
 
 //------------------------------------------------------------------------
 
 CudaSurface::~CudaSurface(void)
 {
+  if (m_ownsArray)
+  {
+    cuArrayDestroy(m_cudaArray);
+    return;
+  }
+
+#if FW_USE_GL
   getGLTexture(); // unmap
   cuGraphicsUnregisterResource(m_cudaResource);
   glDeleteTextures(1, &m_glTexture);
+#endif
 }
 
 //------------------------------------------------------------------------
 
 GLuint CudaSurface::getGLTexture(void)
 {
-  if (m_isMapped)
+  if (m_isMapped && !m_ownsArray)
   {
     CUresult res = cuGraphicsUnmapResources(1u, &m_cudaResource, NULL);
     CudaModule::checkError("cuGraphicsUnmapResources", res);
@@ -135,7 +167,7 @@ GLuint CudaSurface::getGLTexture(void)
 
 CUarray CudaSurface::getCudaArray(void)
 {
-  if (!m_isMapped)
+  if (!m_isMapped && !m_ownsArray)
   {
     CUresult res = cuGraphicsMapResources(1u, &m_cudaResource, NULL);
     CudaModule::checkError("cuGraphicsMapResources", res);
@@ -148,5 +180,39 @@ CUarray CudaSurface::getCudaArray(void)
   return m_cudaArray;
 }
 
+//------------------------------------------------------------------------
+
+void CudaSurface::download(void* dst)
+{
+  CUDA_MEMCPY2D copy;
+  memset(&copy, 0, sizeof(copy));
+  copy.srcMemoryType  = CU_MEMORYTYPE_ARRAY;
+  copy.srcArray       = getCudaArray();
+  copy.dstMemoryType  = CU_MEMORYTYPE_HOST;
+  copy.dstHost        = dst;
+  copy.dstPitch       = m_textureSize.x * sizeof(U32);
+  copy.WidthInBytes   = m_textureSize.x * sizeof(U32);
+  copy.Height         = m_textureSize.y;
+
+  CudaModule::checkError("cuMemcpy2D", cuMemcpy2D(&copy));
+}
+
+//------------------------------------------------------------------------
+
+void CudaSurface::upload(const void* src)
+{
+  CUDA_MEMCPY2D copy;
+  memset(&copy, 0, sizeof(copy));
+  copy.srcMemoryType  = CU_MEMORYTYPE_HOST;
+  copy.srcHost        = src;
+  copy.srcPitch       = m_textureSize.x * sizeof(U32);
+  copy.dstMemoryType  = CU_MEMORYTYPE_ARRAY;
+  copy.dstArray       = getCudaArray();
+  copy.WidthInBytes   = m_textureSize.x * sizeof(U32);
+  copy.Height         = m_textureSize.y;
+
+  CudaModule::checkError("cuMemcpy2D", cuMemcpy2D(&copy));
+}
+
 
 } // namespace FW
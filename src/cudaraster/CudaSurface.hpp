@@ -31,6 +31,8 @@
 namespace FW {
 //------------------------------------------------------------------------
 // Render target for CudaRaster, visible in OpenGL as a 2D texture.
+// Without GL interop (see CudaModule::setGLInterop), the surface is a plain 
+// CUDA array and getGLTexture() returns 0.
 //------------------------------------------------------------------------
 
 class CudaSurface
@@ -55,6 +57,7 @@ class CudaSurface
     CUgraphicsResource  m_cudaResource;
     bool                m_isMapped;
     CUarray             m_cudaArray;
+    bool                m_ownsArray;
   
   public:
     CudaSurface(const Vec2i& size, Format format, int numSamples = 1);
@@ -70,6 +73,10 @@ class CudaSurface
     GLuint              getGLTexture    (void);             // Invalidates the CUDA array.
     CUarray             getCudaArray    (void);             // Invalidates the GL texture.
 
+    S64                 getNumBytes     (void) const    { return (S64)m_textureSize.x * m_textureSize.y * sizeof(U32); }
+    void                download        (void* dst);        // Copies getNumBytes() bytes, rows of getTextureSize().x texels.
+    void                upload          (const void* src);
+
     //void                resolveToScreen (GLContext* gl);    // Resolves MSAA and writes pixels into the current GL render target.
 
 private:
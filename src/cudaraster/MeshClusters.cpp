@@ -0,0 +1,212 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "MeshClusters.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+std::string MeshClusters::Stats::toString(void) const
+{
+  char buffer[256];
+  snprintf( buffer, sizeof(buffer), 
+            "%d clusters: %d frustum culled, %d backface culled, %d -> %d tris", 
+            numClusters, numFrustumCulled, numBackfaceCulled, numTrisIn, numTrisOut);
+  return buffer;
+}
+
+//------------------------------------------------------------------------
+
+void MeshClusters::build(const Vec3i* indices, int numTris, const void* positions, int numVerts, int stride,
+                         int clusterSize)
+{
+  FW_ASSERT(numTris >= 0 && stride > 0 && clusterSize > 0);
+  clear();
+
+  m_indices.assign(indices, indices + numTris);
+  m_clusters.reserve((numTris + clusterSize - 1) / clusterSize);
+
+  for (int first = 0; first < numTris; first += clusterSize)
+  {
+    Cluster c;
+    c.firstTri = first;
+    c.numTris  = min(clusterSize, numTris - first);
+
+    // Bounding box center, then the farthest vertex.
+
+    Vec3f lo(+FW_F32_MAX), hi(-FW_F32_MAX);
+    Vec3f normalSum(0.0f);
+    std::vector<Vec3f> normals;
+    normals.reserve(c.numTris);
+
+    for (int i = first; i < first + c.numTris; ++i)
+    {
+      Vec3f p[3];
+      for (int j = 0; j < 3; ++j)
+      {
+        int v = indices[i][j];
+        if (v < 0 || v >= numVerts) {
+          fail("MeshClusters: Vertex index %d out of range in triangle %d!", v, i);
+        }
+        p[j] = *(const Vec3f*)((const U8*)positions + (size_t)v * stride);
+        lo = min(lo, p[j]);
+        hi = max(hi, p[j]);
+      }
+
+      // Degenerate triangles are culled by TriangleSetup anyway.
+      Vec3f n = cross(p[1] - p[0], p[2] - p[0]);
+      F32 len = n.length();
+      if (len > 0.0f)
+      {
+        normals.push_back(n / len);
+        normalSum += normals.back();
+      }
+    }
+
+    c.center = (lo + hi) * 0.5f;
+    c.radius = 0.0f;
+    for (int i = first; i < first + c.numTris; ++i)
+    for (int j = 0; j < 3; ++j)
+    {
+      const Vec3f& p = *(const Vec3f*)((const U8*)positions + (size_t)indices[i][j] * stride);
+      c.radius = max(c.radius, (p - c.center).length());
+    }
+
+    // Normal cone, unusable past a half-angle of 90 degrees.
+
+    c.coneAxis   = Vec3f(0.0f);
+    c.coneCutoff = 2.0f;
+
+    F32 axisLen = normalSum.length();
+    if (axisLen > 0.0f)
+    {
+      c.coneAxis = normalSum / axisLen;
+
+      F32 minDot = 1.0f;
+      for (size_t i = 0u; i < normals.size(); ++i) {
+        minDot = min(minDot, dot(c.coneAxis, normals[i]));
+      }
+      if (minDot > 0.0f) {
+        c.coneCutoff = sqrtf(max(1.0f - minDot * minDot, 0.0f));
+      }
+    }
+
+    m_clusters.push_back(c);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void MeshClusters::clear(void)
+{
+  m_clusters.clear();
+  m_indices.clear();
+}
+
+//------------------------------------------------------------------------
+
+MeshClusters::Stats MeshClusters::cull(std::vector<Vec3i>& out, const Mat4f& posToClip) const
+{
+  Stats s;
+  s.numClusters       = getNumClusters();
+  s.numFrustumCulled  = 0;
+  s.numBackfaceCulled = 0;
+  s.numTrisIn         = getNumTris();
+  s.numTrisOut        = 0;
+
+  out.clear();
+  out.reserve(m_indices.size());
+
+  // Frustum planes in model space, -w <= x, y, z <= w.
+
+  Vec4f planes[6];
+  for (int i = 0; i < 3; ++i)
+  {
+    Vec4f row = posToClip.getRow(i);
+    Vec4f w   = posToClip.getRow(3);
+    planes[i * 2 + 0] = w + row;
+    planes[i * 2 + 1] = w - row;
+  }
+
+  // The eye maps to x = y = w = 0. For orthographic projections it is at
+  // infinity and 'eye' is the view direction instead.
+
+  Vec4f eye = posToClip.inverted() * Vec4f(0.0f, 0.0f, 1.0f, 0.0f);
+  bool  ortho = (fabsf(eye.w) < 1.0e-20f);
+  Vec3f eyePos = (ortho) ? eye.getXYZ().normalized() : eye.getXYZ() / eye.w;
+
+  // Counter-clockwise on screen means front faces point toward the eye 
+  // only if posToClip flips the handedness, as OpenGL projections do.
+  F32 facing = (posToClip.det() < 0.0f) ? 1.0f : -1.0f;
+
+  for (int i = 0; i < getNumClusters(); ++i)
+  {
+    const Cluster& c = m_clusters[i];
+
+    bool outside = false;
+    for (int j = 0; j < 6 && !outside; ++j)
+    {
+      Vec3f n = planes[j].getXYZ();
+      outside = (dot(n, c.center) + planes[j].w < -c.radius * n.length());
+    }
+    if (outside)
+    {
+      s.numFrustumCulled++;
+      continue;
+    }
+
+    // Back facing if every normal points away from every point of the 
+    // sphere: angle(axis, p - eye) <= 90 - half-angle.
+
+    bool backfacing = false;
+    if (c.coneCutoff <= 1.0f)
+    {
+      Vec3f axis = c.coneAxis * facing;
+      if (ortho) {
+        backfacing = (dot(axis, eyePos) >= c.coneCutoff);
+      } else {
+        Vec3f v = c.center - eyePos;
+        backfacing = (dot(axis, v) >= c.coneCutoff * v.length() + c.radius * (1.0f + c.coneCutoff));
+      }
+    }
+    if (backfacing)
+    {
+      s.numBackfaceCulled++;
+      continue;
+    }
+
+    out.insert(out.end(), m_indices.begin() + c.firstTri, m_indices.begin() + c.firstTri + c.numTris);
+  }
+
+  s.numTrisOut = (int)out.size();
+  return s;
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
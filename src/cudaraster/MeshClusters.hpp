@@ -0,0 +1,98 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_MESHCLUSTERS_HPP_
+#define CUDARASTER_MESHCLUSTERS_HPP_
+
+#include <string>
+#include <vector>
+#include <base/Math.hpp>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Triangle clusters with bounding spheres and normal cones, culled as a
+// whole before the index buffer is handed to CudaRaster::setIndexBuffer().
+//
+// build() cuts the triangle list into runs of 'clusterSize' triangles in
+// the given order, so run MeshOptimizer::sortSpatially() or 
+// optimizeVertexCache() first for tight clusters. cull() rejects clusters 
+// outside the frustum or facing away from the eye, and writes the indices 
+// of the others. TriangleSetup still culls the survivors one by one.
+//
+// Positions are in model space, as transformed by 'posToClip' into OpenGL
+// clip space. Front faces are counter-clockwise on screen, as in 
+// TriangleSetup.
+//------------------------------------------------------------------------
+
+class MeshClusters
+{
+  public:
+    enum
+    {
+      DefaultClusterSize = 128    // Triangles.
+    };
+
+    struct Cluster
+    {
+      S32   firstTri;
+      S32   numTris;
+      Vec3f center;         // Bounding sphere.
+      F32   radius;
+      Vec3f coneAxis;       // Average normal, counter-clockwise = right-handed.
+      F32   coneCutoff;     // Sine of the cone half-angle, > 1 = no cone.
+    };
+
+    struct Stats
+    {
+      S32   numClusters;
+      S32   numFrustumCulled;
+      S32   numBackfaceCulled;
+      S32   numTrisIn;
+      S32   numTrisOut;
+
+      std::string toString(void) const;
+    };
+
+  private:
+    std::vector<Cluster>  m_clusters;
+    std::vector<Vec3i>    m_indices;
+
+  public:
+    // 'positions' = first vertex position (Vec3f), 'stride' bytes apart.
+    void            build           (const Vec3i* indices, int numTris, const void* positions, int numVerts, int stride,
+                                     int clusterSize = DefaultClusterSize);
+    void            clear           (void);
+
+    // Replaces 'out' with the indices of the potentially visible clusters.
+    Stats           cull            (std::vector<Vec3i>& out, const Mat4f& posToClip) const;
+
+    int             getNumClusters  (void) const      { return (int)m_clusters.size(); }
+    const Cluster&  getCluster      (int idx) const   { FW_ASSERT(idx >= 0 && idx < getNumClusters()); return m_clusters[idx]; }
+    int             getNumTris      (void) const      { return (int)m_indices.size(); }
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_MESHCLUSTERS_HPP_
@@ -0,0 +1,525 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Scoring of "Linear-Speed Vertex Cache Optimisation", Tom Forsyth 2006.
+//------------------------------------------------------------------------
+
+namespace {
+
+const F32 c_lastTriScore      = 0.75f;
+const F32 c_cacheDecayPower   = 1.5f;
+const F32 c_valenceBoostScale = 2.0f;
+const F32 c_valenceBoostPower = 0.5f;
+
+const char* const s_curveNames[] = 
+{
+  "morton", "hilbert"
+};
+
+F32 getVertexScore(int cachePos, int numLiveTris, int cacheSize)
+{
+  if (numLiveTris == 0) {
+    return -1.0f;   // No triangle left to emit.
+  }
+
+  F32 score = 0.0f;
+  if (cachePos >= 0)
+  {
+    if (cachePos < 3) {
+      score = c_lastTriScore;   // Used by the last triangle, no preference among them.
+    } else {
+      F32 s = 1.0f - (F32)(cachePos - 3) / (F32)(cacheSize - 3);
+      score = powf(s, c_cacheDecayPower);
+    }
+  }
+
+  // Favor vertices with few remaining triangles, to finish them off.
+  score += c_valenceBoostScale * powf((F32)numLiveTris, -c_valenceBoostPower);
+  return score;
+}
+
+void checkIndices(const Vec3i* indices, int numTris, int numVerts)
+{
+  FW_ASSERT(numTris >= 0 && numVerts >= 0 && (indices || !numTris));
+  for (int i = 0; i < numTris; ++i)
+  for (int j = 0; j < 3; ++j)
+  {
+    if (indices[i][j] < 0 || indices[i][j] >= numVerts) {
+      fail("MeshOptimizer: Vertex index %d out of range in triangle %d!", indices[i][j], i);
+    }
+  }
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+std::string MeshOptimizer::Report::toString(void) const
+{
+  char buffer[256];
+  snprintf( buffer, sizeof(buffer), 
+            "%d tris, %d verts, cache %d: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", 
+            numTris, numVerts, cacheSize, acmrBefore, acmrAfter, atvrBefore, atvrAfter);
+  return buffer;
+}
+
+//------------------------------------------------------------------------
+
+F32 MeshOptimizer::getACMR(const Vec3i* indices, int numTris, int numVerts, int cacheSize)
+{
+  checkIndices(indices, numTris, numVerts);
+  if (!numTris) {
+    return 0.0f;
+  }
+  return (F32)countTransforms(indices, numTris, numVerts, cacheSize) / (F32)numTris;
+}
+
+//------------------------------------------------------------------------
+
+F32 MeshOptimizer::getATVR(const Vec3i* indices, int numTris, int numVerts, int cacheSize)
+{
+  checkIndices(indices, numTris, numVerts);
+  int numReferenced = countReferenced(indices, numTris, numVerts);
+  if (!numReferenced) {
+    return 0.0f;
+  }
+  return (F32)countTransforms(indices, numTris, numVerts, cacheSize) / (F32)numReferenced;
+}
+
+//------------------------------------------------------------------------
+
+void MeshOptimizer::optimizeVertexCache(Vec3i* indices, int numTris, int numVerts, int cacheSize)
+{
+  FW_ASSERT(cacheSize > 3 && cacheSize <= MaxCacheSize);
+  checkIndices(indices, numTris, numVerts);
+  if (!numTris) {
+    return;
+  }
+
+  // Vertex => triangles. The first numLive[v] entries are still to emit.
+
+  std::vector<S32> numLive(numVerts, 0);
+  std::vector<S32> triOfs(numVerts + 1, 0);
+  std::vector<S32> triList((size_t)numTris * 3);
+
+  for (int i = 0; i < numTris; ++i)
+  for (int j = 0; j < 3; ++j) {
+    numLive[indices[i][j]]++;
+  }
+
+  for (int v = 0; v < numVerts; ++v) {
+    triOfs[v + 1] = triOfs[v] + numLive[v];
+  }
+
+  {
+    std::vector<S32> fill(triOfs.begin(), triOfs.end() - 1);
+    for (int i = 0; i < numTris; ++i)
+    for (int j = 0; j < 3; ++j) {
+      triList[fill[indices[i][j]]++] = i;
+    }
+  }
+
+  // Initial scores.
+
+  std::vector<S32> cachePos(numVerts, -1);
+  std::vector<F32> vertexScore(numVerts);
+  std::vector<F32> triScore(numTris);
+  std::vector<U8>  emitted(numTris, 0);
+
+  for (int v = 0; v < numVerts; ++v) {
+    vertexScore[v] = getVertexScore(-1, numLive[v], cacheSize);
+  }
+
+  int best = 0;
+  for (int i = 0; i < numTris; ++i)
+  {
+    const Vec3i& t = indices[i];
+    triScore[i] = vertexScore[t.x] + vertexScore[t.y] + vertexScore[t.z];
+    if (triScore[i] > triScore[best]) {
+      best = i;
+    }
+  }
+
+  // Greedily emit the best triangle among those touching the cache. When
+  // none is left, continue with the next triangle in the original order.
+
+  std::vector<Vec3i> order;
+  std::vector<S32>   cache, newCache;
+  order.reserve(numTris);
+  cache.reserve(cacheSize + 3);
+  newCache.reserve(cacheSize + 3);
+  int cursor = 0;
+
+  while (best >= 0)
+  {
+    const Vec3i tri = indices[best];
+    emitted[best] = 1;
+    order.push_back(tri);
+
+    for (int j = 0; j < 3; ++j)
+    {
+      int v = tri[j];
+      S32* list = &triList[triOfs[v]];
+      for (int k = 0; k < numLive[v]; ++k)
+      {
+        if (list[k] == best)
+        {
+          list[k] = list[--numLive[v]];
+          list[numLive[v]] = best;
+          break;
+        }
+      }
+    }
+
+    // Most recent first, keep the order of the others.
+
+    newCache.clear();
+    for (int j = 0; j < 3; ++j)
+    {
+      if (std::find(newCache.begin(), newCache.end(), tri[j]) == newCache.end()) {
+        newCache.push_back(tri[j]);
+      }
+    }
+    for (size_t k = 0u; k < cache.size(); ++k)
+    {
+      if (cache[k] != tri.x && cache[k] != tri.y && cache[k] != tri.z) {
+        newCache.push_back(cache[k]);
+      }
+    }
+
+    // Rescore the vertices, including those just evicted, and their 
+    // remaining triangles.
+
+    for (size_t k = 0u; k < newCache.size(); ++k)
+    {
+      int v = newCache[k];
+      cachePos[v] = ((int)k < cacheSize) ? (int)k : -1;
+      vertexScore[v] = getVertexScore(cachePos[v], numLive[v], cacheSize);
+    }
+
+    best = -1;
+    F32 bestScore = -1.0f;
+
+    for (size_t k = 0u; k < newCache.size(); ++k)
+    {
+      int v = newCache[k];
+      const S32* list = &triList[triOfs[v]];
+      for (int l = 0; l < numLive[v]; ++l)
+      {
+        const Vec3i& t = indices[list[l]];
+        F32 score = vertexScore[t.x] + vertexScore[t.y] + vertexScore[t.z];
+        triScore[list[l]] = score;
+        if (score > bestScore)
+        {
+          best = list[l];
+          bestScore = score;
+        }
+      }
+    }
+
+    newCache.resize(min((int)newCache.size(), cacheSize));
+    cache.swap(newCache);
+
+    if (best < 0)
+    {
+      while (cursor < numTris && emitted[cursor]) {
+        cursor++;
+      }
+      best = (cursor < numTris) ? cursor : -1;
+    }
+  }
+
+  FW_ASSERT((int)order.size() == numTris);
+  memcpy(indices, &order[0], (size_t)numTris * sizeof(Vec3i));
+}
+
+//------------------------------------------------------------------------
+
+int MeshOptimizer::optimizeVertexFetch(Vec3i* indices, int numTris, int numVerts, std::vector<S32>& remap)
+{
+  checkIndices(indices, numTris, numVerts);
+  remap.assign(numVerts, -1);
+
+  int numReferenced = 0;
+  for (int i = 0; i < numTris; ++i)
+  for (int j = 0; j < 3; ++j)
+  {
+    S32& v = indices[i][j];
+    if (remap[v] < 0) {
+      remap[v] = numReferenced++;
+    }
+    v = remap[v];
+  }
+
+  int next = numReferenced;
+  for (int v = 0; v < numVerts; ++v)
+  {
+    if (remap[v] < 0) {
+      remap[v] = next++;
+    }
+  }
+  return numReferenced;
+}
+
+//------------------------------------------------------------------------
+
+void MeshOptimizer::remapVertices(void* vertices, int numVerts, int vertexSize, const std::vector<S32>& remap)
+{
+  FW_ASSERT(vertexSize > 0 && (int)remap.size() == numVerts);
+  if (!numVerts) {
+    return;
+  }
+
+  const size_t bytes = (size_t)numVerts * vertexSize;
+  std::vector<U8> src((const U8*)vertices, (const U8*)vertices + bytes);
+
+  for (int v = 0; v < numVerts; ++v)
+  {
+    FW_ASSERT(remap[v] >= 0 && remap[v] < numVerts);
+    memcpy((U8*)vertices + (size_t)remap[v] * vertexSize, &src[(size_t)v * vertexSize], vertexSize);
+  }
+}
+
+//------------------------------------------------------------------------
+
+MeshOptimizer::Report MeshOptimizer::optimize(Vec3i* indices, int numTris, void* vertices, int numVerts, 
+                                              int vertexSize, int cacheSize)
+{
+  Report r;
+  r.numTris     = numTris;
+  r.numVerts    = 0;
+  r.cacheSize   = cacheSize;
+  r.acmrBefore  = getACMR(indices, numTris, numVerts, cacheSize);
+  r.atvrBefore  = getATVR(indices, numTris, numVerts, cacheSize);
+
+  std::vector<S32> remap;
+  optimizeVertexCache(indices, numTris, numVerts, cacheSize);
+  r.numVerts = optimizeVertexFetch(indices, numTris, numVerts, remap);
+  remapVertices(vertices, numVerts, vertexSize, remap);
+
+  r.acmrAfter   = getACMR(indices, numTris, numVerts, cacheSize);
+  r.atvrAfter   = getATVR(indices, numTris, numVerts, cacheSize);
+  return r;
+}
+
+//------------------------------------------------------------------------
+
+void MeshOptimizer::sortSpatially(Vec3i* indices, int numTris, const void* positions, int numVerts, int stride, 
+                                  bool clipSpace, Curve curve)
+{
+  FW_ASSERT(curve >= 0 && curve < Curve_Max && stride > 0);
+  checkIndices(indices, numTris, numVerts);
+  if (!numTris) {
+    return;
+  }
+
+  // Centroids, in NDC for clip space.
+
+  const int numDims = (clipSpace) ? 2 : 3;
+  std::vector<Vec3f> centroids(numTris);
+  std::vector<U8>    culled(numTris, 0);
+  Vec3f lo(+FW_F32_MAX), hi(-FW_F32_MAX);
+
+  for (int i = 0; i < numTris; ++i)
+  {
+    Vec3f c(0.0f);
+    for (int j = 0; j < 3; ++j)
+    {
+      const F32* p = (const F32*)((const U8*)positions + (size_t)indices[i][j] * stride);
+      if (!clipSpace) {
+        c += Vec3f(p[0], p[1], p[2]);
+      } else if (p[3] > 0.0f) {
+        c += Vec3f(p[0] / p[3], p[1] / p[3], 0.0f);
+      } else {
+        culled[i] = 1;
+      }
+    }
+
+    centroids[i] = c * (1.0f / 3.0f);
+    if (clipSpace) {
+      centroids[i] = clamp(centroids[i], Vec3f(-1.0f), Vec3f(1.0f));
+    }
+    if (!culled[i])
+    {
+      lo = min(lo, centroids[i]);
+      hi = max(hi, centroids[i]);
+    }
+  }
+
+  // Quantize to 16 bits per axis and sort by (key, original index).
+
+  std::vector<std::pair<U64, S32> > keys(numTris);
+  Vec3f scale = Vec3f(65535.0f) / max(hi - lo, Vec3f(1.0e-20f));
+
+  for (int i = 0; i < numTris; ++i)
+  {
+    if (culled[i])
+    {
+      keys[i] = std::make_pair(~(U64)0, i);
+      continue;
+    }
+
+    U32 coords[3];
+    for (int k = 0; k < numDims; ++k) {
+      coords[k] = (U32)clamp((centroids[i][k] - lo[k]) * scale[k], 0.0f, 65535.0f);
+    }
+    keys[i] = std::make_pair(getCurveKey(coords, numDims, curve), i);
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<Vec3i> order(numTris);
+  for (int i = 0; i < numTris; ++i) {
+    order[i] = indices[keys[i].second];
+  }
+  memcpy(indices, &order[0], (size_t)numTris * sizeof(Vec3i));
+}
+
+//------------------------------------------------------------------------
+
+bool MeshOptimizer::canReorder(const PixelPipeSpec& spec)
+{
+  return ((spec.renderModeFlags & RenderModeFlag_EnableDepth) != 0 && 
+          strcmp(spec.blendShaderName, "BlendReplace") == 0);
+}
+
+//------------------------------------------------------------------------
+
+const char* MeshOptimizer::getCurveName(Curve curve)
+{
+  FW_ASSERT(curve >= 0 && curve < Curve_Max);
+  return s_curveNames[curve];
+}
+
+//------------------------------------------------------------------------
+
+MeshOptimizer::Curve MeshOptimizer::findCurve(const char* name)
+{
+  for (int i = 0; i < Curve_Max; ++i)
+  {
+    if (strcmp(name, s_curveNames[i]) == 0) {
+      return (Curve)i;
+    }
+  }
+  return Curve_Max;
+}
+
+//------------------------------------------------------------------------
+
+int MeshOptimizer::countTransforms(const Vec3i* indices, int numTris, int numVerts, int cacheSize)
+{
+  // FIFO: a vertex stays cached for 'cacheSize' insertions.
+  std::vector<S32> inserted(numVerts, -1);
+  int numInserted = 0;
+
+  for (int i = 0; i < numTris; ++i)
+  for (int j = 0; j < 3; ++j)
+  {
+    int v = indices[i][j];
+    if (inserted[v] < 0 || numInserted - inserted[v] >= cacheSize) {
+      inserted[v] = numInserted++;
+    }
+  }
+  return numInserted;
+}
+
+//------------------------------------------------------------------------
+
+int MeshOptimizer::countReferenced(const Vec3i* indices, int numTris, int numVerts)
+{
+  std::vector<U8> used(numVerts, 0);
+  int num = 0;
+
+  for (int i = 0; i < numTris; ++i)
+  for (int j = 0; j < 3; ++j)
+  {
+    U8& u = used[indices[i][j]];
+    num += (u == 0);
+    u = 1;
+  }
+  return num;
+}
+
+//------------------------------------------------------------------------
+
+U64 MeshOptimizer::getCurveKey(U32* coords, int numDims, Curve curve)
+{
+  const int numBits = 16;
+
+  // Hilbert: Skilling's transform of the axes to the transposed index, 
+  // "Programming the Hilbert curve", AIP 2004. Morton interleaves as is.
+  if (curve == Curve_Hilbert)
+  {
+    for (U32 q = 1u << (numBits - 1); q > 1u; q >>= 1)
+    {
+      U32 p = q - 1u;
+      for (int i = 0; i < numDims; ++i)
+      {
+        if (coords[i] & q) {
+          coords[0] ^= p;
+        } else {
+          U32 t = (coords[0] ^ coords[i]) & p;
+          coords[0] ^= t;
+          coords[i] ^= t;
+        }
+      }
+    }
+
+    for (int i = 1; i < numDims; ++i) {
+      coords[i] ^= coords[i - 1];
+    }
+
+    U32 t = 0u;
+    for (U32 q = 1u << (numBits - 1); q > 1u; q >>= 1)
+    {
+      if (coords[numDims - 1] & q) {
+        t ^= q - 1u;
+      }
+    }
+    for (int i = 0; i < numDims; ++i) {
+      coords[i] ^= t;
+    }
+  }
+
+  U64 key = 0u;
+  for (int b = numBits - 1; b >= 0; --b)
+  for (int i = 0; i < numDims; ++i) {
+    key = (key << 1) | ((coords[i] >> b) & 1u);
+  }
+  return key;
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
@@ -0,0 +1,124 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_MESHOPTIMIZER_HPP_
+#define CUDARASTER_MESHOPTIMIZER_HPP_
+
+#include <string>
+#include <vector>
+#include <base/Math.hpp>
+
+#include "CudaRaster.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Offline reordering of indexed triangle lists for the vertex fetches of
+// TriangleSetup and the varying fetches of FineRaster.
+//
+// optimizeVertexCache() reorders triangles with Forsyth's linear-speed 
+// vertex cache optimizer, optimizeVertexFetch() then renumbers vertices 
+// in first-use order so that consecutive triangles read nearby vertices.
+// CudaRaster has no post-transform cache; the FIFO of 'cacheSize' entries
+// stands in for the texture cache in front of the vertex buffer.
+//
+// ACMR = vertices transformed per triangle (3 for a triangle soup, ~0.6
+// for a well-ordered grid). ATVR = vertices transformed per vertex (1 is
+// optimal).
+//
+// sortSpatially() instead orders triangles along a space-filling curve of
+// their centroids, so that consecutive triangles share bins and tiles. It
+// changes the image unless canReorder() holds for the pixel pipe.
+//------------------------------------------------------------------------
+
+class MeshOptimizer
+{
+  public:
+    enum
+    {
+      DefaultCacheSize  = 32,
+      MaxCacheSize      = 64
+    };
+
+    enum Curve
+    {
+      Curve_Morton = 0,
+      Curve_Hilbert,
+
+      Curve_Max
+    };
+
+    struct Report
+    {
+      S32   numTris;
+      S32   numVerts;       // Referenced by the index buffer.
+      S32   cacheSize;
+      F32   acmrBefore;
+      F32   acmrAfter;
+      F32   atvrBefore;
+      F32   atvrAfter;
+
+      std::string toString(void) const;
+    };
+
+  public:
+    // Indices must lie in [0, numVerts).
+    static F32    getACMR             (const Vec3i* indices, int numTris, int numVerts, int cacheSize = DefaultCacheSize);
+    static F32    getATVR             (const Vec3i* indices, int numTris, int numVerts, int cacheSize = DefaultCacheSize);
+
+    static void   optimizeVertexCache (Vec3i* indices, int numTris, int numVerts, int cacheSize = DefaultCacheSize);
+
+    // remap[old] = new. Unreferenced vertices go last, so remap is a 
+    // permutation. Returns the number of referenced vertices.
+    static int    optimizeVertexFetch (Vec3i* indices, int numTris, int numVerts, std::vector<S32>& remap);
+    static void   remapVertices       (void* vertices, int numVerts, int vertexSize, const std::vector<S32>& remap);
+
+    // All of the above, in place. The vertex count is unchanged.
+    static Report optimize            (Vec3i* indices, int numTris, void* vertices, int numVerts, int vertexSize, 
+                                       int cacheSize = DefaultCacheSize);
+
+    // 'positions' = first vertex position, 'stride' bytes apart. With 
+    // 'clipSpace', positions are Vec4f and the curve follows the screen-
+    // space centroids (triangles crossing w = 0 go last). Otherwise they 
+    // are Vec3f and the curve spans the 3D bounding box of the centroids.
+    // The sort is stable.
+    static void   sortSpatially       (Vec3i* indices, int numTris, const void* positions, int numVerts, int stride, 
+                                       bool clipSpace, Curve curve = Curve_Hilbert);
+
+    // Depth test with BlendReplace: the image does not depend on the 
+    // triangle order, up to ties in depth.
+    static bool   canReorder          (const PixelPipeSpec& spec);
+
+    static const char* getCurveName   (Curve curve);
+    static Curve  findCurve           (const char* name);   // Curve_Max if unknown.
+
+  private:
+    static int    countTransforms     (const Vec3i* indices, int numTris, int numVerts, int cacheSize);
+    static int    countReferenced     (const Vec3i* indices, int numTris, int numVerts);
+    static U64    getCurveKey         (U32* coords, int numDims, Curve curve);  // 16 bits per coordinate.
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_MESHOPTIMIZER_HPP_
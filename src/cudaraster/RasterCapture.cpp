@@ -0,0 +1,253 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterCapture.hpp"
+
+#include <cstring>
+#include <io/File.hpp>
+
+#include "CudaRaster.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+#define CR_CAPTURE_MAGIC    0x50435243u // "CRCP"
+#define CR_CAPTURE_VERSION  2   // 2: Draw::indexFormat.
+
+//------------------------------------------------------------------------
+
+void RasterCapture::clear(void)
+{
+  m_draws.clear();
+  m_blobs.clear();
+  m_blobLookup.clear();
+}
+
+//------------------------------------------------------------------------
+
+S64 RasterCapture::getTotalBytes(void) const
+{
+  S64 total = 0;
+  for (size_t i = 0u; i < m_blobs.size(); ++i) {
+    total += (S64)m_blobs[i].size();
+  }
+  return total;
+}
+
+//------------------------------------------------------------------------
+
+void RasterCapture::record(CudaRaster& raster)
+{
+  Draw d;
+  d.pipeName      = raster.m_pipeName;
+  d.pipeSpec      = raster.m_pipeSpec;
+  d.viewportSize  = raster.m_viewportSize;
+  d.numSamples    = raster.m_numSamples;
+  d.deferredClear = raster.m_deferredClear;
+  d.clearColor    = raster.m_clearColor;
+  d.clearDepth    = raster.m_clearDepth;
+  d.numTris       = raster.m_numTris;
+  d.indexFormat   = raster.m_indexFormat;
+
+  // Buffers are read back from wherever they currently live.
+  S64 vertexBytes = raster.m_vertexBuffer->getSize() - raster.m_vertexOfs;
+  S64 indexBytes  = raster.getIndexBytes();
+
+  // Batches, instanced draws and strided vertices are recorded as one plain draw.
+  if (raster.isFlattened()) 
+  {
+    std::vector<U8>    vertices;
+    std::vector<Vec3i> indices;
+    raster.readFlattened(vertices, indices);
+    d.indexFormat = IndexFormat_U32;
+    d.vertexBlob  = addBlob((vertices.empty()) ? NULL : &vertices[0], (S64)vertices.size());
+    d.indexBlob   = addBlob((indices.empty()) ? NULL : &indices[0], (S64)indices.size() * sizeof(Vec3i));
+  } 
+  else 
+  {
+    d.vertexBlob  = addBlob(raster.m_vertexBuffer->getPtr(raster.m_vertexOfs), vertexBytes);
+    d.indexBlob   = addBlob(raster.m_indexBuffer->getPtr(raster.m_indexOfs), indexBytes);
+  }
+
+  m_draws.push_back(d);
+}
+
+//------------------------------------------------------------------------
+
+void RasterCapture::apply(int idx, CudaRaster& raster, Buffer& vertices, Buffer& indices) const
+{
+  const Draw& d = getDraw(idx);
+  const std::vector<U8>& vb = m_blobs[d.vertexBlob];
+  const std::vector<U8>& ib = m_blobs[d.indexBlob];
+
+  vertices.resizeDiscard(vb.size());
+  if (!vb.empty()) {
+    memcpy(vertices.getMutablePtrDiscard(), &vb[0], vb.size());
+  }
+
+  indices.resizeDiscard(ib.size());
+  if (!ib.empty()) {
+    memcpy(indices.getMutablePtrDiscard(), &ib[0], ib.size());
+  }
+
+  raster.setVertexBuffer(&vertices, 0);
+  raster.setIndexBuffer(&indices, 0, d.numTris, d.indexFormat);
+
+  raster.m_deferredClear = d.deferredClear;
+  raster.m_clearColor    = d.clearColor;
+  raster.m_clearDepth    = d.clearDepth;
+}
+
+//------------------------------------------------------------------------
+
+void RasterCapture::readFromStream(InputStream& s)
+{
+  clear();
+
+  U32 magic, version;
+  s >> magic >> version;
+  
+  if (magic != CR_CAPTURE_MAGIC) {
+    fail("RasterCapture: Not a capture file!");
+  }
+  if (version < 1 || version > CR_CAPTURE_VERSION) {
+    fail("RasterCapture: Unsupported capture version %u!", version);
+  }
+
+  s >> m_blobs;
+
+  S32 numDraws;
+  s >> numDraws;
+  m_draws.resize(numDraws);
+
+  for (int i = 0; i < numDraws; ++i)
+  {
+    Draw& d = m_draws[i];
+    std::string blendShaderName;
+
+    s >> d.pipeName;
+    s >> d.pipeSpec.samplesLog2 >> d.pipeSpec.vertexStructSize;
+    s >> d.pipeSpec.renderModeFlags >> d.pipeSpec.profilingMode;
+    s >> blendShaderName;
+    s >> d.viewportSize >> d.numSamples;
+    s >> d.deferredClear >> d.clearColor >> d.clearDepth;
+    s >> d.vertexBlob >> d.indexBlob >> d.numTris;
+
+    d.indexFormat = IndexFormat_U32;
+    if (version >= 2) {
+      s >> d.indexFormat;
+    }
+
+    memset(d.pipeSpec.blendShaderName, 0, sizeof(d.pipeSpec.blendShaderName));
+    strncpy(d.pipeSpec.blendShaderName, blendShaderName.c_str(), 
+            sizeof(d.pipeSpec.blendShaderName) - 1);
+
+    if (d.vertexBlob < 0 || d.vertexBlob >= getNumBlobs() || 
+        d.indexBlob < 0 || d.indexBlob >= getNumBlobs()) {
+      fail("RasterCapture: Corrupted draw %d!", i);
+    }
+  }
+
+  // Rebuild the lookup so that recording can be resumed.
+  for (int i = 0; i < getNumBlobs(); ++i)
+  {
+    U64 h = (m_blobs[i].empty()) ? hashBuffer64(NULL, 0) : 
+                                   hashBuffer64(&m_blobs[i][0], (int)m_blobs[i].size());
+    if (!m_blobLookup.contains(h)) {
+      m_blobLookup.add(h, i);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+void RasterCapture::writeToStream(OutputStream& s) const
+{
+  s << (U32)CR_CAPTURE_MAGIC << (U32)CR_CAPTURE_VERSION;
+  s << m_blobs;
+  s << (S32)m_draws.size();
+
+  for (size_t i = 0u; i < m_draws.size(); ++i)
+  {
+    const Draw& d = m_draws[i];
+    
+    s << d.pipeName;
+    s << d.pipeSpec.samplesLog2 << d.pipeSpec.vertexStructSize;
+    s << d.pipeSpec.renderModeFlags << d.pipeSpec.profilingMode;
+    s << std::string(d.pipeSpec.blendShaderName);
+    s << d.viewportSize << d.numSamples;
+    s << d.deferredClear << d.clearColor << d.clearDepth;
+    s << d.vertexBlob << d.indexBlob << d.numTris;
+    s << d.indexFormat;
+  }
+}
+
+//------------------------------------------------------------------------
+
+void RasterCapture::load(const std::string& fileName)
+{
+  MappedInputStream in(fileName);
+  readFromStream(in);
+}
+
+//------------------------------------------------------------------------
+
+void RasterCapture::save(const std::string& fileName) const
+{
+  File file(fileName, File::Create);
+  BufferedOutputStream out(file, 1 << 20);
+  writeToStream(out);
+  out.flush();
+}
+
+//------------------------------------------------------------------------
+
+S32 RasterCapture::addBlob(const void* ptr, S64 size)
+{
+  FW_ASSERT(size >= 0 && size <= FW_S32_MAX);
+
+  U64 h = hashBuffer64(ptr, (int)size);
+  const S32* found = m_blobLookup.search(h);
+
+  if (found)
+  {
+    const std::vector<U8>& blob = m_blobs[*found];
+    if ((S64)blob.size() == size && (!size || memcmp(&blob[0], ptr, (size_t)size) == 0)) {
+      return *found;
+    }
+  }
+  
+  S32 idx = (S32)m_blobs.size();
+  m_blobs.push_back(std::vector<U8>((const U8*)ptr, (const U8*)ptr + size));
+
+  if (!found) {
+    m_blobLookup.add(h, idx);
+  }
+  return idx;
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
@@ -0,0 +1,113 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#ifndef CUDARASTER_RASTERCAPTURE_HPP_
+#define CUDARASTER_RASTERCAPTURE_HPP_
+
+#include <string>
+#include <vector>
+#include <base/Hash.hpp>
+#include <gpu/Buffer.hpp>
+#include <io/Stream.hpp>
+
+#include "cuda/PrivateDefs.hpp"
+
+
+namespace FW {
+
+class CudaRaster;
+
+//------------------------------------------------------------------------
+// Recording of the draw calls issued to a CudaRaster, see 
+// CudaRaster::setCapture(). 
+//
+// Each draw stores everything drawTriangles() consumes: pixel pipe name and
+// spec, surface size and samples, deferred clear state, and references to 
+// the vertex / index bytes. Identical buffers are stored once, so capturing 
+// many frames of a static mesh only adds the changing vertex data.
+//------------------------------------------------------------------------
+
+class RasterCapture : public Serializable
+{
+  public:
+    struct Draw
+    {
+      std::string   pipeName;
+      PixelPipeSpec pipeSpec;
+      Vec2i         viewportSize;
+      S32           numSamples;
+
+      bool          deferredClear;
+      U32           clearColor;     // Encoded, as passed to the pipe.
+      U32           clearDepth;
+
+      S32           vertexBlob;     // Index in the blob table.
+      S32           indexBlob;
+      S32           numTris;
+      S32           indexFormat;    // IndexFormat_XXX
+    };
+
+  private:
+    std::vector<Draw>               m_draws;
+    std::vector<std::vector<U8> >   m_blobs;
+    Hash<U64, S32>                  m_blobLookup; // hashBuffer64 => first blob.
+
+  public:
+    RasterCapture(void) {}
+    virtual ~RasterCapture(void) {}
+
+    void            clear           (void);
+    
+    int             getNumDraws     (void) const    { return (int)m_draws.size(); }
+    const Draw&     getDraw         (int idx) const { FW_ASSERT(idx >= 0 && idx < getNumDraws()); return m_draws[idx]; }
+    
+    int             getNumBlobs     (void) const    { return (int)m_blobs.size(); }
+    const std::vector<U8>& getBlob  (int idx) const { FW_ASSERT(idx >= 0 && idx < getNumBlobs()); return m_blobs[idx]; }
+    S64             getTotalBytes   (void) const;
+
+    // Records the current state of 'raster'; called from drawTriangles().
+    void            record          (CudaRaster& raster);
+
+    // Restores the clear state and geometry of a recorded draw into 
+    // 'raster', uploading the data to the given buffers. Surfaces and pixel 
+    // pipe are left to the caller (see Draw::viewportSize / pipeSpec).
+    void            apply           (int idx, CudaRaster& raster, Buffer& vertices, Buffer& indices) const;
+
+    virtual void    readFromStream  (InputStream& s);
+    virtual void    writeToStream   (OutputStream& s) const;
+
+    void            load            (const std::string& fileName);
+    void            save            (const std::string& fileName) const;
+
+  private:
+    S32             addBlob         (const void* ptr, S64 size);
+
+  private:
+    RasterCapture   (const RasterCapture&);             // forbidden
+    RasterCapture&  operator= (const RasterCapture&);   // forbidden
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERCAPTURE_HPP_
@@ -0,0 +1,279 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterHeatmap.hpp"
+
+#include <cstdio>
+#include "RasterUtil.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+namespace {
+
+FILE* openFile(const std::string& fileName)
+{
+  FILE* file = fopen(fileName.c_str(), "wb");
+  if (!file) {
+    fail("RasterHeatmap: Cannot open '%s'!", fileName.c_str());
+  }
+  return file;
+}
+
+// Black -> red -> yellow -> white.
+void heatColor(F32 t, U8* rgb)
+{
+  t = clamp(t, 0.0f, 1.0f) * 3.0f;
+  rgb[0] = (U8)(clamp(t,        0.0f, 1.0f) * 255.0f + 0.5f);
+  rgb[1] = (U8)(clamp(t - 1.0f, 0.0f, 1.0f) * 255.0f + 0.5f);
+  rgb[2] = (U8)(clamp(t - 2.0f, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+RasterHeatmap::RasterHeatmap(void)
+{
+  clear();
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::clear(void)
+{
+  m_sizeTiles   = Vec2i(0);
+  m_hasFineTime = false;
+  for (int i = 0; i < Channel_Max; ++i) {
+    m_channels[i].clear();
+  }
+}
+
+//------------------------------------------------------------------------
+
+F32 RasterHeatmap::getValue(Channel c, int tileX, int tileY) const
+{
+  FW_ASSERT(tileX >= 0 && tileX < m_sizeTiles.x && tileY >= 0 && tileY < m_sizeTiles.y);
+  return getChannel(c)[tileX + tileY * m_sizeTiles.x];
+}
+
+//------------------------------------------------------------------------
+
+F32 RasterHeatmap::getMax(Channel c) const
+{
+  const std::vector<F32>& v = getChannel(c);
+  F32 res = 0.0f;
+  for (size_t i = 0u; i < v.size(); ++i) {
+    res = max(res, v[i]);
+  }
+  return res;
+}
+
+//------------------------------------------------------------------------
+
+F32 RasterHeatmap::getMean(Channel c) const
+{
+  const std::vector<F32>& tris = m_channels[Channel_Triangles];
+  const std::vector<F32>& v    = getChannel(c);
+  F64 sum = 0.0;
+  int num = 0;
+
+  for (size_t i = 0u; i < v.size(); ++i)
+  {
+    if (tris[i] > 0.0f)
+    {
+      sum += v[i];
+      num++;
+    }
+  }
+  return (num) ? (F32)(sum / num) : 0.0f;
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::beginDraw(const CudaRaster& raster)
+{
+  m_sizeTiles   = raster.m_sizeTiles;
+  m_hasFineTime = false;
+  for (int i = 0; i < Channel_Max; ++i) {
+    m_channels[i].assign(m_sizeTiles.x * m_sizeTiles.y, 0.0f);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::setFineTime(int tileIdx, F32 seconds)
+{
+  FW_ASSERT(tileIdx >= 0 && tileIdx < (int)m_channels[Channel_FineTime].size());
+  m_channels[Channel_FineTime][tileIdx] += seconds;
+  m_hasFineTime = true;
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::record(CudaRaster& raster)
+{
+  FW_ASSERT(m_sizeTiles == raster.m_sizeTiles);
+
+  const CRAtomics&        atomics       = *(const CRAtomics*)raster.m_module->getGlobal(CudaRaster::getAtomicsKey()).getPtr();
+  const CRTriangleHeader* triHeader     = (const CRTriangleHeader*)raster.m_triHeader.getPtr();
+  const S32*              activeTiles   = (const S32*)raster.m_activeTiles.getPtr();
+  const S32*              tileFirstSeg  = (const S32*)raster.m_tileFirstSeg.getPtr();
+  const S32*              tileSegData   = (const S32*)raster.m_tileSegData.getPtr();
+  const S32*              tileSegNext   = (const S32*)raster.m_tileSegNext.getPtr();
+  const S32*              tileSegCount  = (const S32*)raster.m_tileSegCount.getPtr();
+
+  const Vec2i&  viewportSize  = raster.m_viewportSize;
+  int           samplesLog2   = raster.m_samplesLog2;
+  bool          enableQuads   = (raster.m_pipeSpec.renderModeFlags & RenderModeFlag_EnableQuads) != 0;
+
+  for (int activeIdx = 0; activeIdx < atomics.numActiveTiles; ++activeIdx)
+  {
+    int tileIdx = activeTiles[activeIdx];
+    int tileX   = tileIdx % m_sizeTiles.x;
+    int tileY   = tileIdx / m_sizeTiles.x;
+    int baseX   = (tileX << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((viewportSize.x - 1) << (CR_SUBPIXEL_LOG2 - 1));
+    int baseY   = (tileY << (CR_TILE_LOG2 + CR_SUBPIXEL_LOG2)) - ((viewportSize.y - 1) << (CR_SUBPIXEL_LOG2 - 1));
+
+    F32 numTris  = 0.0f;
+    F32 numFrags = 0.0f;
+
+    for (int segIdx = tileFirstSeg[tileIdx]; segIdx != -1; segIdx = tileSegNext[segIdx])
+    {
+      for (int i = 0; i < tileSegCount[segIdx]; ++i)
+      {
+        int triIdx    = tileSegData[segIdx * CR_TILE_SEG_SIZE + i];
+        int dataIdx   = triIdx >> 3;
+        int subtriIdx = triIdx & 7;
+        if (subtriIdx != 7) {
+          dataIdx = triHeader[dataIdx].misc + subtriIdx;
+        }
+
+        // Same pixel coverage as trianglePixelCoverage() in FineRaster.
+        const CRTriangleHeader& th = triHeader[dataIdx];
+        S32 v0x  = th.v0x - baseX;
+        S32 v0y  = th.v0y - baseY;
+        S32 v01x = th.v1x - th.v0x;
+        S32 v01y = th.v1y - th.v0y;
+        S32 v20x = th.v0x - th.v2x;
+        S32 v20y = th.v0y - th.v2y;
+
+        U64 coverage;
+        if (samplesLog2 == 0)
+        {
+          coverage = cover8x8_exact_ref(v0x, v0y, v01x, v01y) &
+                     cover8x8_exact_ref(v0x + v01x, v0y + v01y, -v01x - v20x, -v01y - v20y) &
+                     cover8x8_exact_ref(v0x, v0y, v20x, v20y);
+        }
+        else
+        {
+          coverage = cover8x8_conservative_ref(v0x, v0y, v01x, v01y) &
+                     cover8x8_conservative_ref(v0x + v01x, v0y + v01y, -v01x - v20x, -v01y - v20y) &
+                     cover8x8_conservative_ref(v0x, v0y, v20x, v20y);
+        }
+
+        if (enableQuads)
+        {
+          coverage |= coverage >> 1;
+          coverage |= coverage >> 8;
+          coverage &= 0x0055005500550055ULL;
+          numFrags += (F32)(popc64(coverage) << 2);
+        }
+        else
+        {
+          numFrags += (F32)popc64(coverage);
+        }
+        numTris += 1.0f;
+      }
+    }
+
+    // Chunks of one draw add up.
+    m_channels[Channel_Triangles][tileIdx] += numTris;
+    m_channels[Channel_Fragments][tileIdx] += numFrags;
+  }
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::savePFM(const std::string& fileName, Channel c) const
+{
+  // PFM rows go bottom to top, like the tiles.
+  FILE* file = openFile(fileName);
+  fprintf(file, "Pf\n%d %d\n-1.0\n", m_sizeTiles.x, m_sizeTiles.y);
+  if (!getChannel(c).empty()) {
+    fwrite(&getChannel(c)[0], sizeof(F32), getChannel(c).size(), file);
+  }
+  fclose(file);
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::savePPM(const std::string& fileName, Channel c) const
+{
+  F32 scale = getMax(c);
+  scale = (scale > 0.0f) ? 1.0f / scale : 0.0f;
+
+  // PPM rows go top to bottom.
+  std::vector<U8> rgb(m_sizeTiles.x * m_sizeTiles.y * 3);
+  for (int y = 0; y < m_sizeTiles.y; ++y)
+  for (int x = 0; x < m_sizeTiles.x; ++x)
+  {
+    U8* dst = &rgb[((m_sizeTiles.y - 1 - y) * m_sizeTiles.x + x) * 3];
+    heatColor(getValue(c, x, y) * scale, dst);
+  }
+
+  FILE* file = openFile(fileName);
+  fprintf(file, "P6\n%d %d\n255\n", m_sizeTiles.x, m_sizeTiles.y);
+  if (!rgb.empty()) {
+    fwrite(&rgb[0], 1, rgb.size(), file);
+  }
+  fclose(file);
+}
+
+//------------------------------------------------------------------------
+
+void RasterHeatmap::saveRaw(const std::string& fileName, Channel c) const
+{
+  FILE* file = openFile(fileName);
+  if (!getChannel(c).empty()) {
+    fwrite(&getChannel(c)[0], sizeof(F32), getChannel(c).size(), file);
+  }
+  fclose(file);
+}
+
+//------------------------------------------------------------------------
+
+const char* RasterHeatmap::getChannelName(Channel c)
+{
+  switch (c)
+  {
+    case Channel_Triangles: return "tris";
+    case Channel_Fragments: return "frags";
+    case Channel_FineTime:  return "finetime";
+    default:                return "invalid";
+  }
+}
+
+} // namespace FW
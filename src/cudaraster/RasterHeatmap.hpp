@@ -0,0 +1,94 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERHEATMAP_HPP_
+#define CUDARASTER_RASTERHEATMAP_HPP_
+
+#include <string>
+#include <vector>
+
+#include "CudaRaster.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Per-tile load of the previous drawTriangles() call, see 
+// CudaRaster::setHeatmap().
+//
+// Triangle counts follow the tileSegCount chains written by CoarseRaster
+// and fragment counts replay the FineRaster pixel coverage test on the 
+// host. FineRaster time is only known per tile when the stage is emulated
+// (DebugParams::emulateFineRaster), otherwise that channel stays zero.
+// Row 0 is the bottom row of tiles, as in the surfaces.
+//------------------------------------------------------------------------
+
+class RasterHeatmap
+{
+  public:
+    enum Channel
+    {
+      Channel_Triangles = 0,  // Triangles binned to the tile.
+      Channel_Fragments,      // Pixels (or quad pixels) they cover.
+      Channel_FineTime,       // Seconds spent by the emulated FineRaster.
+
+      Channel_Max
+    };
+
+  private:
+    Vec2i               m_sizeTiles;
+    bool                m_hasFineTime;
+    std::vector<F32>    m_channels[Channel_Max];  // m_sizeTiles.x * m_sizeTiles.y.
+
+  public:
+    RasterHeatmap(void);
+
+    void                clear           (void);
+
+    const Vec2i&        getSizeTiles    (void) const            { return m_sizeTiles; }
+    bool                hasFineTime     (void) const            { return m_hasFineTime; }
+    const std::vector<F32>& getChannel  (Channel c) const       { FW_ASSERT(c >= 0 && c < Channel_Max); return m_channels[c]; }
+    F32                 getValue        (Channel c, int tileX, int tileY) const;
+
+    F32                 getMax          (Channel c) const;
+    F32                 getMean         (Channel c) const;      // Over tiles with triangles.
+
+    // Called from drawTriangles(): beginDraw() before launching, 
+    // setFineTime() from the FineRaster emulation, record() once done.
+    // Chunks of one draw add up into the same channels.
+    void                beginDraw       (const CudaRaster& raster);
+    void                setFineTime     (int tileIdx, F32 seconds);
+    void                record          (CudaRaster& raster);
+
+    // PFM: F32 values as is. PPM: normalized by getMax() on a heat ramp.
+    // Raw: F32 array, row-major from row 0, no header.
+    void                savePFM         (const std::string& fileName, Channel c) const;
+    void                savePPM         (const std::string& fileName, Channel c) const;
+    void                saveRaw         (const std::string& fileName, Channel c) const;
+
+    static const char*  getChannelName  (Channel c);
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERHEATMAP_HPP_
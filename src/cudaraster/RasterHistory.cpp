@@ -0,0 +1,175 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterHistory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+RasterHistory::RasterHistory(int capacity)
+  : m_numAdded(0)
+{
+  setCapacity(capacity);
+}
+
+//------------------------------------------------------------------------
+
+void RasterHistory::setCapacity(int capacity)
+{
+  FW_ASSERT(capacity >= 0);
+  m_frames.resize(capacity);
+  reset();
+}
+
+//------------------------------------------------------------------------
+
+void RasterHistory::add(const CudaRaster::Stats& stats, const CRAtomics& atomics)
+{
+  if (m_frames.empty()) {
+    return;
+  }
+
+  Frame& f  = m_frames[(size_t)(m_numAdded % (S64)m_frames.size())];
+  f.stats   = stats;
+  f.atomics = atomics;
+  m_numAdded++;
+}
+
+//------------------------------------------------------------------------
+
+int RasterHistory::getNumFrames(void) const
+{
+  return (int)min(m_numAdded, (S64)m_frames.size());
+}
+
+//------------------------------------------------------------------------
+
+const RasterHistory::Frame& RasterHistory::getFrame(int idx) const
+{
+  FW_ASSERT(idx >= 0 && idx < getNumFrames());
+  S64 first = m_numAdded - getNumFrames();
+  return m_frames[(size_t)((first + idx) % (S64)m_frames.size())];
+}
+
+//------------------------------------------------------------------------
+
+F64 RasterHistory::getPercentile(Metric m, F64 percent) const
+{
+  int numFrames = getNumFrames();
+  if (numFrames == 0) {
+    return 0.0;
+  }
+
+  std::vector<F64> values(numFrames);
+  for (int i = 0; i < numFrames; ++i) {
+    values[i] = getValue(getFrame(i), m);
+  }
+
+  int rank = (int)ceil(clamp(percent, 0.0, 100.0) * 0.01 * numFrames);
+  int idx  = clamp(rank - 1, 0, numFrames - 1);
+  std::nth_element(values.begin(), values.begin() + idx, values.end());
+  return values[idx];
+}
+
+//------------------------------------------------------------------------
+
+F64 RasterHistory::getMean(Metric m) const
+{
+  int numFrames = getNumFrames();
+  F64 sum = 0.0;
+  for (int i = 0; i < numFrames; ++i) {
+    sum += getValue(getFrame(i), m);
+  }
+  return (numFrames) ? sum / numFrames : 0.0;
+}
+
+//------------------------------------------------------------------------
+
+std::string RasterHistory::toString(void) const
+{
+  std::string s;
+  char buffer[256];
+
+  snprintf( buffer, sizeof(buffer), "%-16s %12s %12s %12s %12s   (%d frames, times in ms)\n", 
+            "", "p50", "p95", "p99", "max", getNumFrames());
+  s += buffer;
+
+  for (int i = 0; i < Metric_Max; ++i)
+  {
+    Metric m = (Metric)i;
+    F64 scale = (m <= Metric_TotalTime) ? 1.0e3 : 1.0;
+    snprintf( buffer, sizeof(buffer), "%-16s %12.4f %12.4f %12.4f %12.4f\n", 
+              getMetricName(m), 
+              getPercentile(m, 50.0) * scale, getPercentile(m, 95.0) * scale,
+              getPercentile(m, 99.0) * scale, getMax(m) * scale);
+    s += buffer;
+  }
+  return s;
+}
+
+//------------------------------------------------------------------------
+
+F64 RasterHistory::getValue(const Frame& f, Metric m)
+{
+  switch (m)
+  {
+    case Metric_SetupTime:      return f.stats.setupTime;
+    case Metric_BinTime:        return f.stats.binTime;
+    case Metric_CoarseTime:     return f.stats.coarseTime;
+    case Metric_FineTime:       return f.stats.fineTime;
+    case Metric_TotalTime:      return (F64)f.stats.setupTime + f.stats.binTime + 
+                                       f.stats.coarseTime + f.stats.fineTime;
+    case Metric_NumSubtris:     return f.atomics.numSubtris;
+    case Metric_NumBinSegs:     return f.atomics.numBinSegs;
+    case Metric_NumTileSegs:    return f.atomics.numTileSegs;
+    case Metric_NumActiveTiles: return f.atomics.numActiveTiles;
+    default:                    FW_ASSERT(false); return 0.0;
+  }
+}
+
+//------------------------------------------------------------------------
+
+const char* RasterHistory::getMetricName(Metric m)
+{
+  switch (m)
+  {
+    case Metric_SetupTime:      return "setup";
+    case Metric_BinTime:        return "bin";
+    case Metric_CoarseTime:     return "coarse";
+    case Metric_FineTime:       return "fine";
+    case Metric_TotalTime:      return "total";
+    case Metric_NumSubtris:     return "numSubtris";
+    case Metric_NumBinSegs:     return "numBinSegs";
+    case Metric_NumTileSegs:    return "numTileSegs";
+    case Metric_NumActiveTiles: return "numActiveTiles";
+    default:                    return "invalid";
+  }
+}
+
+} // namespace FW
@@ -0,0 +1,95 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERHISTORY_HPP_
+#define CUDARASTER_RASTERHISTORY_HPP_
+
+#include <string>
+#include <vector>
+
+#include "CudaRaster.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Stats and CRAtomics of the last N drawTriangles() calls, see 
+// CudaRaster::setHistorySize(). Once full, each new frame replaces the 
+// oldest one. Percentiles use the nearest-rank method.
+//------------------------------------------------------------------------
+
+class RasterHistory
+{
+  public:
+    enum Metric
+    {
+      Metric_SetupTime = 0,   // Seconds.
+      Metric_BinTime,
+      Metric_CoarseTime,
+      Metric_FineTime,
+      Metric_TotalTime,
+      Metric_NumSubtris,      // CRAtomics.
+      Metric_NumBinSegs,
+      Metric_NumTileSegs,
+      Metric_NumActiveTiles,
+
+      Metric_Max
+    };
+
+    struct Frame
+    {
+      CudaRaster::Stats stats;
+      CRAtomics         atomics;
+    };
+
+  private:
+    std::vector<Frame>  m_frames;     // Ring of getCapacity() entries.
+    S64                 m_numAdded;   // Since the last reset().
+
+  public:
+    explicit RasterHistory(int capacity = 0);
+
+    void                setCapacity     (int capacity);   // Implies reset().
+    int                 getCapacity     (void) const      { return (int)m_frames.size(); }
+    void                reset           (void)            { m_numAdded = 0; }
+
+    void                add             (const CudaRaster::Stats& stats, const CRAtomics& atomics);
+
+    int                 getNumFrames    (void) const;
+    S64                 getNumAdded     (void) const      { return m_numAdded; }
+    const Frame&        getFrame        (int idx) const;  // 0 = oldest.
+
+    F64                 getPercentile   (Metric m, F64 percent) const;
+    F64                 getMax          (Metric m) const  { return getPercentile(m, 100.0); }
+    F64                 getMean         (Metric m) const;
+
+    // One line per metric: p50, p95, p99, max (times in milliseconds).
+    std::string         toString        (void) const;
+
+    static F64          getValue        (const Frame& frame, Metric m);
+    static const char*  getMetricName   (Metric m);
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERHISTORY_HPP_
@@ -0,0 +1,228 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterPerf.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+namespace {
+
+#ifdef __linux__
+
+void setupAttr(RasterPerf::Event e, perf_event_attr& attr)
+{
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.disabled       = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  const U64 cacheMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  switch (e)
+  {
+    case RasterPerf::Event_Cycles:
+      attr.type   = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    break;
+
+    case RasterPerf::Event_Instructions:
+      attr.type   = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    break;
+
+    case RasterPerf::Event_LLCMisses:
+      attr.type   = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_LL | cacheMiss;
+    break;
+
+    case RasterPerf::Event_DTLBMisses:
+      attr.type   = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | cacheMiss;
+    break;
+
+    case RasterPerf::Event_BranchMisses:
+      attr.type   = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+    break;
+
+    default:
+      FW_ASSERT(false);
+    break;
+  }
+}
+
+#endif
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+RasterPerf::RasterPerf(void)
+{
+  for (int i = 0; i < Event_Max; ++i) {
+    m_fds[i] = -1;
+  }
+  clearSample(m_begin);
+}
+
+RasterPerf::~RasterPerf(void)
+{
+  close();
+}
+
+//------------------------------------------------------------------------
+
+bool RasterPerf::open(void)
+{
+  close();
+
+#ifdef __linux__
+  for (int i = 0; i < Event_Max; ++i)
+  {
+    perf_event_attr attr;
+    setupAttr((Event)i, attr);
+
+    // This thread, any CPU.
+    int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd == -1) {
+      continue;
+    }
+
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    m_fds[i] = fd;
+  }
+#endif
+
+  return isOpen();
+}
+
+//------------------------------------------------------------------------
+
+void RasterPerf::close(void)
+{
+  for (int i = 0; i < Event_Max; ++i)
+  {
+#ifdef __linux__
+    if (m_fds[i] != -1) {
+      ::close(m_fds[i]);
+    }
+#endif
+    m_fds[i] = -1;
+  }
+}
+
+//------------------------------------------------------------------------
+
+bool RasterPerf::isOpen(void) const
+{
+  for (int i = 0; i < Event_Max; ++i) {
+    if (m_fds[i] != -1) return true;
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------
+
+void RasterPerf::begin(void)
+{
+  m_begin = read();
+}
+
+//------------------------------------------------------------------------
+
+void RasterPerf::end(Sample& total)
+{
+  Sample curr = read();
+
+  for (int i = 0; i < Event_Max; ++i)
+  {
+    if (curr.values[i] == -1) {
+      continue;
+    }
+    total.values[i] = max(total.values[i], (S64)0) + max(curr.values[i] - m_begin.values[i], (S64)0);
+  }
+}
+
+//------------------------------------------------------------------------
+
+RasterPerf::Sample RasterPerf::read(void) const
+{
+  Sample s;
+  clearSample(s);
+
+#ifdef __linux__
+  for (int i = 0; i < Event_Max; ++i)
+  {
+    U64 data[3]; // value, time enabled, time running.
+    if (m_fds[i] == -1 || ::read(m_fds[i], data, sizeof(data)) != (ssize_t)sizeof(data)) {
+      continue;
+    }
+
+    // Multiplexed => extrapolate to the enabled time.
+    F64 scale = (data[2] != 0) ? (F64)data[1] / (F64)data[2] : 0.0;
+    s.values[i] = (S64)((F64)data[0] * scale + 0.5);
+  }
+#endif
+
+  return s;
+}
+
+//------------------------------------------------------------------------
+
+void RasterPerf::clearSample(Sample& s)
+{
+  for (int i = 0; i < Event_Max; ++i) {
+    s.values[i] = -1;
+  }
+}
+
+//------------------------------------------------------------------------
+
+const char* RasterPerf::getEventName(Event e)
+{
+  switch (e)
+  {
+    case Event_Cycles:        return "cycles";
+    case Event_Instructions:  return "instructions";
+    case Event_LLCMisses:     return "llcMisses";
+    case Event_DTLBMisses:    return "dtlbMisses";
+    case Event_BranchMisses:  return "branchMisses";
+    default:                  return "invalid";
+  }
+}
+
+} // namespace FW
@@ -0,0 +1,92 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERPERF_HPP_
+#define CUDARASTER_RASTERPERF_HPP_
+
+#include <base/Defs.hpp>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Linux hardware counters (perf_event_open) of the calling thread, user 
+// space only, see CudaRaster::setPerfCounters().
+//
+// Each event is opened on its own, so a kernel or VM that lacks one still
+// reports the others; events that cannot be opened (perf_event_paranoid, 
+// seccomp, non-Linux build) are left unavailable and read as -1. Values
+// are scaled when the kernel multiplexes the counters.
+//------------------------------------------------------------------------
+
+class RasterPerf
+{
+  public:
+    enum Event
+    {
+      Event_Cycles = 0,
+      Event_Instructions,
+      Event_LLCMisses,
+      Event_DTLBMisses,
+      Event_BranchMisses,
+
+      Event_Max
+    };
+
+    struct Sample
+    {
+      S64 values[Event_Max];    // -1 if unavailable.
+    };
+
+  private:
+    S32     m_fds[Event_Max];   // -1 if unavailable.
+    Sample  m_begin;
+
+  public:
+    RasterPerf(void);
+    ~RasterPerf(void);
+
+    // Opens the counters for the calling thread; false if none is available.
+    bool                open            (void);
+    void                close           (void);
+    bool                isAvailable     (Event e) const   { return (m_fds[e] != -1); }
+    bool                isOpen          (void) const;
+
+    // Adds the counts between begin() and end() to 'total'.
+    void                begin           (void);
+    void                end             (Sample& total);
+
+    static void         clearSample     (Sample& s);
+    static const char*  getEventName    (Event e);
+
+  private:
+    Sample              read            (void) const;
+
+  private:
+    RasterPerf          (const RasterPerf&);            // forbidden
+    RasterPerf&         operator= (const RasterPerf&);  // forbidden
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERPERF_HPP_
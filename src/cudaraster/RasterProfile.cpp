@@ -0,0 +1,259 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterProfile.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+namespace {
+
+void appendf(std::string& s, const char* fmt, ...)
+{
+  char buffer[512];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buffer, sizeof(buffer), fmt, args);
+  va_end(args);
+  s += buffer;
+}
+
+void appendEntriesJSON(std::string& s, const char* key, 
+                       const std::vector<RasterProfile::Entry>& entries)
+{
+  appendf(s, ",\n  \"%s\": {", key);
+
+  bool first = true;
+  for (size_t i = 0u; i < entries.size(); ++i)
+  {
+    const RasterProfile::Entry& e = entries[i];
+    if (e.isHeader()) {
+      continue;
+    }
+
+    appendf( s, "%s\n    \"%s\": { \"value\": %.9g, \"num\": %.9g, \"denom\": %.9g", 
+             (first) ? "" : ",", e.name, e.value, e.num, e.denom);
+    if (e.parent >= 0) {
+      appendf(s, ", \"parent\": \"%s\"", entries[e.parent].name);
+    }
+    s += " }";
+    first = false;
+  }
+  s += "\n  }";
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+bool RasterProfile::Entry::isHeader(void) const
+{
+  return (strchr(format, '%') == NULL);
+}
+
+//------------------------------------------------------------------------
+
+RasterProfile::RasterProfile(void)
+  : profilingMode(-1),
+    subtriBytes(0),
+    binSegBytes(0),
+    tileSegBytes(0),
+    allocatedBytes(0)
+{
+  memset(&stats, 0, sizeof(stats));
+  memset(&atomics, 0, sizeof(atomics));
+}
+
+//------------------------------------------------------------------------
+
+const RasterProfile::Entry* RasterProfile::findEntry(const std::string& name) const
+{
+  for (size_t i = 0u; i < counters.size(); ++i) {
+    if (name == counters[i].name) return &counters[i];
+  }
+  for (size_t i = 0u; i < timers.size(); ++i) {
+    if (name == timers[i].name) return &timers[i];
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------
+
+std::string RasterProfile::toString(void) const
+{
+  std::string s("\n");
+
+  if (profilingMode == -1) 
+  {
+    s += "Pixel pipe not set!\n";
+  }
+  else if (profilingMode == ProfilingMode_Default)
+  {
+    F32 pctCoef = 100.0f / (stats.setupTime + stats.binTime + stats.coarseTime + stats.fineTime);
+
+    s += "ProfilingMode_Default\n";
+    s += "---------------------\n";
+    s += "\n";
+
+    appendf(s, "%-16s%.3f ms (%.0f%%)\n", "triangleSetup", stats.setupTime * 1.0e3f, stats.setupTime * pctCoef);
+    appendf(s, "%-16s%.3f ms (%.0f%%)\n", "binRaster", stats.binTime * 1.0e3f, stats.binTime * pctCoef);
+    appendf(s, "%-16s%.3f ms (%.0f%%)\n", "coarseRaster", stats.coarseTime * 1.0e3f, stats.coarseTime * pctCoef);
+    appendf(s, "%-16s%.3f ms (%.0f%%)\n", "fineRaster", stats.fineTime * 1.0e3f, stats.fineTime * pctCoef);
+    s += "\n";
+
+    appendf(s, "%-16s%-10d(%.1f MB)\n", "numSubtris", atomics.numSubtris, (F32)subtriBytes * exp2(-20));
+    appendf(s, "%-16s%-10d(%.1f MB)\n", "numBinSegs", atomics.numBinSegs, (F32)binSegBytes * exp2(-20));
+    appendf(s, "%-16s%-10d(%.1f MB)\n", "numTileSegs", atomics.numTileSegs, (F32)tileSegBytes * exp2(-20));
+  }
+  else if (profilingMode == ProfilingMode_Counters)
+  {
+    s += "ProfilingMode_Counters\n";
+    s += "----------------------\n";
+    s += "\n";
+
+    for (size_t i = 0u; i < counters.size(); ++i) {
+      appendf(s, counters[i].format, counters[i].value);
+    }
+  }
+  else if (profilingMode == ProfilingMode_Timers)
+  {
+    s += "ProfilingMode_Timers\n";
+    s += "--------------------\n";
+    s += "\n";
+
+    for (size_t i = 0u; i < timers.size(); ++i) {
+      appendf(s, timers[i].format, timers[i].value);
+    }
+  }
+  else
+  {
+    s += "Invalid profiling mode!\n";
+  }
+
+  if (!perf.empty())
+  {
+    s += "\nHost perf counters (emulated stages):\n";
+    appendf(s, "%-8s", "");
+    for (int j = 0; j < RasterPerf::Event_Max; ++j) {
+      appendf(s, "%14s", RasterPerf::getEventName((RasterPerf::Event)j));
+    }
+    appendf(s, "%8s\n", "IPC");
+
+    for (size_t i = 0u; i < perf.size(); ++i)
+    {
+      const S64* v = perf[i].sample.values;
+      appendf(s, "%-8s", perf[i].stage);
+      for (int j = 0; j < RasterPerf::Event_Max; ++j) 
+      {
+        if (v[j] < 0) {
+          appendf(s, "%14s", "n/a");
+        } else {
+          appendf(s, "%14lld", (long long)v[j]);
+        }
+      }
+
+      if (v[RasterPerf::Event_Cycles] > 0 && v[RasterPerf::Event_Instructions] >= 0) {
+        appendf(s, "%8.2f\n", (F64)v[RasterPerf::Event_Instructions] / (F64)v[RasterPerf::Event_Cycles]);
+      } else {
+        appendf(s, "%8s\n", "n/a");
+      }
+    }
+  }
+
+  s += "\n";
+  return s;
+}
+
+//------------------------------------------------------------------------
+
+std::string RasterProfile::toJSON(void) const
+{
+  static const char* const modeNames[] = { "default", "counters", "timers" };
+
+  std::string s("{\n");
+
+  if (profilingMode < ProfilingMode_First || profilingMode > ProfilingMode_Last)
+  {
+    s += "  \"profilingMode\": null\n}\n";
+    return s;
+  }
+
+  appendf(s, "  \"profilingMode\": \"%s\",\n", modeNames[profilingMode]);
+
+  appendf( s, "  \"stats\": { \"setupTime\": %.6g, \"binTime\": %.6g, "
+              "\"coarseTime\": %.6g, \"fineTime\": %.6g },\n", 
+           stats.setupTime, stats.binTime, stats.coarseTime, stats.fineTime);
+
+  appendf( s, "  \"atomics\": { \"numSubtris\": %d, \"binCounter\": %d, "
+              "\"numBinSegs\": %d, \"coarseCounter\": %d, \"numTileSegs\": %d, "
+              "\"numActiveTiles\": %d, \"fineCounter\": %d },\n",
+           atomics.numSubtris, atomics.binCounter, atomics.numBinSegs, 
+           atomics.coarseCounter, atomics.numTileSegs, atomics.numActiveTiles, 
+           atomics.fineCounter);
+
+  appendf( s, "  \"memory\": { \"subtriBytes\": %lld, \"binSegBytes\": %lld, "
+              "\"tileSegBytes\": %lld, \"allocatedBytes\": %lld }",
+           (long long)subtriBytes, (long long)binSegBytes, 
+           (long long)tileSegBytes, (long long)allocatedBytes);
+
+  if (profilingMode == ProfilingMode_Counters) {
+    appendEntriesJSON(s, "counters", counters);
+  } else if (profilingMode == ProfilingMode_Timers) {
+    appendEntriesJSON(s, "timers", timers);
+  }
+
+  // Unavailable events are null.
+  if (!perf.empty())
+  {
+    s += ",\n  \"perf\": {";
+    for (size_t i = 0u; i < perf.size(); ++i)
+    {
+      appendf(s, "%s\n    \"%s\": {", (i) ? "," : "", perf[i].stage);
+      for (int j = 0; j < RasterPerf::Event_Max; ++j)
+      {
+        S64 v = perf[i].sample.values[j];
+        appendf(s, "%s \"%s\": ", (j) ? "," : "", RasterPerf::getEventName((RasterPerf::Event)j));
+        if (v < 0) {
+          s += "null";
+        } else {
+          appendf(s, "%lld", (long long)v);
+        }
+      }
+      s += " }";
+    }
+    s += "\n  }";
+  }
+
+  s += "\n}\n";
+  return s;
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
@@ -0,0 +1,90 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERPROFILE_HPP_
+#define CUDARASTER_RASTERPROFILE_HPP_
+
+#include <string>
+#include <vector>
+
+#include "CudaRaster.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Profiling data of the previous drawTriangles() call, see 
+// CudaRaster::getProfile(). The fields depend on the CR_PROFILING_MODE the
+// pixel pipe was compiled with; toString() gives the getProfilingInfo()
+// text and toJSON() the same values as a JSON object.
+//------------------------------------------------------------------------
+
+class RasterProfile
+{
+  public:
+    struct Entry  // One CR_PROFILING_COUNTERS / CR_PROFILING_TIMERS item.
+    {
+      const char* name;     // Identifier, e.g. "SetupViewportCull".
+      const char* format;   // Text layout.
+      S32         parent;   // Timers: index of the parent timer, -1 if none.
+      F64         num;      // Counters: numerator, timers: cycles.
+      F64         denom;    // Counters: denominator, timers: parent cycles.
+      F64         value;    // Displayed value, num / denom (in % for timers).
+
+      bool isHeader(void) const;  // Section title, no value.
+    };
+
+    struct PerfEntry  // Host counters of one emulated stage.
+    {
+      const char*         stage;  // RasterSnapshot::getStageName().
+      RasterPerf::Sample  sample;
+    };
+
+  public:
+    S32                 profilingMode;    // -1 if no pixel pipe is set.
+
+    // Always filled when a pixel pipe is set.
+    CudaRaster::Stats   stats;
+    CRAtomics           atomics;
+    S64                 subtriBytes;      // Used by the previous draw, summed over chunks.
+    S64                 binSegBytes;
+    S64                 tileSegBytes;
+    S64                 allocatedBytes;   // All internal buffers.
+
+    std::vector<Entry>  counters;         // ProfilingMode_Counters.
+    std::vector<Entry>  timers;           // ProfilingMode_Timers.
+    std::vector<PerfEntry> perf;          // CudaRaster::setPerfCounters().
+
+
+  public:
+    RasterProfile(void);
+
+    const Entry* findEntry(const std::string& name) const;  // NULL if absent.
+
+    std::string toString(void) const;
+    std::string toJSON(void) const;
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERPROFILE_HPP_
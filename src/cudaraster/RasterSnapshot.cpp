@@ -0,0 +1,400 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterSnapshot.hpp"
+
+#include <cstring>
+#include <io/File.hpp>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+#define CR_SNAPSHOT_MAGIC   0x53535243u // "CRSS"
+#define CR_SNAPSHOT_VERSION 2   // 2: index format.
+
+//------------------------------------------------------------------------
+
+RasterSnapshot::RasterSnapshot(CudaRaster::Stage stage)
+  : m_stage (stage)
+{
+  FW_ASSERT(stage >= 0 && stage < CudaRaster::Stage_Max);
+  clear();
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::clear(void)
+{
+  m_valid         = false;
+  m_pipeName      = "";
+  memset(&m_pipeSpec, 0, sizeof(m_pipeSpec));
+  m_viewportSize  = 0;
+  m_numSamples    = 1;
+  m_numTris       = 0;
+  m_indexFormat   = IndexFormat_U32;
+  m_binBatchSize  = 0;
+  m_deferredClear = false;
+  m_clearColor    = 0;
+  m_clearDepth    = 0;
+  m_maxSubtris    = 1;
+  m_maxBinSegs    = 1;
+  m_maxTileSegs   = 1;
+  memset(&m_atomics, 0, sizeof(m_atomics));
+
+  m_vertices.clear();
+  m_indices.clear();
+  for (int i = 0; i < Slot_Max; ++i) {
+    m_slots[i].clear();
+  }
+  m_color.clear();
+  m_depth.clear();
+}
+
+//------------------------------------------------------------------------
+
+S64 RasterSnapshot::getTotalBytes(void) const
+{
+  S64 total = (S64)(m_vertices.size() + m_indices.size() + m_color.size() + m_depth.size());
+  for (int i = 0; i < Slot_Max; ++i) {
+    total += (S64)m_slots[i].size();
+  }
+  return total;
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::recordInput(CudaRaster& raster)
+{
+  clear();
+
+  m_pipeName      = raster.m_pipeName;
+  m_pipeSpec      = raster.m_pipeSpec;
+  m_viewportSize  = raster.m_viewportSize;
+  m_numSamples    = raster.m_numSamples;
+  m_numTris       = raster.m_numTris;
+  m_indexFormat   = raster.m_indexFormat;
+  m_deferredClear = raster.m_deferredClear;
+  m_clearColor    = raster.m_clearColor;
+  m_clearDepth    = raster.m_clearDepth;
+
+  // Batches, instanced draws and strided vertices are recorded as one plain draw.
+  if (raster.isFlattened())
+  {
+    std::vector<Vec3i> indices;
+    raster.readFlattened(m_vertices, indices);
+    m_indexFormat = IndexFormat_U32;
+    m_indices.resize(indices.size() * sizeof(Vec3i));
+    if (!indices.empty()) {
+      memcpy(&m_indices[0], &indices[0], m_indices.size());
+    }
+  }
+  else
+  {
+    S64 vertexBytes = raster.m_vertexBuffer->getSize() - raster.m_vertexOfs;
+    S64 indexBytes  = raster.getIndexBytes();
+    const U8* vertexPtr = raster.m_vertexBuffer->getPtr(raster.m_vertexOfs);
+    const U8* indexPtr  = raster.m_indexBuffer->getPtr(raster.m_indexOfs);
+
+    m_vertices.assign(vertexPtr, vertexPtr + vertexBytes);
+    m_indices.assign(indexPtr, indexPtr + indexBytes);
+  }
+
+  // FineRaster blends / depth tests against the previous contents.
+  if (m_stage == CudaRaster::Stage_Fine && !m_deferredClear)
+  {
+    m_color.resize((size_t)raster.m_colorBuffer->getNumBytes());
+    m_depth.resize((size_t)raster.m_depthBuffer->getNumBytes());
+    raster.m_colorBuffer->download(&m_color[0]);
+    raster.m_depthBuffer->download(&m_depth[0]);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::recordOutput(CudaRaster& raster)
+{
+  m_binBatchSize = raster.m_binBatchSize;
+  m_maxSubtris   = raster.m_maxSubtris;
+  m_maxBinSegs   = raster.m_maxBinSegs;
+  m_maxTileSegs  = raster.m_maxTileSegs;
+  m_atomics      = *(const CRAtomics*)raster.m_module->getGlobal(CudaRaster::getAtomicsKey()).getPtr();
+
+  // Counters as seen on entry to the stage.
+  if (m_stage <= CudaRaster::Stage_Setup) {
+    m_atomics.numSubtris = m_numTris;
+  }
+  if (m_stage <= CudaRaster::Stage_Bin)
+  {
+    m_atomics.binCounter = 0;
+    m_atomics.numBinSegs = 0;
+  }
+  if (m_stage <= CudaRaster::Stage_Coarse)
+  {
+    m_atomics.coarseCounter  = 0;
+    m_atomics.numTileSegs    = 0;
+    m_atomics.numActiveTiles = 0;
+  }
+  m_atomics.fineCounter = 0;
+
+  for (int i = 0; i < Slot_Max; ++i)
+  {
+    if (getProducer(i) >= m_stage) {
+      continue;
+    }
+
+    const U8* ptr = getBuffer(raster, i).getPtr();
+    m_slots[i].assign(ptr, ptr + getUsedBytes(i));
+  }
+
+  m_valid = true;
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::apply(CudaRaster& raster, Buffer& vertices, Buffer& indices) const
+{
+  if (!m_valid) {
+    fail("RasterSnapshot: Nothing recorded!");
+  }
+  if (raster.m_viewportSize != m_viewportSize || raster.m_numSamples != m_numSamples) {
+    fail("RasterSnapshot: Surfaces do not match the snapshot!");
+  }
+  if (!raster.m_module || raster.m_pipeName != m_pipeName || 
+      raster.m_pipeSpec.vertexStructSize != m_pipeSpec.vertexStructSize ||
+      raster.m_pipeSpec.renderModeFlags != m_pipeSpec.renderModeFlags) {
+    fail("RasterSnapshot: Pixel pipe does not match the snapshot!");
+  }
+
+  vertices.set(m_vertices.empty() ? NULL : &m_vertices[0], (S64)m_vertices.size());
+  indices.set(m_indices.empty() ? NULL : &m_indices[0], (S64)m_indices.size());
+
+  raster.setVertexBuffer(&vertices, 0);
+  raster.setVertexLayout(NULL);   // m_vertices are ShadedVertexSubclass.
+  raster.setIndexBuffer(&indices, 0, m_numTris, m_indexFormat);
+
+  raster.m_deferredClear = m_deferredClear;
+  raster.m_clearColor    = m_clearColor;
+  raster.m_clearDepth    = m_clearDepth;
+  raster.m_binBatchSize  = m_binBatchSize;
+  raster.m_maxSubtris    = m_maxSubtris;
+  raster.m_maxBinSegs    = m_maxBinSegs;
+  raster.m_maxTileSegs   = m_maxTileSegs;
+  raster.allocateBuffers();
+
+  // Upload now, launchStage() binds the buffers without reading them back.
+  for (int i = 0; i < Slot_Max; ++i)
+  {
+    if (m_slots[i].empty()) {
+      continue;
+    }
+
+    Buffer& buf = getBuffer(raster, i);
+    FW_ASSERT((S64)m_slots[i].size() <= buf.getSize());
+    memcpy(buf.getMutablePtr(), &m_slots[i][0], m_slots[i].size());
+    buf.getCudaPtr();
+  }
+
+  reset(raster);
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::reset(CudaRaster& raster) const
+{
+  *(CRAtomics*)raster.m_module->getGlobal(CudaRaster::getAtomicsKey()).getMutablePtrDiscard() = m_atomics;
+
+  if (!m_color.empty())
+  {
+    raster.m_colorBuffer->upload(&m_color[0]);
+    raster.m_depthBuffer->upload(&m_depth[0]);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::readFromStream(InputStream& s)
+{
+  clear();
+
+  U32 magic, version;
+  s >> magic >> version;
+
+  if (magic != CR_SNAPSHOT_MAGIC) {
+    fail("RasterSnapshot: Not a snapshot file!");
+  }
+  if (version < 1 || version > CR_SNAPSHOT_VERSION) {
+    fail("RasterSnapshot: Unsupported snapshot version %u!", version);
+  }
+
+  S32 stage;
+  std::string blendShaderName;
+
+  s >> stage >> m_pipeName;
+  s >> m_pipeSpec.samplesLog2 >> m_pipeSpec.vertexStructSize;
+  s >> m_pipeSpec.renderModeFlags >> m_pipeSpec.profilingMode;
+  s >> blendShaderName;
+  s >> m_viewportSize >> m_numSamples >> m_numTris >> m_binBatchSize;
+  m_indexFormat = IndexFormat_U32;
+  if (version >= 2) {
+    s >> m_indexFormat;
+  }
+  s >> m_deferredClear >> m_clearColor >> m_clearDepth;
+  s >> m_maxSubtris >> m_maxBinSegs >> m_maxTileSegs;
+  s >> m_atomics.numSubtris >> m_atomics.binCounter >> m_atomics.numBinSegs;
+  s >> m_atomics.coarseCounter >> m_atomics.numTileSegs >> m_atomics.numActiveTiles;
+  s >> m_atomics.fineCounter;
+  s >> m_vertices >> m_indices;
+  for (int i = 0; i < Slot_Max; ++i) {
+    s >> m_slots[i];
+  }
+  s >> m_color >> m_depth;
+
+  if (stage < 0 || stage >= CudaRaster::Stage_Max) {
+    fail("RasterSnapshot: Corrupted snapshot!");
+  }
+
+  strncpy(m_pipeSpec.blendShaderName, blendShaderName.c_str(), 
+          sizeof(m_pipeSpec.blendShaderName) - 1);
+  m_stage = (CudaRaster::Stage)stage;
+  m_valid = true;
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::writeToStream(OutputStream& s) const
+{
+  s << (U32)CR_SNAPSHOT_MAGIC << (U32)CR_SNAPSHOT_VERSION;
+  s << (S32)m_stage << m_pipeName;
+  s << m_pipeSpec.samplesLog2 << m_pipeSpec.vertexStructSize;
+  s << m_pipeSpec.renderModeFlags << m_pipeSpec.profilingMode;
+  s << std::string(m_pipeSpec.blendShaderName);
+  s << m_viewportSize << m_numSamples << m_numTris << m_binBatchSize;
+  s << m_indexFormat;
+  s << m_deferredClear << m_clearColor << m_clearDepth;
+  s << m_maxSubtris << m_maxBinSegs << m_maxTileSegs;
+  s << m_atomics.numSubtris << m_atomics.binCounter << m_atomics.numBinSegs;
+  s << m_atomics.coarseCounter << m_atomics.numTileSegs << m_atomics.numActiveTiles;
+  s << m_atomics.fineCounter;
+  s << m_vertices << m_indices;
+  for (int i = 0; i < Slot_Max; ++i) {
+    s << m_slots[i];
+  }
+  s << m_color << m_depth;
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::load(const std::string& fileName)
+{
+  MappedInputStream in(fileName);
+  readFromStream(in);
+}
+
+//------------------------------------------------------------------------
+
+void RasterSnapshot::save(const std::string& fileName) const
+{
+  if (!m_valid) {
+    fail("RasterSnapshot: Nothing recorded!");
+  }
+
+  File file(fileName, File::Create);
+  BufferedOutputStream out(file, 1 << 20);
+  writeToStream(out);
+  out.flush();
+}
+
+//------------------------------------------------------------------------
+
+const char* RasterSnapshot::getStageName(CudaRaster::Stage stage)
+{
+  switch (stage)
+  {
+    case CudaRaster::Stage_Setup:   return "setup";
+    case CudaRaster::Stage_Bin:     return "bin";
+    case CudaRaster::Stage_Coarse:  return "coarse";
+    case CudaRaster::Stage_Fine:    return "fine";
+    default:                        return "invalid";
+  }
+}
+
+//------------------------------------------------------------------------
+
+CudaRaster::Stage RasterSnapshot::getProducer(int slot)
+{
+  if (slot <= Slot_TriData)     return CudaRaster::Stage_Setup;
+  if (slot <= Slot_BinSegCount) return CudaRaster::Stage_Bin;
+  return CudaRaster::Stage_Coarse;
+}
+
+//------------------------------------------------------------------------
+
+Buffer& RasterSnapshot::getBuffer(CudaRaster& raster, int slot)
+{
+  switch (slot)
+  {
+    case Slot_TriSubtris:   return raster.m_triSubtris;
+    case Slot_TriHeader:    return raster.m_triHeader;
+    case Slot_TriData:      return raster.m_triData;
+    case Slot_BinFirstSeg:  return raster.m_binFirstSeg;
+    case Slot_BinTotal:     return raster.m_binTotal;
+    case Slot_BinSegData:   return raster.m_binSegData;
+    case Slot_BinSegNext:   return raster.m_binSegNext;
+    case Slot_BinSegCount:  return raster.m_binSegCount;
+    case Slot_ActiveTiles:  return raster.m_activeTiles;
+    case Slot_TileFirstSeg: return raster.m_tileFirstSeg;
+    case Slot_TileSegData:  return raster.m_tileSegData;
+    case Slot_TileSegNext:  return raster.m_tileSegNext;
+    default:                FW_ASSERT(slot == Slot_TileSegCount); 
+                            return raster.m_tileSegCount;
+  }
+}
+
+//------------------------------------------------------------------------
+
+S64 RasterSnapshot::getUsedBytes(int slot) const
+{
+  S64 numSubtris  = m_atomics.numSubtris;
+  S64 numBinSegs  = m_atomics.numBinSegs;
+  S64 numTileSegs = m_atomics.numTileSegs;
+
+  switch (slot)
+  {
+    case Slot_TriSubtris:   return numSubtris * sizeof(U8);
+    case Slot_TriHeader:    return numSubtris * sizeof(CRTriangleHeader);
+    case Slot_TriData:      return numSubtris * sizeof(CRTriangleData);
+    case Slot_BinFirstSeg:  
+    case Slot_BinTotal:     return CR_MAXBINS_SQR * CR_BIN_STREAMS_SIZE * sizeof(S32);
+    case Slot_BinSegData:   return numBinSegs * CR_BIN_SEG_SIZE * sizeof(S32);
+    case Slot_BinSegNext:   
+    case Slot_BinSegCount:  return numBinSegs * sizeof(S32);
+    case Slot_ActiveTiles:  
+    case Slot_TileFirstSeg: return CR_MAXTILES_SQR * sizeof(S32);
+    case Slot_TileSegData:  return numTileSegs * CR_TILE_SEG_SIZE * sizeof(S32);
+    default:                return numTileSegs * sizeof(S32);
+  }
+}
+
+} // namespace FW
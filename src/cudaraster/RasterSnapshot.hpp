@@ -0,0 +1,146 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERSNAPSHOT_HPP_
+#define CUDARASTER_RASTERSNAPSHOT_HPP_
+
+#include <string>
+#include <vector>
+#include <gpu/Buffer.hpp>
+#include <io/Stream.hpp>
+
+#include "CudaRaster.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Pipeline state at the boundary before one stage of a drawTriangles() 
+// call, see CudaRaster::setSnapshot().
+//
+// Holds the outputs of every preceding stage, the CRAtomics as the stage 
+// sees them on entry and, for FineRaster without deferred clear, the 
+// surfaces as they were before the draw. apply() / reset() restore that 
+// state so CudaRaster::launchStage() can run the stage alone, repeatedly.
+//------------------------------------------------------------------------
+
+class RasterSnapshot : public Serializable
+{
+  private:
+    enum Slot
+    {
+      Slot_TriSubtris = 0,    // Setup output.
+      Slot_TriHeader,
+      Slot_TriData,
+      Slot_BinFirstSeg,       // Bin output.
+      Slot_BinTotal,
+      Slot_BinSegData,
+      Slot_BinSegNext,
+      Slot_BinSegCount,
+      Slot_ActiveTiles,       // Coarse output.
+      Slot_TileFirstSeg,
+      Slot_TileSegData,
+      Slot_TileSegNext,
+      Slot_TileSegCount,
+
+      Slot_Max
+    };
+
+  private:
+    CudaRaster::Stage       m_stage;
+    bool                    m_valid;
+
+    std::string             m_pipeName;
+    PixelPipeSpec           m_pipeSpec;
+    Vec2i                   m_viewportSize;
+    S32                     m_numSamples;
+    S32                     m_numTris;
+    S32                     m_indexFormat;
+    S32                     m_binBatchSize;
+
+    bool                    m_deferredClear;
+    U32                     m_clearColor;
+    U32                     m_clearDepth;
+
+    S32                     m_maxSubtris;
+    S32                     m_maxBinSegs;
+    S32                     m_maxTileSegs;
+    CRAtomics               m_atomics;
+
+    std::vector<U8>         m_vertices;
+    std::vector<U8>         m_indices;
+    std::vector<U8>         m_slots[Slot_Max];
+    std::vector<U8>         m_color;    // Empty unless needed by the stage.
+    std::vector<U8>         m_depth;
+
+  public:
+    explicit RasterSnapshot(CudaRaster::Stage stage = CudaRaster::Stage_Fine);
+    virtual ~RasterSnapshot(void) {}
+
+    void                    clear           (void);
+    void                    setStage        (CudaRaster::Stage stage)   { clear(); m_stage = stage; }
+
+    bool                    isValid         (void) const    { return m_valid; }
+    CudaRaster::Stage       getStage        (void) const    { return m_stage; }
+    const std::string&      getPipeName     (void) const    { return m_pipeName; }
+    const PixelPipeSpec&    getPipeSpec     (void) const    { return m_pipeSpec; }
+    const Vec2i&            getViewportSize (void) const    { return m_viewportSize; }
+    int                     getNumSamples   (void) const    { return m_numSamples; }
+    int                     getNumTris      (void) const    { return m_numTris; }
+    int                     getIndexFormat  (void) const    { return m_indexFormat; }
+    S64                     getTotalBytes   (void) const;
+
+    // Called from drawTriangles(), before launching and once done.
+    void                    recordInput     (CudaRaster& raster);
+    void                    recordOutput    (CudaRaster& raster);
+
+    // Restores the recorded state into 'raster', whose surfaces and pixel 
+    // pipe must match getViewportSize() / getPipeSpec(). Geometry goes to 
+    // the given buffers. Implies reset().
+    void                    apply           (CudaRaster& raster, Buffer& vertices, Buffer& indices) const;
+
+    // Restores what the stage itself modifies (atomics, surfaces); call 
+    // before each CudaRaster::launchStage().
+    void                    reset           (CudaRaster& raster) const;
+
+    virtual void            readFromStream  (InputStream& s);
+    virtual void            writeToStream   (OutputStream& s) const;
+
+    void                    load            (const std::string& fileName);
+    void                    save            (const std::string& fileName) const;
+
+    static const char*      getStageName    (CudaRaster::Stage stage);
+
+  private:
+    static CudaRaster::Stage getProducer    (int slot);
+    static Buffer&          getBuffer       (CudaRaster& raster, int slot);
+    S64                     getUsedBytes    (int slot) const;
+
+  private:
+    RasterSnapshot          (const RasterSnapshot&);            // forbidden
+    RasterSnapshot&         operator= (const RasterSnapshot&);  // forbidden
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERSNAPSHOT_HPP_
@@ -0,0 +1,220 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterTrace.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <base/Timer.hpp>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+RasterTrace::RasterTrace(int capacityPerThread)
+  : m_origin      (Timer::queryTime()),
+    m_capacity    (1),
+    m_numThreads  (0)
+{
+  FW_ASSERT(capacityPerThread > 0);
+  while (m_capacity < capacityPerThread) {
+    m_capacity <<= 1;
+  }
+  memset(m_rings, 0, sizeof(m_rings));
+}
+
+RasterTrace::~RasterTrace(void)
+{
+  for (int i = 0; i < MaxThreads; ++i) {
+    delete m_rings[i];
+  }
+}
+
+//------------------------------------------------------------------------
+
+int RasterTrace::addThread(const char* name)
+{
+  int thread = __sync_fetch_and_add(&m_numThreads, 1);
+  if (thread >= MaxThreads) {
+    fail("RasterTrace: More than %d threads!", (int)MaxThreads);
+  }
+
+  Ring* ring      = new Ring;
+  ring->name      = name;
+  ring->events.resize(m_capacity);
+  ring->numPushed = 0;
+
+  __sync_synchronize();
+  m_rings[thread] = ring;
+  return thread;
+}
+
+//------------------------------------------------------------------------
+
+int RasterTrace::getNumThreads(void) const
+{
+  return min((int)m_numThreads, (int)MaxThreads);
+}
+
+//------------------------------------------------------------------------
+
+S64 RasterTrace::getNumDropped(void) const
+{
+  S64 dropped = 0;
+  for (int i = 0; i < getNumThreads(); ++i) {
+    if (m_rings[i] && m_rings[i]->numPushed > (U64)m_capacity) {
+      dropped += (S64)(m_rings[i]->numPushed - m_capacity);
+    }
+  }
+  return dropped;
+}
+
+//------------------------------------------------------------------------
+
+void RasterTrace::clear(void)
+{
+  for (int i = 0; i < getNumThreads(); ++i) {
+    if (m_rings[i]) {
+      m_rings[i]->numPushed = 0;
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+F64 RasterTrace::getTime(void) const
+{
+  return (Timer::queryTime() - m_origin) * 1.0e6;
+}
+
+//------------------------------------------------------------------------
+
+void RasterTrace::addSpan(int thread, const char* name, const char* category, 
+                          F64 begin, F64 end, S64 idx)
+{
+  Event e;
+  e.name     = name;
+  e.category = category;
+  e.phase    = Phase_Span;
+  e.arg      = idx;
+  e.begin    = begin;
+  e.duration = max(end - begin, 0.0);
+  push(thread, e);
+}
+
+//------------------------------------------------------------------------
+
+void RasterTrace::addCounter(int thread, const char* name, F64 time, S64 value)
+{
+  Event e;
+  e.name     = name;
+  e.category = "";
+  e.phase    = Phase_Counter;
+  e.arg      = value;
+  e.begin    = time;
+  e.duration = 0.0;
+  push(thread, e);
+}
+
+//------------------------------------------------------------------------
+
+void RasterTrace::push(int thread, const Event& e)
+{
+  FW_ASSERT(thread >= 0 && thread < getNumThreads() && m_rings[thread]);
+
+  // Single writer per ring => no synchronization.
+  Ring& ring = *m_rings[thread];
+  ring.events[(size_t)(ring.numPushed & (U64)(m_capacity - 1))] = e;
+  ring.numPushed++;
+}
+
+//------------------------------------------------------------------------
+
+std::string RasterTrace::toJSON(void) const
+{
+  std::string s = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  char buffer[512];
+  bool first = true;
+
+  for (int i = 0; i < getNumThreads(); ++i)
+  {
+    const Ring* ring = m_rings[i];
+    if (!ring) {
+      continue;
+    }
+
+    snprintf( buffer, sizeof(buffer), 
+              "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+              "\"args\": {\"name\": \"%s\"}}", 
+              (first) ? "" : ",", i, ring->name);
+    s += buffer;
+    first = false;
+
+    // Oldest to newest.
+    U64 numEvents = min(ring->numPushed, (U64)m_capacity);
+    for (U64 j = ring->numPushed - numEvents; j < ring->numPushed; ++j)
+    {
+      const Event& e = ring->events[(size_t)(j & (U64)(m_capacity - 1))];
+
+      if (e.phase == Phase_Counter)
+      {
+        snprintf( buffer, sizeof(buffer),
+                  ",\n{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, "
+                  "\"args\": {\"value\": %lld}}",
+                  e.name, e.begin, i, (long long)e.arg);
+      }
+      else
+      {
+        snprintf( buffer, sizeof(buffer),
+                  ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                  "\"dur\": %.3f, \"pid\": 1, \"tid\": %d",
+                  e.name, e.category, e.begin, e.duration, i);
+        s += buffer;
+        if (e.arg >= 0) {
+          snprintf(buffer, sizeof(buffer), ", \"args\": {\"idx\": %lld}}", (long long)e.arg);
+        } else {
+          snprintf(buffer, sizeof(buffer), "}");
+        }
+      }
+      s += buffer;
+    }
+  }
+
+  s += "\n]}\n";
+  return s;
+}
+
+//------------------------------------------------------------------------
+
+void RasterTrace::save(const std::string& fileName) const
+{
+  FILE* file = fopen(fileName.c_str(), "w");
+  if (!file) {
+    fail("RasterTrace: Cannot open '%s'!", fileName.c_str());
+  }
+  fputs(toJSON().c_str(), file);
+  fclose(file);
+}
+
+} // namespace FW
@@ -0,0 +1,111 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERTRACE_HPP_
+#define CUDARASTER_RASTERTRACE_HPP_
+
+#include <string>
+#include <vector>
+#include <base/Defs.hpp>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Timeline of the draws issued to a CudaRaster, exported as Chrome / 
+// Perfetto trace-event JSON, see CudaRaster::setTrace().
+//
+// Every thread writing to the trace registers once with addThread() and 
+// owns the returned ring buffer, so recording takes no lock. A full ring 
+// overwrites its oldest events. Names are not copied: pass string literals.
+// Exporting must not overlap with recording (e.g. call it between draws).
+//------------------------------------------------------------------------
+
+class RasterTrace
+{
+  public:
+    enum
+    {
+      MaxThreads = 64
+    };
+
+    enum Phase
+    {
+      Phase_Span = 0,   // "X" : complete event.
+      Phase_Counter     // "C" : counter sample.
+    };
+
+    struct Event
+    {
+      const char* name;
+      const char* category;
+      S32         phase;
+      S64         arg;      // Span: "idx" argument (-1 = none), counter: value.
+      F64         begin;    // Microseconds, see getTime().
+      F64         duration;
+    };
+
+  private:
+    struct Ring
+    {
+      const char*         name;
+      std::vector<Event>  events;     // Power-of-two size.
+      U64                 numPushed;
+    };
+
+    F64             m_origin;
+    S32             m_capacity;
+    Ring*           m_rings[MaxThreads];
+    volatile S32    m_numThreads;
+
+  public:
+    explicit RasterTrace(int capacityPerThread = 1 << 16);
+    ~RasterTrace(void);
+
+    // Returns the slot of the calling thread; lock-free.
+    int             addThread       (const char* name);
+    int             getNumThreads   (void) const;
+    S64             getNumDropped   (void) const;   // Overwritten events.
+    void            clear           (void);         // Keeps the threads.
+
+    // Microseconds since the trace was created.
+    F64             getTime         (void) const;
+
+    void            addSpan         (int thread, const char* name, const char* category, 
+                                     F64 begin, F64 end, S64 idx = -1);
+    void            addCounter      (int thread, const char* name, F64 time, S64 value);
+
+    std::string     toJSON          (void) const;
+    void            save            (const std::string& fileName) const;
+
+  private:
+    void            push            (int thread, const Event& e);
+
+  private:
+    RasterTrace     (const RasterTrace&);             // forbidden
+    RasterTrace&    operator= (const RasterTrace&);   // forbidden
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERTRACE_HPP_
@@ -0,0 +1,421 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "RasterUtil.hpp"
+
+#include <cmath>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Host equivalents of the PTX intrinsics used below.
+//------------------------------------------------------------------------
+
+namespace {
+
+inline U32  getLo           (S64 a)                 { return (U32)a; }
+inline S32  getHi           (S64 a)                 { return (S32)(a >> 32); }
+inline U64  combineLoHi     (U32 lo, U32 hi)        { return ((U64)hi << 32) | lo; }
+inline U32  slct            (U32 a, U32 b, S32 c)   { return (c >= 0) ? a : b; }
+inline S32  slct            (S32 a, S32 b, S32 c)   { return (c >= 0) ? a : b; }
+inline F32  slct            (F32 a, F32 b, S32 c)   { return (c >= 0) ? a : b; }
+inline U32  isetge          (S32 a, S32 b)          { return (a >= b) ? FW_U32_MAX : 0u; }
+inline S32  add_clamp_0_x   (S32 a, S32 b, S32 c)   { return min(max(a + b, 0), c); }
+
+// add.cc / addc pair: a += b, returns the carry out.
+inline U32 addCarry(U32& a, U32 b)
+{
+  U64 sum = (U64)a + b;
+  a = (U32)sum;
+  return (U32)(sum >> 32);
+}
+
+// cvt.rni.s64.f32, saturating.
+inline S64 f32_to_s64(F32 a)
+{
+  F64 v = rint((F64)a);
+  if (v != v)                           return 0;
+  if (v >= 9223372036854775807.0)       return FW_S64_MAX;
+  if (v <= -9223372036854775808.0)      return FW_S64_MIN;
+  return (S64)v;
+}
+
+// cvt.rni.sat.u32.f32.
+inline U32 f32_to_u32_sat(F32 a)
+{
+  F64 v = rint((F64)a);
+  return (v > 0.0) ? (U32)min(v, 4294967295.0) : 0u;
+}
+
+// nvcc contracts a * b + c into a single FMA.
+inline F32 mad(F32 a, F32 b, F32 c)
+{
+  return fmaf(a, b, c);
+}
+
+#define S(SAMPLES_LOG2, X, Y) \
+    { \
+        (X * 2 + 1 - (1 << SAMPLES_LOG2)) * (1 << (CR_SUBPIXEL_LOG2 - SAMPLES_LOG2 - 1)), \
+        (Y * 2 + 1 - (1 << SAMPLES_LOG2)) * (1 << (CR_SUBPIXEL_LOG2 - SAMPLES_LOG2 - 1)) \
+    }
+const int c_msaaPatternsFast[4][16][2] = { CR_MSAA_PATTERNS(S) };
+#undef S
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+Vec3i setupPleq(const Vec3f& values, const Vec2i& v0, const Vec2i& d1, 
+                const Vec2i& d2, F32 areaRcp, int samplesLog2)
+{
+  F32 mx = max(values.x, values.y, values.z);
+  int sh = min(max(((S32)floatToBits(mx) >> 23) - (127 + 22), 0), 8);
+  S32 t0 = (U32)values.x >> sh;
+  S32 t1 = ((U32)values.y >> sh) - t0;
+  S32 t2 = ((U32)values.z >> sh) - t0;
+
+  U32 rcpMant = (floatToBits(areaRcp) & 0x007FFFFF) | 0x00800000;
+  int rcpShift = (23 + 127) - (S32)(floatToBits(areaRcp) >> 23);
+
+  S64 xc = ((S64)t1 * d2.y - (S64)t2 * d1.y) * rcpMant;
+  S64 yc = ((S64)t2 * d1.x - (S64)t1 * d2.x) * rcpMant;
+  U32 px = (U32)(xc >> (rcpShift - (sh + CR_SUBPIXEL_LOG2 - samplesLog2)));
+  U32 py = (U32)(yc >> (rcpShift - (sh + CR_SUBPIXEL_LOG2 - samplesLog2)));
+
+  S32 centerX = (v0.x * 2 + min(d1.x, d2.x, 0) + max(d1.x, d2.x, 0)) >> (CR_SUBPIXEL_LOG2 - samplesLog2 + 1);
+  S32 centerY = (v0.y * 2 + min(d1.y, d2.y, 0) + max(d1.y, d2.y, 0)) >> (CR_SUBPIXEL_LOG2 - samplesLog2 + 1);
+  S32 vcx = v0.x - (centerX << (CR_SUBPIXEL_LOG2 - samplesLog2));
+  S32 vcy = v0.y - (centerY << (CR_SUBPIXEL_LOG2 - samplesLog2));
+
+  U32 pz = (U32)t0 << sh;
+  pz -= (U32)(((xc >> 13) * vcx + (yc >> 13) * vcy) >> (rcpShift - (sh + 13)));
+  pz -= px * centerX + py * centerY;
+  return Vec3i(px, py, pz);
+}
+
+//------------------------------------------------------------------------
+
+Vec3i setupPleq_ref(const Vec3f& values, const Vec2i& v0, const Vec2i& d1, 
+                    const Vec2i& d2, S32 area, int samplesLog2)
+{
+  F64 t0 = (F64)values.x;
+  F64 t1 = (F64)values.y - t0;
+  F64 t2 = (F64)values.z - t0;
+  F64 xc = (t1 * (F64)d2.y - t2 * (F64)d1.y) / (F64)area;
+  F64 yc = (t2 * (F64)d1.x - t1 * (F64)d2.x) / (F64)area;
+
+  Vec2i center = (v0 * 2 + min(d1, d2, Vec2i(0)) + max(d1, d2, Vec2i(0))) >> (CR_SUBPIXEL_LOG2 - samplesLog2 + 1);
+  Vec2i vc = v0 - (center << (CR_SUBPIXEL_LOG2 - samplesLog2));
+
+  Vec3i pleq;
+  pleq.x = (U32)(S64)floor(xc * exp2(CR_SUBPIXEL_LOG2 - samplesLog2) + 0.5);
+  pleq.y = (U32)(S64)floor(yc * exp2(CR_SUBPIXEL_LOG2 - samplesLog2) + 0.5);
+  pleq.z = (U32)(S64)floor(t0 - xc * (F64)vc.x - yc * (F64)vc.y + 0.5);
+  pleq.z -= pleq.x * center.x + pleq.y * center.y;
+  return pleq;
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_exact_ref(S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S64 curr = (S64)ox * dy - (S64)oy * dx;
+  S64 stepX = (S64)-dy << CR_SUBPIXEL_LOG2;
+  S64 stepY = (S64)+dx << CR_SUBPIXEL_LOG2;
+  if (dy > 0 || (dy == 0 && dx <= 0)) curr--; // exclusive
+  return cover8x8_generateMask_ref(curr, stepX, stepY);
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_conservative_ref(S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S64 curr = (S64)ox * dy - (S64)oy * dx;
+  S64 stepX = (S64)-dy << CR_SUBPIXEL_LOG2;
+  S64 stepY = (S64)+dx << CR_SUBPIXEL_LOG2;
+  if (dy > 0 || (dy == 0 && dx <= 0)) curr--; // exclusive
+  curr += (abs(stepX) + abs(stepY)) >> 1;
+  return cover8x8_generateMask_ref(curr, stepX, stepY);
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_generateMask_ref(S64 curr, S64 stepX, S64 stepY)
+{
+  stepY -= stepX * 7;
+  U32 lo = 0;
+  U32 hi = 0;
+  for (int i = 0; i < 32; i++)
+  {
+    lo = slct(lo | (1u << i), lo, getHi(curr));
+    curr += ((i & 7) == 7) ? stepY : stepX;
+  }
+  for (int i = 0; i < 32; i++)
+  {
+    hi = slct(hi | (1u << i), hi, getHi(curr));
+    curr += ((i & 7) == 7) ? stepY : stepX;
+  }
+  return combineLoHi(lo, hi);
+}
+
+//------------------------------------------------------------------------
+
+bool cover8x8_missesTile(S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S32 bias = 7 << (CR_SUBPIXEL_LOG2 - 1);
+  S64 center = (S64)(bias - ox) * dy - (S64)(bias - oy) * dx;
+  S32 extent = (abs(dx) + abs(dy)) << (CR_SUBPIXEL_LOG2 + 2);
+  return (abs(center) >= extent);
+}
+
+//------------------------------------------------------------------------
+
+void cover8x8_setupLUT(U64* lut)
+{
+  for (S32 lutIdx = 0; lutIdx < CR_COVER8X8_LUT_SIZE; lutIdx++)
+  {
+    int half       = (lutIdx < (12 << 5)) ? 0 : 1;
+    int yint       = (lutIdx >> 5) - half * 12 - 3;
+    U32 shape      = ((lutIdx >> 2) & 7) << (31 - 2);
+    S32 slctSwapXY = lutIdx << (31 - 1);
+    S32 slctNegX   = lutIdx << (31 - 0);
+    S32 slctCompl  = slctSwapXY ^ slctNegX;
+
+    U64 mask = 0;
+    int xlo = half * 4;
+    int xhi = xlo + 4;
+    for (int x = xlo; x < xhi; x++)
+    {
+      int ylo = slct(0, max(yint, 0), slctCompl);
+      int yhi = slct(min(yint, 8), 8, slctCompl);
+      for (int y = ylo; y < yhi; y++)
+      {
+        int xx = slct(x, y, slctSwapXY);
+        int yy = slct(y, x, slctSwapXY);
+        xx = slct(xx, 7 - xx, slctNegX);
+        mask |= (U64)1 << (xx + yy * 8);
+      }
+      yint += shape >> 31;
+      shape <<= 1;
+    }
+    lut[lutIdx] = mask;
+  }
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_exact_fast(S32 ox, S32 oy, S32 dx, S32 dy, U32 flips, const U64* lut)
+{
+  F32  yinitBias  = (F32)(1 << (31 - CR_MAXVIEWPORT_LOG2 - CR_SUBPIXEL_LOG2 * 2));
+  F32  yinitScale = (F32)(1 << (32 - CR_SUBPIXEL_LOG2));
+  F32  yincScale  = 65536.0f * 65536.0f;
+
+  S32  slctFlipY  = flips << (31 - CR_FLIPBIT_FLIP_Y);
+  S32  slctFlipX  = flips << (31 - CR_FLIPBIT_FLIP_X);
+  S32  slctSwapXY = flips << (31 - CR_FLIPBIT_SWAP_XY);
+
+  // Evaluate cross product.
+
+  S32 t = (S32)((U32)ox * dy - (U32)oy * dx);
+  F32 det = (F32)slct(t, (S32)(t - (U32)dy * (7 << CR_SUBPIXEL_LOG2)), slctFlipX);
+  if (flips >= (1 << CR_FLIPBIT_COMPL))
+    det = -det;
+
+  // Represent Y as a function of X.
+
+  F32 xrcp  = 1.0f / (F32)abs(slct(dx, dy, slctSwapXY));
+  F32 yzero = mad(det * yinitScale, xrcp, yinitBias);
+  S64 yinit = f32_to_s64(slct(yzero, -yzero, slctFlipY));
+  U32 yinc  = f32_to_u32_sat((F32)abs(slct(dy, dx, slctSwapXY)) * xrcp * yincScale);
+
+  // Lookup.
+
+  return cover8x8_lookupMask(yinit, yinc, flips, lut);
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_conservative_fast(S32 ox, S32 oy, S32 dx, S32 dy, U32 flips, const U64* lut)
+{
+  F32  halfPixel  = (F32)(1 << (CR_SUBPIXEL_LOG2 - 1));
+  F32  yinitBias  = (F32)(1 << (31 - CR_MAXVIEWPORT_LOG2 - CR_SUBPIXEL_LOG2 * 2));
+  F32  yinitScale = (F32)(1 << (32 - CR_SUBPIXEL_LOG2));
+  F32  yincScale  = 65536.0f * 65536.0f;
+
+  S32  slctFlipY  = flips << (31 - CR_FLIPBIT_FLIP_Y);
+  S32  slctFlipX  = flips << (31 - CR_FLIPBIT_FLIP_X);
+  S32  slctSwapXY = flips << (31 - CR_FLIPBIT_SWAP_XY);
+
+  // Evaluate cross product.
+
+  S32 t = (S32)((U32)ox * dy - (U32)oy * dx);
+  F32 det = (F32)slct(t, (S32)(t - (U32)dy * (7 << CR_SUBPIXEL_LOG2)), slctFlipX);
+
+  F32 xabs = (F32)abs(slct(dx, dy, slctSwapXY));
+  F32 yabs = (F32)abs(slct(dy, dx, slctSwapXY));
+  det = mad(yabs, halfPixel, mad(xabs, halfPixel, det));
+
+  if (flips >= (1 << CR_FLIPBIT_COMPL))
+    det = -det;
+
+  // Represent Y as a function of X.
+
+  F32 xrcp  = 1.0f / xabs;
+  F32 yzero = mad(det * yinitScale, xrcp, yinitBias);
+  S64 yinit = f32_to_s64(slct(yzero, -yzero, slctFlipY));
+  U32 yinc  = f32_to_u32_sat(yabs * xrcp * yincScale);
+
+  // Lookup.
+
+  return cover8x8_lookupMask(yinit, yinc, flips, lut);
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_lookupMask(S64 yinit, U32 yinc, U32 flips, const U64* lut)
+{
+  // First half.
+
+  U32 yfrac = getLo(yinit);
+  S32 shape = add_clamp_0_x(getHi(yinit) + 4, 0, 11);
+  shape += shape + addCarry(yfrac, yinc);
+  shape += shape + addCarry(yfrac, yinc);
+  shape += shape + addCarry(yfrac, yinc);
+  int oct = flips & ((1 << CR_FLIPBIT_FLIP_X) | (1 << CR_FLIPBIT_SWAP_XY));
+  U64 mask = *(const U64*)((const U8*)lut + oct + (shape << 5));
+
+  // Second half.
+
+  shape += shape + addCarry(yfrac, yinc);
+  shape = add_clamp_0_x(getHi(yinit) + 4, popc32(shape & 15), 11);
+  shape += shape + addCarry(yfrac, yinc);
+  shape += shape + addCarry(yfrac, yinc);
+  shape += shape + addCarry(yfrac, yinc);
+  mask |= *(const U64*)((const U8*)lut + oct + (shape << 5) + (12 << 8));
+  return (flips >= (1 << CR_FLIPBIT_COMPL)) ? ~mask : mask;
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_exact_noLUT(S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S32 curr = (S32)((U32)ox * dy - (U32)oy * dx);
+  if (dy > 0 || (dy == 0 && dx <= 0)) curr--; // exclusive
+  return cover8x8_generateMask_noLUT(curr, dx, dy);
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_conservative_noLUT(S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S32 curr = (S32)((U32)ox * dy - (U32)oy * dx);
+  if (dy > 0 || (dy == 0 && dx <= 0)) curr--; // exclusive
+  curr += (abs(dx) + abs(dy)) << (CR_SUBPIXEL_LOG2 - 1);
+  return cover8x8_generateMask_noLUT(curr, dx, dy);
+}
+
+//------------------------------------------------------------------------
+
+U64 cover8x8_generateMask_noLUT(S32 curr, S32 dx, S32 dy)
+{
+  U32 acc = (U32)curr + (U32)(dx - dy) * (7 << CR_SUBPIXEL_LOG2);
+  S32 stepX = dy << (CR_SUBPIXEL_LOG2 + 1);
+  S32 stepYorig = -dx - dy * 7;
+  S32 stepY = stepYorig << (CR_SUBPIXEL_LOG2 + 1);
+
+  U32 hi = isetge((S32)acc, 0);
+  acc += acc;
+  for (int i = 62; i >= 32; i--) {
+    hi += hi + addCarry(acc, ((i & 7) == 7) ? stepY : stepX);
+  }
+
+  U32 lo = 0;
+  for (int i = 31; i >= 0; i--) {
+    lo += lo + addCarry(acc, ((i & 7) == 7) ? stepY : stepX);
+  }
+
+  lo ^= lo >> 1,  hi ^= hi >> 1;
+  lo ^= lo >> 2,  hi ^= hi >> 2;
+  lo ^= lo >> 4,  hi ^= hi >> 4;
+  lo ^= lo >> 8,  hi ^= hi >> 8;
+  lo ^= lo >> 16, hi ^= hi >> 16;
+
+  if (dy < 0)
+  {
+    lo ^= 0x55AA55AA;
+    hi ^= 0x55AA55AA;
+  }
+  if (stepYorig < 0)
+  {
+    lo ^= 0xFF00FF00;
+    hi ^= 0x00FF00FF;
+  }
+  if ((hi & 1) != 0)
+    lo = ~lo;
+
+  return combineLoHi(lo, hi);
+}
+
+//------------------------------------------------------------------------
+
+U32 coverMSAA_ref(int samplesLog2, S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S64 base = (S64)ox * dy - (S64)oy * dx;
+  S64 stepX = (S64)-dy << (CR_SUBPIXEL_LOG2 - samplesLog2);
+  S64 stepY = (S64)+dx << (CR_SUBPIXEL_LOG2 - samplesLog2);
+  base -= ((stepX + stepY) * ((1 << samplesLog2) - 1)) >> 1;
+  if (dy > 0 || (dy == 0 && dx <= 0)) base--; // exclusive
+
+  U32 mask = 0;
+  for (int i = 0; i < (1 << samplesLog2); i++)
+  {
+    S64 value = base;
+    value += c_msaaPatterns[samplesLog2][i] * stepX;
+    value += i * stepY;
+    mask = slct(mask | (1u << i), mask, getHi(value));
+  }
+  return mask;
+}
+
+//------------------------------------------------------------------------
+
+U32 coverMSAA_fast(int samplesLog2, S32 ox, S32 oy, S32 dx, S32 dy)
+{
+  S32 base = (S32)((U32)ox * dy - (U32)oy * dx);
+  if (dy > 0 || (dy == 0 && dx <= 0)) base--; // exclusive
+
+  U32 mask = 0;
+  for (int i = 0; i < (1 << samplesLog2); i++)
+  {
+    S32 value = base;
+    value -= c_msaaPatternsFast[samplesLog2][i][0] * dy;
+    value += c_msaaPatternsFast[samplesLog2][i][1] * dx;
+    mask = slct(mask | (1u << i), mask, value);
+  }
+  return mask;
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
@@ -0,0 +1,66 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_RASTERUTIL_HPP_
+#define CUDARASTER_RASTERUTIL_HPP_
+
+#include <base/Math.hpp>
+
+#include "cuda/Util.hpp"
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Host ports of the rasterization primitives of cuda/Util.inl.
+//
+// The PTX intrinsics are replaced by plain C++ with the same results 
+// (rounding, saturation, carry chains), so each function returns the bits
+// its device counterpart would. clipTriangleWithFrustum(), encodeDepth() 
+// and cover8x8_selectFlips() are already shared through cuda/Util.hpp.
+//------------------------------------------------------------------------
+
+// v0 = subpixels relative to the bottom-left sampling point.
+Vec3i setupPleq                   (const Vec3f& values, const Vec2i& v0, const Vec2i& d1, const Vec2i& d2, F32 areaRcp, int samplesLog2);
+Vec3i setupPleq_ref               (const Vec3f& values, const Vec2i& v0, const Vec2i& d1, const Vec2i& d2, S32 area, int samplesLog2); // F64, used by the CudaRaster emulation.
+
+U64   cover8x8_exact_ref          (S32 ox, S32 oy, S32 dx, S32 dy);
+U64   cover8x8_conservative_ref   (S32 ox, S32 oy, S32 dx, S32 dy);
+U64   cover8x8_generateMask_ref   (S64 curr, S64 stepX, S64 stepY);
+bool  cover8x8_missesTile         (S32 ox, S32 oy, S32 dx, S32 dy);
+
+void  cover8x8_setupLUT           (U64* lut); // CR_COVER8X8_LUT_SIZE entries.
+U64   cover8x8_exact_fast         (S32 ox, S32 oy, S32 dx, S32 dy, U32 flips, const U64* lut);
+U64   cover8x8_conservative_fast  (S32 ox, S32 oy, S32 dx, S32 dy, U32 flips, const U64* lut);
+U64   cover8x8_lookupMask         (S64 yinit, U32 yinc, U32 flips, const U64* lut);
+
+U64   cover8x8_exact_noLUT        (S32 ox, S32 oy, S32 dx, S32 dy);
+U64   cover8x8_conservative_noLUT (S32 ox, S32 oy, S32 dx, S32 dy);
+U64   cover8x8_generateMask_noLUT (S32 curr, S32 dx, S32 dy);
+
+U32   coverMSAA_ref               (int samplesLog2, S32 ox, S32 oy, S32 dx, S32 dy);
+U32   coverMSAA_fast              (int samplesLog2, S32 ox, S32 oy, S32 dx, S32 dy);
+
+} // namespace FW
+
+#endif //CUDARASTER_RASTERUTIL_HPP_
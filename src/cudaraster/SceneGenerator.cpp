@@ -0,0 +1,338 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "SceneGenerator.hpp"
+
+#include <cmath>
+#include <cstring>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+namespace {
+
+const char* const s_patternNames[] = 
+{
+  "uniform", "subpixel", "slivers", "overdraw", "nearplane", "guardband"
+};
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+void SceneGenerator::generate(const Params& params)
+{
+  FW_ASSERT(params.pattern >= 0 && params.pattern < Pattern_Max);
+  FW_ASSERT(params.numTris >= 0 && min(params.viewport) > 0);
+
+  m_params = params;
+  if (m_params.size <= 0.0f) {
+    m_params.size = getDefaultSize(m_params.pattern);
+  }
+
+  m_positions.clear();
+  m_indices.clear();
+  m_coveredArea = 0.0;
+  m_state = max(m_params.seed, 1u);
+
+  const F32   size     = m_params.size;
+  const Vec2f viewport = Vec2f(m_params.viewport);
+
+  switch (m_params.pattern)
+  {
+    case Pattern_Uniform:
+    case Pattern_SubPixel:
+    case Pattern_NearPlane:
+    {
+      F32   radius = size / sqrtf(3.0f);
+      Vec2f margin = min(Vec2f(radius), viewport * 0.5f);
+
+      for (int i = 0; i < m_params.numTris; ++i)
+      {
+        Vec2f center = randomPoint(margin);
+        F32   angle  = random() * 2.0f * FW_PI;
+        Vec2f p[3];
+        F32   z[3];
+
+        for (int j = 0; j < 3; ++j)
+        {
+          F32 a = angle + (F32)j * (2.0f / 3.0f) * FW_PI;
+          p[j] = center + Vec2f(cosf(a), sinf(a)) * radius;
+          z[j] = randomDepth();
+        }
+
+        // Push one vertex behind the near plane (z < -w).
+        if (m_params.pattern == Pattern_NearPlane) {
+          z[min((int)(random() * 3.0f), 2)] = -1.1f - random();
+        }
+
+        addTriangle(p[0], p[1], p[2], z[0], z[1], z[2]);
+      }
+      break;
+    }
+
+    case Pattern_Slivers:
+    {
+      Vec2f margin = min(Vec2f(size * 0.5f), viewport * 0.5f);
+
+      for (int i = 0; i < m_params.numTris; ++i)
+      {
+        Vec2f center = randomPoint(margin);
+        F32   angle  = random() * 2.0f * FW_PI;
+        Vec2f dir    = Vec2f(cosf(angle), sinf(angle));
+        F32   z      = randomDepth();
+
+        addTriangle( center - dir * (size * 0.5f), center + dir * (size * 0.5f),
+                     center + dir.perpendicular() * m_params.thickness, z, z, z);
+      }
+      break;
+    }
+
+    case Pattern_Overdraw:
+    {
+      // Back to front, so every layer passes the depth test.
+      int numLayers = (m_params.numTris + 1) / 2;
+
+      for (int i = 0; i < m_params.numTris; ++i)
+      {
+        int layer = i >> 1;
+        int base  = layer * 4;
+
+        if ((i & 1) == 0)
+        {
+          F32 z = 0.9f - 1.8f * (F32)(layer + 1) / (F32)(numLayers + 1);
+          m_positions.push_back(Vec4f(-1.0f, -1.0f, z, 1.0f));
+          m_positions.push_back(Vec4f( 1.0f, -1.0f, z, 1.0f));
+          m_positions.push_back(Vec4f( 1.0f,  1.0f, z, 1.0f));
+          m_positions.push_back(Vec4f(-1.0f,  1.0f, z, 1.0f));
+          m_indices.push_back(Vec3i(base, base + 1, base + 2));
+        } else {
+          m_indices.push_back(Vec3i(base, base + 2, base + 3));
+        }
+        m_coveredArea += viewport.x * viewport.y * 0.5;
+      }
+      break;
+    }
+
+    case Pattern_GuardBand:
+    {
+      // One vertex inside the viewport keeps the triangle visible, the two
+      // others lie 'size' pixels beyond its farthest edge.
+      F32 dist = size + max(viewport.x, viewport.y);
+
+      for (int i = 0; i < m_params.numTris; ++i)
+      {
+        Vec2f p0    = randomPoint(Vec2f(0.0f));
+        F32   angle = random() * 2.0f * FW_PI;
+        F32   delta = 0.2f + random() * 0.8f;
+        F32   z     = randomDepth();
+
+        addTriangle( p0, 
+                     p0 + Vec2f(cosf(angle), sinf(angle)) * dist,
+                     p0 + Vec2f(cosf(angle + delta), sinf(angle + delta)) * dist,
+                     z, z, z);
+      }
+      break;
+    }
+
+    default:
+      FW_ASSERT(false);
+      break;
+  }
+}
+
+//------------------------------------------------------------------------
+
+void SceneGenerator::writeShadedVertices(void* dst, int vertexStructSize) const
+{
+  FW_ASSERT(vertexStructSize >= (int)sizeof(Vec4f));
+
+  U8* ptr = (U8*)dst;
+  memset(ptr, 0, m_positions.size() * vertexStructSize);
+
+  for (size_t i = 0u; i < m_positions.size(); ++i, ptr += vertexStructSize) {
+    memcpy(ptr, &m_positions[i], sizeof(Vec4f));
+  }
+}
+
+//------------------------------------------------------------------------
+
+void SceneGenerator::writeInputVertices(void* dst, int stride) const
+{
+  FW_ASSERT(stride >= (int)sizeof(Vec3f));
+
+  U8* ptr = (U8*)dst;
+  for (size_t i = 0u; i < m_positions.size(); ++i, ptr += stride)
+  {
+    Vec3f pos = m_positions[i].getXYZ();
+    memcpy(ptr, &pos, sizeof(Vec3f));
+  }
+}
+
+//------------------------------------------------------------------------
+
+void SceneGenerator::writeIndices(void* dst) const
+{
+  if (!m_indices.empty()) {
+    memcpy(dst, &m_indices[0], m_indices.size() * sizeof(Vec3i));
+  }
+}
+
+//------------------------------------------------------------------------
+
+const char* SceneGenerator::getPatternName(Pattern pattern)
+{
+  FW_ASSERT(pattern >= 0 && pattern < Pattern_Max);
+  return s_patternNames[pattern];
+}
+
+//------------------------------------------------------------------------
+
+SceneGenerator::Pattern SceneGenerator::findPattern(const char* name)
+{
+  for (int i = 0; i < Pattern_Max; ++i)
+  {
+    if (strcmp(name, s_patternNames[i]) == 0) {
+      return (Pattern)i;
+    }
+  }
+  return Pattern_Max;
+}
+
+//------------------------------------------------------------------------
+
+F32 SceneGenerator::getDefaultSize(Pattern pattern)
+{
+  switch (pattern)
+  {
+    case Pattern_Uniform:   return 8.0f;
+    case Pattern_SubPixel:  return 0.5f;
+    case Pattern_Slivers:   return 512.0f;
+    case Pattern_Overdraw:  return 0.0f;      // Always full-screen.
+    case Pattern_NearPlane: return 64.0f;
+    case Pattern_GuardBand: return 4096.0f;   // Beyond the S16 snapping range.
+    default:                FW_ASSERT(false); return 0.0f;
+  }
+}
+
+//------------------------------------------------------------------------
+
+// xorshift32, so that scenes only depend on the seed.
+F32 SceneGenerator::random(void)
+{
+  m_state ^= m_state << 13;
+  m_state ^= m_state >> 17;
+  m_state ^= m_state << 5;
+  return (F32)(m_state >> 8) * (1.0f / (1 << 24));
+}
+
+//------------------------------------------------------------------------
+
+Vec2f SceneGenerator::randomPoint(const Vec2f& margin)
+{
+  Vec2f viewport = Vec2f(m_params.viewport);
+  Vec2f r;
+  r.x = random();
+  r.y = random();
+  return margin + r * (viewport - margin * 2.0f);
+}
+
+//------------------------------------------------------------------------
+
+F32 SceneGenerator::randomDepth(void)
+{
+  return random() * 1.8f - 0.9f;
+}
+
+//------------------------------------------------------------------------
+
+// Positions in pixels. Swaps p1 / p2 if needed so that the triangle is 
+// not culled as a backface.
+void SceneGenerator::addTriangle( const Vec2f& p0, const Vec2f& p1, const Vec2f& p2, 
+                                  F32 z0, F32 z1, F32 z2)
+{
+  Vec2f scale = 2.0f / Vec2f(m_params.viewport);
+  int   base  = (int)m_positions.size();
+  bool  flip  = (cross(p1 - p0, p2 - p0) < 0.0f);
+
+  m_positions.push_back(Vec4f(p0 * scale - 1.0f, z0, 1.0f));
+  m_positions.push_back(Vec4f(((flip) ? p2 : p1) * scale - 1.0f, (flip) ? z2 : z1, 1.0f));
+  m_positions.push_back(Vec4f(((flip) ? p1 : p2) * scale - 1.0f, (flip) ? z1 : z2, 1.0f));
+  m_indices.push_back(Vec3i(base, base + 1, base + 2));
+
+  m_coveredArea += getClippedArea(p0, p1, p2);
+}
+
+//------------------------------------------------------------------------
+
+// Sutherland-Hodgman against the viewport rectangle.
+F64 SceneGenerator::getClippedArea(const Vec2f& p0, const Vec2f& p1, const Vec2f& p2) const
+{
+  Vec2d poly[16];
+  Vec2d temp[16];
+  int   num = 3;
+
+  poly[0] = Vec2d(p0.x, p0.y);
+  poly[1] = Vec2d(p1.x, p1.y);
+  poly[2] = Vec2d(p2.x, p2.y);
+
+  for (int plane = 0; plane < 4 && num > 0; ++plane)
+  {
+    int    axis  = plane >> 1;
+    F64    bound = (plane & 1) ? (F64)m_params.viewport[axis] : 0.0;
+    F64    sign  = (plane & 1) ? -1.0 : 1.0;
+    int    numOut = 0;
+
+    for (int i = 0; i < num; ++i)
+    {
+      const Vec2d& a = poly[i];
+      const Vec2d& b = poly[(i + 1) % num];
+      F64 da = (a[axis] - bound) * sign;
+      F64 db = (b[axis] - bound) * sign;
+
+      if (da >= 0.0) {
+        temp[numOut++] = a;
+      }
+      if ((da >= 0.0) != (db >= 0.0)) {
+        temp[numOut++] = a + (b - a) * (da / (da - db));
+      }
+    }
+
+    num = numOut;
+    for (int i = 0; i < num; ++i) {
+      poly[i] = temp[i];
+    }
+  }
+
+  F64 area = 0.0;
+  for (int i = 0; i < num; ++i) {
+    area += poly[i].cross(poly[(i + 1) % num]);
+  }
+  return fabs(area) * 0.5;
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
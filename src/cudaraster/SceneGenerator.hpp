@@ -0,0 +1,121 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef CUDARASTER_SCENEGENERATOR_HPP_
+#define CUDARASTER_SCENEGENERATOR_HPP_
+
+#include <vector>
+#include <base/Math.hpp>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Seeded synthetic triangle soups targeting the expensive paths of the 
+// pipeline. The same Params always produce the same buffers.
+//
+// Positions are generated directly in clip space with w = 1, so they can
+// be used either as shaded vertices (clipPos) or as InputVertex::modelPos
+// with an identity posToClip. Every triangle is front facing.
+//------------------------------------------------------------------------
+
+class SceneGenerator
+{
+  public:
+    enum Pattern
+    {
+      Pattern_Uniform = 0,  // Equilateral triangles of 'size' pixels inside the viewport.
+      Pattern_SubPixel,     // Sub-pixel triangles, mostly culled between samples.
+      Pattern_Slivers,      // 'size' pixels long, 'thickness' wide, crossing many bins.
+      Pattern_Overdraw,     // Full-screen quads stacked back to front, 2 triangles each.
+      Pattern_NearPlane,    // One vertex behind the near plane (frustum clipping).
+      Pattern_GuardBand,    // Two vertices 'size' pixels outside the viewport.
+
+      Pattern_Max
+    };
+
+    struct Params
+    {
+      Pattern pattern;
+      S32     numTris;
+      F32     size;         // Pixels, <= 0 selects getDefaultSize(pattern).
+      F32     thickness;    // Pixels, Pattern_Slivers only.
+      Vec2i   viewport;
+      U32     seed;
+
+      Params(void)
+        : pattern(Pattern_Uniform), numTris(100000), size(0.0f), 
+          thickness(0.5f), viewport(1024, 768), seed(1u)
+      {}
+    };
+
+  private:
+    Params              m_params;
+    std::vector<Vec4f>  m_positions;
+    std::vector<Vec3i>  m_indices;
+    F64                 m_coveredArea;
+    U32                 m_state;
+
+
+  public:
+    SceneGenerator(void) : m_coveredArea(0.0), m_state(1u) {}
+
+    void generate(const Params& params);
+
+    const Params& getParams(void) const       { return m_params; }
+    S32 getNumVertices(void) const            { return (S32)m_positions.size(); }
+    S32 getNumTris(void) const                { return (S32)m_indices.size(); }
+    const Vec4f* getPositions(void) const     { return (m_positions.empty()) ? NULL : &m_positions[0]; }
+    const Vec3i* getIndices(void) const       { return (m_indices.empty()) ? NULL : &m_indices[0]; }
+
+    // Sum of the triangle areas clipped to the viewport, in pixels. An 
+    // estimate of the fragment count at one sample per pixel.
+    F64 getCoveredArea(void) const            { return m_coveredArea; }
+
+    // Write clipPos at the start of each 'vertexStructSize' bytes vertex,
+    // zeroing the remaining attributes (ShadedVertexBase layout).
+    void writeShadedVertices(void* dst, int vertexStructSize) const;
+
+    // Write xyz as a Vec3f every 'stride' bytes (InputVertex::modelPos).
+    void writeInputVertices(void* dst, int stride) const;
+
+    void writeIndices(void* dst) const;
+
+    static const char* getPatternName(Pattern pattern);
+    static Pattern findPattern(const char* name);  // Pattern_Max if unknown.
+    static F32 getDefaultSize(Pattern pattern);
+
+  private:
+    F32   random(void);
+    Vec2f randomPoint(const Vec2f& margin);
+    F32   randomDepth(void);
+
+    void  addTriangle(const Vec2f& p0, const Vec2f& p1, const Vec2f& p2, 
+                      F32 z0, F32 z1, F32 z2);
+
+    F64   getClippedArea(const Vec2f& p0, const Vec2f& p1, const Vec2f& p2) const;
+};
+
+} // namespace FW
+
+#endif //CUDARASTER_SCENEGENERATOR_HPP_
@@ -37,6 +37,7 @@
 
 #define CR_MAXSUBTRIS_LOG2      24      // Triangle structs. Dictated by CoarseRaster.
 #define CR_COARSE_QUEUE_LOG2    10      // Triangles.
+#define CR_MAX_VARYINGS         8       // Per vertex layout.
 
 #define CR_SETUP_WARPS          2
 #define CR_SETUP_OPT_BLOCKS     8
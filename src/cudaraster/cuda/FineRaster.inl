@@ -59,7 +59,8 @@ void runFragmentShader( FragmentShaderClass& fs,
 
     uint4 t3 = tex1Dfetch(t_triData, dataIdx * 4 + 3); // vb, vi0, vi1, vi2
 
-    fs.m_triIdx         = triIdx;
+    fs.m_triIdx         = triIdx + c_crParams.firstTri;
+    fs.m_instanceIdx    = (c_crParams.numInstances > 0) ? fs.m_triIdx / c_crParams.instanceTris : 0;
     fs.m_vertIdx        = Vec3i(t3.y, t3.z, t3.w);
     fs.m_pixelPos       = Vec2i(pixelX, pixelY);
     fs.m_vertexBytes    = sizeof(VertexClass);
@@ -130,7 +131,7 @@ void runBlendShader( BlendShaderClass& bs,
                      U32 src, 
                      U32 dst)
 {
-    bs.m_triIdx     = triIdx;
+    bs.m_triIdx     = triIdx + c_crParams.firstTri;
     bs.m_pixelPos   = Vec2i(pixelX, pixelY);
     bs.m_sampleIdx  = sampleIdx;
     bs.m_src        = src;
@@ -34,6 +34,133 @@ enum
   RenderModeFlag_EnableQuads  = 1 << 2,   // Enable numerical derivatives in fragment shader. Degrades performance.
 };
 
+//------------------------------------------------------------------------
+// Index buffer formats, see CudaRaster::setIndexBuffer().
+//------------------------------------------------------------------------
+
+enum
+{
+  IndexFormat_U32 = 0,  // int3 per triangle.
+  IndexFormat_U16,      // 3 * U16 per triangle, tightly packed. Vertices < 65536.
+};
+
+//------------------------------------------------------------------------
+// Index buffer topologies, see CudaRaster::setIndexBuffer().
+//------------------------------------------------------------------------
+
+enum
+{
+  Topology_TriangleList = 0,  // Triangle i = (3i, 3i + 1, 3i + 2).
+  Topology_TriangleStrip,     // Triangle i = (i, i + 1, i + 2), every other one flipped.
+  Topology_TriangleFan,       // Triangle i = (first, i + 1, i + 2).
+};
+
+//------------------------------------------------------------------------
+// Vertex attribute formats, see CudaRaster::setVertexLayout().
+// Missing components read as (0, 0, 0, 1).
+//------------------------------------------------------------------------
+
+enum
+{
+  VertexFormat_F32x4 = 0, // 4 * F32.
+  VertexFormat_F32x3,     // 3 * F32.
+  VertexFormat_F32x2,     // 2 * F32.
+  VertexFormat_F16x4,     // 4 * F16.
+  VertexFormat_UNorm8x4,  // 4 * U8 in [0, 1], x in the lowest byte.
+  VertexFormat_SNorm10,   // 10:10:10:2 bits in [-1, 1], x in the lowest bits.
+
+  VertexFormat_Max
+};
+
+//------------------------------------------------------------------------
+// Byte offset of a varying in a ShadedVertexSubclass, e.g. for 
+// FragmentShaderBase::interpolateVarying(offset, format, bary).
+
+#define CR_VARYING_OFFSET(VERTEX_STRUCT, MEMBER) ((int)(size_t)&((VERTEX_STRUCT*)0)->MEMBER)
+
+//------------------------------------------------------------------------
+// Write 'v' as one attribute of the given format, 1 to 4 U32s.
+
+FW_CUDA_FUNC void encodeVertexAttrib(U32* dst, int format, const Vec4f& v)
+{
+  switch (format)
+  {
+  case VertexFormat_F32x3:
+    dst[0] = floatToBits(v.x), dst[1] = floatToBits(v.y), dst[2] = floatToBits(v.z);
+    break;
+
+  case VertexFormat_F32x2:
+    dst[0] = floatToBits(v.x), dst[1] = floatToBits(v.y);
+    break;
+
+  case VertexFormat_F16x4:
+    dst[0] = encodeHalf(v.x) | (encodeHalf(v.y) << 16);
+    dst[1] = encodeHalf(v.z) | (encodeHalf(v.w) << 16);
+    break;
+
+  case VertexFormat_UNorm8x4:
+    {
+      Vec4f c = v * 255.0f + 0.5f;
+      dst[0] = (U32)clamp(c.x, 0.0f, 255.0f) | ((U32)clamp(c.y, 0.0f, 255.0f) << 8) |
+               ((U32)clamp(c.z, 0.0f, 255.0f) << 16) | ((U32)clamp(c.w, 0.0f, 255.0f) << 24);
+    }
+    break;
+
+  case VertexFormat_SNorm10:
+    {
+      Vec4f c = Vec4f(clamp(v.x, -1.0f, 1.0f), clamp(v.y, -1.0f, 1.0f), clamp(v.z, -1.0f, 1.0f), clamp(v.w, -1.0f, 1.0f));
+      S32 x = (S32)(c.x * 511.0f + ((c.x < 0.0f) ? -0.5f : 0.5f));
+      S32 y = (S32)(c.y * 511.0f + ((c.y < 0.0f) ? -0.5f : 0.5f));
+      S32 z = (S32)(c.z * 511.0f + ((c.z < 0.0f) ? -0.5f : 0.5f));
+      S32 w = (S32)(c.w + ((c.w < 0.0f) ? -0.5f : 0.5f));
+      dst[0] = ((U32)x & 0x3FFu) | (((U32)y & 0x3FFu) << 10) | (((U32)z & 0x3FFu) << 20) | ((U32)w << 30);
+    }
+    break;
+
+  default:
+    dst[0] = floatToBits(v.x), dst[1] = floatToBits(v.y), dst[2] = floatToBits(v.z), dst[3] = floatToBits(v.w);
+    break;
+  }
+}
+
+//------------------------------------------------------------------------
+// Read one attribute as Vec4f. 'offset' must be a multiple of 4.
+
+FW_CUDA_FUNC Vec4f decodeVertexAttrib(const U8* vertex, int offset, int format)
+{
+  const U32* w = (const U32*)(vertex + offset);
+  switch (format)
+  {
+  case VertexFormat_F32x3:
+    return Vec4f(bitsToFloat(w[0]), bitsToFloat(w[1]), bitsToFloat(w[2]), 1.0f);
+
+  case VertexFormat_F32x2:
+    return Vec4f(bitsToFloat(w[0]), bitsToFloat(w[1]), 0.0f, 1.0f);
+
+  case VertexFormat_F16x4:
+    return Vec4f(decodeHalf(w[0] & 0xFFFFu), decodeHalf(w[0] >> 16), 
+                 decodeHalf(w[1] & 0xFFFFu), decodeHalf(w[1] >> 16));
+
+  case VertexFormat_UNorm8x4:
+    return Vec4f((F32)(w[0] & 0xFFu), (F32)((w[0] >> 8) & 0xFFu), 
+                 (F32)((w[0] >> 16) & 0xFFu), (F32)(w[0] >> 24)) * (1.0f / 255.0f);
+
+  case VertexFormat_SNorm10:
+    {
+      // Sign-extend each field from the unsigned word, -512 and -2 clamp to -1.
+      U32 v = w[0];
+      return Vec4f(
+        max((F32)((S32)(v << 22) >> 22) * (1.0f / 511.0f), -1.0f),
+        max((F32)((S32)(v << 12) >> 22) * (1.0f / 511.0f), -1.0f),
+        max((F32)((S32)(v <<  2) >> 22) * (1.0f / 511.0f), -1.0f),
+        max((F32)((S32)v >> 30), -1.0f));
+    }
+
+  default:
+    return Vec4f(bitsToFloat(w[0]), bitsToFloat(w[1]), bitsToFloat(w[2]), bitsToFloat(w[3]));
+  }
+}
+
 //------------------------------------------------------------------------
 // Shaded vertex base class.
 //------------------------------------------------------------------------
@@ -42,8 +169,10 @@ struct ShadedVertexBase
 {
   Vec4f   clipPos;
 
-  // Subclass can add a Vec4f for each varying.
-  // Other data types are forbidden.
+  // Subclass can add a Vec4f for each varying, read by varying index.
+  // Packed varyings are U32s written with encodeVertexAttrib() and read
+  // by CR_VARYING_OFFSET() and format. The size must stay a multiple of
+  // 16 bytes. Other data types are forbidden.
 };
 
 //------------------------------------------------------------------------
@@ -56,6 +185,10 @@ public:
   __device__ __inline__ Vec4f getVaryingAtVertex  (int varyingIdx, int vertIdx) const;
   __device__ __inline__ Vec4f interpolateVarying  (int varyingIdx, const Vec3f& bary) const;
 
+  // Packed varyings, 'format' is one of VertexFormat_XXX.
+  __device__ __inline__ Vec4f getVaryingAtVertex  (int offset, int format, int vertIdx) const;
+  __device__ __inline__ Vec4f interpolateVarying  (int offset, int format, const Vec3f& bary) const;
+
   // Numerical derivatives (only valid when RenderModeFlag_EnableQuads is set).
 
 #if FW_CUDA
@@ -77,6 +210,7 @@ public:
   // Inputs.
 
   S32     m_triIdx;       // Triangle index.
+  S32     m_instanceIdx;  // See CudaRaster::drawTrianglesInstanced(), 0 otherwise.
   Vec3i   m_vertIdx;      // Vertex indices.
   Vec2i   m_pixelPos;     // Integer pixel position.
   S32     m_vertexBytes;  // sizeof(ShadedVertexClass)
@@ -198,8 +332,9 @@ CR_DEFINE_PIXEL_PIPE(AnotherPipeName, ...)
 // Profiling.
 //------------------------------------------------------------------------
 /*
-// To select the type of information returned by CudaRaster::getProfilingInfo(),
-// define CR_PROFILING_MODE before including PixelPipe.inl. Example:
+// To select the type of information returned by CudaRaster::getProfile(),
+// define CR_PROFILING_MODE before including PixelPipe.inl. Counters also
+// cover the stages emulated on the host (CudaRaster::DebugParams). Example:
 
 #define CR_PROFILING_MODE ProfilingMode_Counters
 #include "PixelPipe.inl"
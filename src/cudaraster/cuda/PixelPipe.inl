@@ -43,6 +43,15 @@ extern "C" surface<void, 2>     s_depthBuffer;
 __device__ __inline__ 
 Vec4f FragmentShaderBase::getVaryingAtVertex(int varyingIdx, int vertIdx) const
 {
+    const CRVertexLayout& layout = c_crParams.vertexLayout;
+    if (layout.stride)
+    {
+        if (varyingIdx >= layout.numVaryings)
+            return Vec4f(0.0f, 0.0f, 0.0f, 1.0f);
+        const CRVertexAttrib& a = layout.varyings[varyingIdx];
+        return decodeVertexAttrib((const U8*)c_crParams.vertexBuffer + vertIdx * layout.stride, a.offset, a.format);
+    }
+
     float4 t = tex1Dfetch(t_vertexBuffer, vertIdx * (m_vertexBytes / sizeof(Vec4f)) + varyingIdx + 1);
     return Vec4f(t.x, t.y, t.z, t.w);
 }
@@ -58,6 +67,26 @@ Vec4f FragmentShaderBase::interpolateVarying(int varyingIdx, const Vec3f& bary)
     return v0 * bary.x + v1 * bary.y + v2 * bary.z;
 }
 
+//------------------------------------------------------------------------
+
+__device__ __inline__ 
+Vec4f FragmentShaderBase::getVaryingAtVertex(int offset, int format, int vertIdx) const
+{
+    int stride = (c_crParams.vertexLayout.stride) ? c_crParams.vertexLayout.stride : m_vertexBytes;
+    return decodeVertexAttrib((const U8*)c_crParams.vertexBuffer + vertIdx * stride, offset, format);
+}
+
+//------------------------------------------------------------------------
+
+__device__ __inline__ 
+Vec4f FragmentShaderBase::interpolateVarying(int offset, int format, const Vec3f& bary) const
+{
+    Vec4f v0 = getVaryingAtVertex(offset, format, m_vertIdx.x);
+    Vec4f v1 = getVaryingAtVertex(offset, format, m_vertIdx.y);
+    Vec4f v2 = getVaryingAtVertex(offset, format, m_vertIdx.z);
+    return v0 * bary.x + v1 * bary.y + v2 * bary.z;
+}
+
 //------------------------------------------------------------------------
 // Common shaders.
 //------------------------------------------------------------------------
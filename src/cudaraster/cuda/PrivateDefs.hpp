@@ -61,6 +61,36 @@ struct CRTriangleData
     U32 vi2;
 };
 
+//------------------------------------------------------------------------
+// One draw of a batch, see CudaRaster::drawTriangles(ranges).
+//------------------------------------------------------------------------
+
+struct CRDrawRange
+{
+    S32 firstTri;       // In the concatenated triangle stream.
+    S32 firstIndex;     // Index buffer element of the first triangle.
+    S32 baseVertex;     // Added to every index.
+    S32 pad;
+};
+
+//------------------------------------------------------------------------
+// Strided vertex input, see CudaRaster::setVertexLayout().
+//------------------------------------------------------------------------
+
+struct CRVertexAttrib
+{
+    S32 offset;         // Bytes from the start of the vertex, multiple of 4.
+    S32 format;         // VertexFormat_XXX
+};
+
+struct CRVertexLayout
+{
+    S32             stride;         // 0 = ShadedVertexSubclass.
+    S32             numVaryings;
+    CRVertexAttrib  position;       // Read as clipPos.
+    CRVertexAttrib  varyings[CR_MAX_VARYINGS];
+};
+
 //------------------------------------------------------------------------
 // Device-side globals.
 //------------------------------------------------------------------------
@@ -69,9 +99,20 @@ struct CRParams
 {
     // Common.
 
-    S32         numTris;
-    CUdeviceptr vertexBuffer;       // numVerts * ShadedVertexSubclass
-    CUdeviceptr indexBuffer;        // numTris * int3
+    S32         numTris;            // Of the current chunk.
+    S32         firstTri;           // Chunk offset, added to triangle indices.
+    CUdeviceptr vertexBuffer;       // numVerts * ShadedVertexSubclass, or vertexLayout.stride
+    CRVertexLayout vertexLayout;
+    CUdeviceptr indexBuffer;        // numTris * int3, or numTris * 3 * U16
+    S32         indexFormat;        // IndexFormat_XXX
+    S32         topology;           // Topology_XXX, list during a batch.
+    S32         numRestarts;
+    CUdeviceptr restartTable;       // numRestarts * (S32 position), sorted
+    S32         numDraws;           // 0 = single draw.
+    CUdeviceptr drawTable;          // numDraws * CRDrawRange, sorted by firstTri
+    S32         numInstances;       // 0 = not instanced.
+    S32         instanceTris;       // numTris = instanceTris * numInstances
+    CUdeviceptr instanceBuffer;     // numInstances * Mat4f, applied to clipPos
 
     S32         viewportWidth;      // Viewport size. May be smaller than framebuffer.
     S32         viewportHeight;
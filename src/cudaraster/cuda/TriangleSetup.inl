@@ -216,13 +216,94 @@ void setupTriangle( CRTriangleHeader* th,
 
 //------------------------------------------------------------------------
 
+__device__ __inline__ int readIndex(int i)
+{
+    if (c_crParams.indexFormat == IndexFormat_U16)
+        return ((const U16*)c_crParams.indexBuffer)[i];
+    return ((const S32*)c_crParams.indexBuffer)[i];
+}
+
+//------------------------------------------------------------------------
+// Locate the draw of a batch, then read its indices in either format.
+// Strips and fans start over after the last restart, x = -1 when the
+// triangle spans one.
+
+__device__ __inline__ int3 readTriangleIndices(int taskIdx)
+{
+    if (c_crParams.topology != Topology_TriangleList)
+    {
+        const S32* restarts = (const S32*)c_crParams.restartTable;
+        int lo = 0, hi = c_crParams.numRestarts;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) >> 1;
+            if (restarts[mid] <= taskIdx + 2)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        int first = (lo > 0) ? restarts[lo - 1] + 1 : 0;
+        if (first > taskIdx)
+            return make_int3(-1, -1, -1);
+
+        if (c_crParams.topology == Topology_TriangleFan)
+            return make_int3(readIndex(first), readIndex(taskIdx + 1), readIndex(taskIdx + 2));
+        if (((taskIdx - first) & 1) != 0)
+            return make_int3(readIndex(taskIdx + 1), readIndex(taskIdx), readIndex(taskIdx + 2));
+        return make_int3(readIndex(taskIdx), readIndex(taskIdx + 1), readIndex(taskIdx + 2));
+    }
+
+    int firstIndex = taskIdx * 3;
+    int baseVertex = 0;
+
+    if (c_crParams.numDraws > 0)
+    {
+        const CRDrawRange* draws = (const CRDrawRange*)c_crParams.drawTable;
+        int lo = 0, hi = c_crParams.numDraws - 1;
+        while (lo < hi)
+        {
+            int mid = (lo + hi + 1) >> 1;
+            if (draws[mid].firstTri <= taskIdx)
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        firstIndex = draws[lo].firstIndex + (taskIdx - draws[lo].firstTri) * 3;
+        baseVertex = draws[lo].baseVertex;
+    }
+
+    int3 vidx;
+    if (c_crParams.indexFormat == IndexFormat_U16)
+    {
+        const U16* idx16 = (const U16*)c_crParams.indexBuffer + firstIndex;
+        vidx = make_int3(idx16[0], idx16[1], idx16[2]);
+    }
+    else
+        vidx = *(const int3*)((const S32*)c_crParams.indexBuffer + firstIndex);
+
+    return make_int3(vidx.x + baseVertex, vidx.y + baseVertex, vidx.z + baseVertex);
+}
+
+//------------------------------------------------------------------------
+
+__device__ __inline__ float4 transformInstance(const Mat4f& m, float4 v)
+{
+    return make_float4(
+        m.m00 * v.x + m.m01 * v.y + m.m02 * v.z + m.m03 * v.w,
+        m.m10 * v.x + m.m11 * v.y + m.m12 * v.z + m.m13 * v.w,
+        m.m20 * v.x + m.m21 * v.y + m.m22 * v.z + m.m23 * v.w,
+        m.m30 * v.x + m.m31 * v.y + m.m32 * v.z + m.m33 * v.w);
+}
+
+//------------------------------------------------------------------------
+
 template <class VertexClass, int SamplesLog2, U32 RenderModeFlags>
 __device__ __inline__ void triangleSetupImpl(void)
 {
     __shared__ F32 s_bary[CR_SETUP_WARPS * 32][18];
     F32* bary = s_bary[threadIdx.x + threadIdx.y * 32];
 
-    const int3*         indexBuffer = (const int3*)c_crParams.indexBuffer;
     U8*                 triSubtris  = (U8*)c_crParams.triSubtris;
     CRTriangleHeader*   triHeader   = (CRTriangleHeader*)c_crParams.triHeader;
     CRTriangleData*     triData     = (CRTriangleData*)c_crParams.triData;
@@ -243,11 +324,47 @@ __device__ __inline__ void triangleSetupImpl(void)
     CR_TIMER_IN(SetupTotal);
     CR_TIMER_IN(SetupVertexRead);
 
-    int3 vidx = indexBuffer[taskIdx];
-    int stride = sizeof(VertexClass) / sizeof(Vec4f);
-    float4 v0 = tex1Dfetch(t_vertexBuffer, vidx.x * stride);
-    float4 v1 = tex1Dfetch(t_vertexBuffer, vidx.y * stride);
-    float4 v2 = tex1Dfetch(t_vertexBuffer, vidx.z * stride);
+    // Instances repeat the triangles of the index buffer.
+    int triIdx = taskIdx + c_crParams.firstTri;
+    int instanceIdx = (c_crParams.numInstances > 0) ? triIdx / c_crParams.instanceTris : 0;
+
+    int3 vidx = readTriangleIndices(triIdx - instanceIdx * c_crParams.instanceTris);
+    if (vidx.x < 0) // Primitive restart.
+    {
+        CR_TIMER_OUT(SetupVertexRead);
+        triSubtris[taskIdx] = 0;
+        CR_TIMER_OUT(SetupTotal);
+        CR_TIMER_DEINIT_LARGE_GRID();
+        return;
+    }
+
+    float4 v0, v1, v2;
+    const CRVertexLayout& layout = c_crParams.vertexLayout;
+    if (layout.stride)
+    {
+        const U8* vb = (const U8*)c_crParams.vertexBuffer;
+        Vec4f p0 = decodeVertexAttrib(vb + vidx.x * layout.stride, layout.position.offset, layout.position.format);
+        Vec4f p1 = decodeVertexAttrib(vb + vidx.y * layout.stride, layout.position.offset, layout.position.format);
+        Vec4f p2 = decodeVertexAttrib(vb + vidx.z * layout.stride, layout.position.offset, layout.position.format);
+        v0 = make_float4(p0.x, p0.y, p0.z, p0.w);
+        v1 = make_float4(p1.x, p1.y, p1.z, p1.w);
+        v2 = make_float4(p2.x, p2.y, p2.z, p2.w);
+    }
+    else
+    {
+        int stride = sizeof(VertexClass) / sizeof(Vec4f);
+        v0 = tex1Dfetch(t_vertexBuffer, vidx.x * stride);
+        v1 = tex1Dfetch(t_vertexBuffer, vidx.y * stride);
+        v2 = tex1Dfetch(t_vertexBuffer, vidx.z * stride);
+    }
+
+    if (c_crParams.numInstances > 0)
+    {
+        const Mat4f& m = ((const Mat4f*)c_crParams.instanceBuffer)[instanceIdx];
+        v0 = transformInstance(m, v0);
+        v1 = transformInstance(m, v1);
+        v2 = transformInstance(m, v2);
+    }
 
     CR_TIMER_OUT_DEP(SetupVertexRead, v0.x + v1.x + v2.x);
     CR_TIMER_IN(SetupCullSnap);
@@ -58,6 +58,8 @@ FW_CUDA_FUNC int    clipPolygonWithPlane    (F32* baryOut, const F32* baryIn, in
 FW_CUDA_FUNC int    clipTriangleWithFrustum (F32* bary, const F32* v0, const F32* v1, const F32* v2, const F32* d1, const F32* d2);
 FW_CUDA_FUNC U32    encodeDepth             (U32 depth);
 FW_CUDA_FUNC U32    decodeDepth             (U32 depth);
+FW_CUDA_FUNC U32    encodeHalf              (F32 v);
+FW_CUDA_FUNC F32    decodeHalf              (U32 bits);
 
 //------------------------------------------------------------------------
 
@@ -309,5 +311,57 @@ FW_CUDA_FUNC U32 decodeDepth(U32 depth)
     return (U32)v;
 }
 
+//------------------------------------------------------------------------
+// Round to nearest even.
+
+FW_CUDA_FUNC U32 encodeHalf(F32 v)
+{
+    U32 bits = floatToBits(v);
+    U32 sign = (bits >> 16) & 0x8000u;
+    S32 exp  = (S32)((bits >> 23) & 0xFFu) - 112;
+    U32 mant = bits & 0x7FFFFFu;
+
+    if (exp >= 31) // Overflow, Inf or NaN.
+        return sign | 0x7C00u | ((exp == 143 && mant != 0) ? 0x200u : 0u);
+
+    if (exp <= 0) // Denormal or zero.
+    {
+        if (exp < -10)
+            return sign;
+        mant |= 0x800000u;
+        U32 shift = (U32)(14 - exp);
+        U32 h     = mant >> shift;
+        U32 rem   = mant & ((1u << shift) - 1);
+        U32 tie   = 1u << (shift - 1);
+        if (rem > tie || (rem == tie && (h & 1) != 0))
+            h++;
+        return sign | h;
+    }
+
+    U32 h   = ((U32)exp << 10) | (mant >> 13);
+    U32 rem = mant & 0x1FFFu;
+    if (rem > 0x1000u || (rem == 0x1000u && (h & 1) != 0))
+        h++; // May carry into the exponent, up to Inf.
+    return sign | h;
+}
+
+//------------------------------------------------------------------------
+
+FW_CUDA_FUNC F32 decodeHalf(U32 bits)
+{
+    U32 sign = (bits & 0x8000u) << 16;
+    U32 exp  = (bits >> 10) & 0x1Fu;
+    U32 mant = bits & 0x3FFu;
+
+    if (exp == 0) // Zero or denormal.
+    {
+        F32 v = (F32)mant * (1.0f / 16777216.0f);
+        return (sign) ? -v : v;
+    }
+    if (exp == 31) // Inf or NaN.
+        return bitsToFloat(sign | 0x7F800000u | (mant << 13));
+    return bitsToFloat(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
 //------------------------------------------------------------------------
 }
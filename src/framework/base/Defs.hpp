@@ -79,6 +79,11 @@ typedef U32                 UPTR;
 #   define FW_CUDA 0
 #endif
 
+// 0 => build without OpenGL / GLEW, for headless tools (see bench/).
+#ifndef FW_USE_GL
+#   define FW_USE_GL        1
+#endif
+
 //#define FW_GL_SHADER_SOURCE(x)  #x
 
 #if FW_CUDA
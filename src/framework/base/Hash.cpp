@@ -108,3 +108,163 @@ U32 FW::hashBufferAlign(const void* ptr, int size)
 }
 
 //------------------------------------------------------------------------
+
+//------------------------------------------------------------------------
+// hashBuffer64() / Hasher.
+//------------------------------------------------------------------------
+
+namespace
+{
+
+static const U64 c_hashSecret[4] =
+{
+    0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+    0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+};
+
+inline U64 read64(const U8* p) { U64 v; memcpy(&v, p, sizeof(v)); return v; }
+inline U64 read32(const U8* p) { U32 v; memcpy(&v, p, sizeof(v)); return v; }
+
+inline void mul128(U64 a, U64 b, U64& lo, U64& hi)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    lo = (U64)r;
+    hi = (U64)(r >> 64);
+#else
+    U64 ha = a >> 32, la = (U32)a;
+    U64 hb = b >> 32, lb = (U32)b;
+    U64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    U64 t  = rl + (rm0 << 32);
+    U64 c  = (t < rl);
+    lo = t + (rm1 << 32);
+    c += (lo < t);
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline U64 hashMix64(U64 a, U64 b) { U64 lo, hi; mul128(a, b, lo, hi); return lo ^ hi; }
+
+inline void initLanes(U64* lanes, U64 seed)
+{
+    seed ^= hashMix64(seed ^ c_hashSecret[0], c_hashSecret[1]);
+    lanes[0] = seed;
+    lanes[1] = seed;
+    lanes[2] = seed;
+}
+
+inline void consumeStripe(U64* lanes, const U8* p)
+{
+    lanes[0] = hashMix64(read64(p +  0) ^ c_hashSecret[1], read64(p +  8) ^ lanes[0]);
+    lanes[1] = hashMix64(read64(p + 16) ^ c_hashSecret[2], read64(p + 24) ^ lanes[1]);
+    lanes[2] = hashMix64(read64(p + 32) ^ c_hashSecret[3], read64(p + 40) ^ lanes[2]);
+}
+
+// Folds the lanes and mixes in the trailing (< FW_HASH64_STRIPE) bytes.
+U64 finalizeLanes(const U64* lanes, const U8* p, int size, U64 totalSize)
+{
+    U64 seed = lanes[0] ^ lanes[1] ^ lanes[2];
+
+    while (size > 16)
+    {
+        seed = hashMix64(read64(p) ^ c_hashSecret[1], read64(p + 8) ^ seed);
+        p += 16;
+        size -= 16;
+    }
+
+    U64 a = 0;
+    U64 b = 0;
+    if (size >= 4)
+    {
+        int ofs = (size >> 3) << 2;
+        a = (read32(p) << 32) | read32(p + ofs);
+        b = (read32(p + size - 4) << 32) | read32(p + size - 4 - ofs);
+    }
+    else if (size > 0)
+    {
+        a = ((U64)p[0] << 16) | ((U64)p[size >> 1] << 8) | p[size - 1];
+    }
+
+    U64 lo, hi;
+    mul128(a ^ c_hashSecret[1], b ^ seed, lo, hi);
+    return hashMix64(lo ^ c_hashSecret[0] ^ totalSize, hi ^ c_hashSecret[1]);
+}
+
+} // namespace
+
+//------------------------------------------------------------------------
+
+U64 FW::hashBuffer64(const void* ptr, int size, U64 seed)
+{
+    FW_ASSERT(size >= 0);
+    FW_ASSERT(ptr || !size);
+
+    const U8*   src     = (const U8*)ptr;
+    U64         total   = (U64)size;
+    U64         lanes[3];
+
+    initLanes(lanes, seed);
+    while (size >= FW_HASH64_STRIPE)
+    {
+        consumeStripe(lanes, src);
+        src += FW_HASH64_STRIPE;
+        size -= FW_HASH64_STRIPE;
+    }
+    return finalizeLanes(lanes, src, size, total);
+}
+
+//------------------------------------------------------------------------
+
+void Hasher::reset(U64 seed)
+{
+    initLanes(m_lanes, seed);
+    m_totalSize  = 0;
+    m_stripeSize = 0;
+}
+
+//------------------------------------------------------------------------
+
+void Hasher::update(const void* ptr, int size)
+{
+    FW_ASSERT(size >= 0);
+    FW_ASSERT(ptr || !size);
+
+    const U8* src = (const U8*)ptr;
+    m_totalSize += size;
+
+    // Complete a partially filled stripe first.
+    if (m_stripeSize > 0)
+    {
+        int n = min(size, FW_HASH64_STRIPE - m_stripeSize);
+        memcpy(m_stripe + m_stripeSize, src, n);
+        m_stripeSize += n;
+        src += n;
+        size -= n;
+
+        if (m_stripeSize < FW_HASH64_STRIPE)
+            return;
+
+        consumeStripe(m_lanes, m_stripe);
+        m_stripeSize = 0;
+    }
+
+    // Full stripes straight from the source.
+    while (size >= FW_HASH64_STRIPE)
+    {
+        consumeStripe(m_lanes, src);
+        src += FW_HASH64_STRIPE;
+        size -= FW_HASH64_STRIPE;
+    }
+
+    memcpy(m_stripe, src, size);
+    m_stripeSize = size;
+}
+
+//------------------------------------------------------------------------
+
+U64 Hasher::finalize(void) const
+{
+    return finalizeLanes(m_lanes, m_stripe, m_stripeSize, m_totalSize);
+}
+
+//------------------------------------------------------------------------
@@ -59,6 +59,46 @@ inline bool                         equalsBuffer    (const void* ptrA, int sizeA
 U32                                 hashBuffer      (const void* ptr, int size);
 U32                                 hashBufferAlign (const void* ptr, int size);
 
+//------------------------------------------------------------------------
+// 64-bit streaming hash.
+//
+// Wide-multiply construction in the spirit of wyhash: 48-byte stripes are
+// consumed as three independent 64x64->128 multiply lanes, so throughput is
+// bound by the multiplier rather than by the byte loads of hashBuffer().
+// The result only depends on the bytes, not on their alignment or on how
+// they were split across Hasher::update() calls.
+//------------------------------------------------------------------------
+
+#define FW_HASH64_STRIPE    48
+
+U64                                 hashBuffer64    (const void* ptr, int size, U64 seed = 0);
+
+//------------------------------------------------------------------------
+// Incremental version of hashBuffer64(): any sequence of update() calls
+// finalizes to the same value as a single hashBuffer64() over the
+// concatenated bytes.
+
+class Hasher
+{
+  private:
+    U64     m_lanes[3];
+    U64     m_totalSize;
+    U8      m_stripe[FW_HASH64_STRIPE];
+    S32     m_stripeSize;
+
+  public:
+    explicit Hasher(U64 seed = 0) { reset(seed); }
+
+    void    reset       (U64 seed = 0);
+    void    update      (const void* ptr, int size);
+    void    update      (const std::string& str)    { update(str.c_str(), (int)str.length()); }
+    template <class T>
+    void    updateValue (const T& value)            { update(&value, (int)sizeof(T)); }
+
+    U64     finalize    (void) const;
+    U64     getTotalSize(void) const                { return m_totalSize; }
+};
+
 //------------------------------------------------------------------------
 // Base templates.
 //------------------------------------------------------------------------
@@ -143,6 +183,8 @@ template <> inline U32  hash<Mat3f>     (const Mat3f& value)                { re
 template <> inline U32  hash<Mat4f>     (const Mat4f& value)                { return hashBufferAlign(&value, sizeof(value)); }
 template <> inline U32  hash<std::string>    (const std::string& value)               { return hashBuffer(value.c_str(), value.length()); }
 
+inline U64                          hashString64    (const std::string& value, U64 seed = 0)    { return hashBuffer64(value.c_str(), (int)value.length(), seed); }
+
 //------------------------------------------------------------------------
 // Partial specializations.
 //------------------------------------------------------------------------
@@ -202,5 +244,291 @@ template <class T> U32 hashArray(const T* ptr, int size)
     return c;
 }
 
+//------------------------------------------------------------------------
+// Open-addressing hash table.
+//
+// Robin-hood probing over a single power-of-two array of slots: each slot
+// stores the cached hash next to the key/value, so a lookup compares hashes
+// first and touches a handful of adjacent slots. Removal uses backward
+// shifting, hence no tombstones.
+//
+// Pointers and slot indices are invalidated by add() and remove().
+//------------------------------------------------------------------------
+
+// Key with a precomputed hash, for repeated lookups on hot paths, e.g.
+//   static const HashKey<std::string> s_key("g_crAtomics");
+//   module->getGlobal(s_key);
+template <class K> struct HashKey
+{
+    K   key;
+    U32 hash;
+
+    HashKey(const K& k)                 : key(k), hash(FW::hash<K>(k)) {}
+    HashKey(const K& k, U32 h)          : key(k), hash(h) {}
+};
+
+template <class K, class V> class Hash
+{
+  public:
+    struct Entry
+    {
+        U32 hash;   // 0 = empty slot.
+        K   key;
+        V   value;
+
+        Entry(void) : hash(0), key(), value() {}
+    };
+
+  private:
+    enum
+    {
+        MinCapacity = 8
+    };
+
+    std::vector<Entry>  m_slots;
+    S32                 m_size;
+
+  public:
+                    Hash            (void) : m_size(0) {}
+                    Hash            (const Hash<K, V>& other) : m_slots(other.m_slots), m_size(other.m_size) {}
+
+    Hash<K, V>&     operator=       (const Hash<K, V>& other) { m_slots = other.m_slots; m_size = other.m_size; return *this; }
+
+    S32             getSize         (void) const                    { return m_size; }
+    S32             getCapacity     (void) const                    { return (S32)m_slots.size(); }
+    bool            isEmpty         (void) const                    { return (m_size == 0); }
+    void            clear           (void)                          { m_slots.clear(); m_size = 0; }
+    void            reserve         (int numItems);
+
+    bool            contains        (const K& key) const            { return (findSlot(key, hashOf(key)) != -1); }
+    bool            contains        (const HashKey<K>& key) const   { return (findSlot(key.key, fixHash(key.hash)) != -1); }
+
+    V*              search          (const K& key)                  { int s = findSlot(key, hashOf(key)); return (s == -1) ? NULL : &m_slots[s].value; }
+    V*              search          (const HashKey<K>& key)         { int s = findSlot(key.key, fixHash(key.hash)); return (s == -1) ? NULL : &m_slots[s].value; }
+    const V*        search          (const K& key) const            { int s = findSlot(key, hashOf(key)); return (s == -1) ? NULL : &m_slots[s].value; }
+    const V*        search          (const HashKey<K>& key) const   { int s = findSlot(key.key, fixHash(key.hash)); return (s == -1) ? NULL : &m_slots[s].value; }
+
+    const V&        get             (const K& key) const            { const V* v = search(key); FW_ASSERT(v); return *v; }
+    V&              get             (const K& key)                  { V* v = search(key); FW_ASSERT(v); return *v; }
+
+    // Inserts 'key', which must not be present yet.
+    V&              add             (const K& key)                  { return add(key, hashOf(key)); }
+    V&              add             (const K& key, const V& value)  { V& v = add(key, hashOf(key)); v = value; return v; }
+    V&              add             (const HashKey<K>& key)         { return add(key.key, fixHash(key.hash)); }
+
+    // std::map-like access: inserts a default-constructed value if needed.
+    V&              operator[]      (const K& key)                  { return findOrAdd(key, hashOf(key)); }
+    V&              operator[]      (const HashKey<K>& key)         { return findOrAdd(key.key, fixHash(key.hash)); }
+
+    // Same in a single probe, 'added' tells whether 'key' was inserted.
+    V&              findOrAdd       (const K& key, bool& added)     { return m_slots[findOrAddSlot(key, hashOf(key), added)].value; }
+
+    bool            remove          (const K& key)                  { return removeSlot(findSlot(key, hashOf(key))); }
+
+    // Iteration over occupied slots: for (int s = h.firstSlot(); s != -1; s = h.nextSlot(s)).
+    int             firstSlot       (void) const                    { return nextSlot(-1); }
+    int             nextSlot        (int slot) const;
+    const Entry&    getSlot         (int slot) const                { FW_ASSERT(slot >= 0 && slot < getCapacity() && m_slots[slot].hash); return m_slots[slot]; }
+    Entry&          getSlot         (int slot)                      { FW_ASSERT(slot >= 0 && slot < getCapacity() && m_slots[slot].hash); return m_slots[slot]; }
+
+  private:
+    static U32      fixHash         (U32 h)                         { return (h) ? h : 1u; }
+    static U32      hashOf          (const K& key)                  { return fixHash(FW::hash<K>(key)); }
+    U32             getMask         (void) const                    { return (U32)m_slots.size() - 1u; }
+    U32             probeDist       (int slot) const                { return ((U32)slot - m_slots[slot].hash) & getMask(); }
+
+    int             findSlot        (const K& key, U32 h) const;
+    int             findOrAddSlot   (const K& key, U32 h, bool& added);
+    V&              findOrAdd       (const K& key, U32 h)           { bool added; return m_slots[findOrAddSlot(key, h, added)].value; }
+    V&              add             (const K& key, U32 h);
+    int             insert          (Entry& entry)                  { return insert(entry, entry.hash & getMask(), 0); }
+    int             insert          (Entry& entry, U32 slot, U32 dist);
+    bool            removeSlot      (int slot);
+    void            rehash          (int capacity);
+};
+
+//------------------------------------------------------------------------
+
+template <class T> class Set
+{
+  private:
+    Hash<T, U8> m_hash;
+
+  public:
+    S32             getSize         (void) const                    { return m_hash.getSize(); }
+    bool            isEmpty         (void) const                    { return m_hash.isEmpty(); }
+    void            clear           (void)                          { m_hash.clear(); }
+    void            reserve         (int numItems)                  { m_hash.reserve(numItems); }
+
+    bool            contains        (const T& value) const          { return m_hash.contains(value); }
+    bool            contains        (const HashKey<T>& value) const { return m_hash.contains(value); }
+
+    // Returns false if the value was already present.
+    bool            add             (const T& value)                { bool added; m_hash.findOrAdd(value, added); return added; }
+    bool            remove          (const T& value)                { return m_hash.remove(value); }
+
+    int             firstSlot       (void) const                    { return m_hash.firstSlot(); }
+    int             nextSlot        (int slot) const                { return m_hash.nextSlot(slot); }
+    const T&        getSlot         (int slot) const                { return m_hash.getSlot(slot).key; }
+};
+
+//------------------------------------------------------------------------
+
+template <class K, class V> void Hash<K, V>::reserve(int numItems)
+{
+    int capacity = max((int)m_slots.size(), (int)MinCapacity);
+    while (numItems > capacity - (capacity >> 2))
+        capacity <<= 1;
+
+    if (capacity != (int)m_slots.size())
+        rehash(capacity);
+}
+
+//------------------------------------------------------------------------
+
+template <class K, class V> int Hash<K, V>::nextSlot(int slot) const
+{
+    for (++slot; slot < (int)m_slots.size(); ++slot)
+        if (m_slots[slot].hash)
+            return slot;
+    return -1;
+}
+
+//------------------------------------------------------------------------
+
+template <class K, class V> int Hash<K, V>::findSlot(const K& key, U32 h) const
+{
+    if (!m_size)
+        return -1;
+
+    U32 mask = getMask();
+    U32 dist = 0;
+    for (U32 slot = h & mask;; slot = (slot + 1) & mask, ++dist)
+    {
+        const Entry& e = m_slots[slot];
+
+        // Empty slot, or an entry closer to its home than we are: not present.
+        if (!e.hash || probeDist(slot) < dist)
+            return -1;
+
+        if (e.hash == h && equals<K>(e.key, key))
+            return (int)slot;
+    }
+}
+
+//------------------------------------------------------------------------
+
+template <class K, class V> int Hash<K, V>::findOrAddSlot(const K& key, U32 h, bool& added)
+{
+    reserve(m_size + 1);
+
+    U32 mask = getMask();
+    U32 dist = 0;
+    for (U32 slot = h & mask;; slot = (slot + 1) & mask, ++dist)
+    {
+        const Entry& e = m_slots[slot];
+
+        // Same stop condition as findSlot(): the key belongs here.
+        if (!e.hash || probeDist(slot) < dist)
+        {
+            Entry entry;
+            entry.hash = h;
+            entry.key  = key;
+            m_size++;
+            added = true;
+            return insert(entry, slot, dist);
+        }
+
+        if (e.hash == h && equals<K>(e.key, key))
+        {
+            added = false;
+            return (int)slot;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+
+template <class K, class V> V& Hash<K, V>::add(const K& key, U32 h)
+{
+    FW_ASSERT(findSlot(key, h) == -1);
+    reserve(m_size + 1);
+
+    Entry entry;
+    entry.hash = h;
+    entry.key  = key;
+    m_size++;
+    return m_slots[insert(entry)].value;
+}
+
+//------------------------------------------------------------------------
+
+// Robin-hood insertion: the entry displaces any resident that sits closer to
+// its home slot. Starts at 'slot', 'dist' slots away from home. Returns the
+// slot where 'entry' itself landed. 'entry' is clobbered.
+template <class K, class V> int Hash<K, V>::insert(Entry& entry, U32 slot, U32 dist)
+{
+    U32 mask   = getMask();
+    int result = -1;
+
+    for (;; slot = (slot + 1) & mask, ++dist)
+    {
+        Entry& e = m_slots[slot];
+
+        if (!e.hash)
+        {
+            e = entry;
+            return (result == -1) ? (int)slot : result;
+        }
+
+        U32 d = probeDist(slot);
+        if (d < dist)
+        {
+            swap(e, entry);
+            dist = d;
+            if (result == -1)
+                result = (int)slot;
+        }
+    }
+}
+
+//------------------------------------------------------------------------
+
+template <class K, class V> bool Hash<K, V>::removeSlot(int slot)
+{
+    if (slot == -1)
+        return false;
+
+    // Backward-shift the following cluster.
+    U32 mask = getMask();
+    U32 curr = (U32)slot;
+    for (;;)
+    {
+        U32 next = (curr + 1) & mask;
+        if (!m_slots[next].hash || probeDist(next) == 0)
+            break;
+        m_slots[curr] = m_slots[next];
+        curr = next;
+    }
+
+    m_slots[curr] = Entry();
+    m_size--;
+    return true;
+}
+
+//------------------------------------------------------------------------
+
+template <class K, class V> void Hash<K, V>::rehash(int capacity)
+{
+    FW_ASSERT(capacity >= m_size && (capacity & (capacity - 1)) == 0);
+
+    std::vector<Entry> old(capacity);
+    old.swap(m_slots);
+
+    for (size_t i = 0; i < old.size(); i++)
+        if (old[i].hash)
+            insert(old[i]);
+}
+
 //------------------------------------------------------------------------
 }
@@ -0,0 +1,67 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+ 
+#ifndef FRAMEWORK_BASE_TIMER_HPP_
+#define FRAMEWORK_BASE_TIMER_HPP_
+
+#include <time.h>
+#include "base/Defs.hpp"
+
+namespace FW {
+
+//------------------------------------------------------------------------
+// Monotonic wall-clock timer, in seconds.
+// Simplified version of the CudaRaster framework Timer.
+//------------------------------------------------------------------------
+
+class Timer
+{
+  private:
+    F64 m_startTime;
+    F64 m_totalTime;
+
+  public:
+    explicit Timer(bool started = false) 
+      : m_startTime((started) ? queryTime() : -1.0), 
+        m_totalTime(0.0) 
+    {}
+
+    void    start       (void)        { m_startTime = queryTime(); }
+    void    unstart     (void)        { m_startTime = -1.0; }
+    F32     getElapsed  (void)        { F64 t = queryTime(); if (m_startTime < 0.0) m_startTime = t; return (F32)(t - m_startTime); }
+
+    F32     end         (void)        { F64 t = queryTime(); if (m_startTime < 0.0) m_startTime = t; F32 elapsed = (F32)(t - m_startTime); m_startTime = t; m_totalTime += elapsed; return elapsed; }
+    F32     getTotal    (void) const  { return (F32)m_totalTime; }
+    void    clearTotal  (void)        { m_totalTime = 0.0; }
+
+    static F64 queryTime(void)
+    {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (F64)ts.tv_sec + (F64)ts.tv_nsec * 1.0e-9;
+    }
+};
+
+} // namespace FW
+
+#endif //FRAMEWORK_BASE_TIMER_HPP_
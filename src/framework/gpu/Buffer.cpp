@@ -27,7 +27,10 @@
 #include <cassert>
 #include <cstring>
 #include <vector>
+
+#if FW_USE_GL
 #include <cudaGL.h>
+#endif
 
 using namespace FW;
 
@@ -52,16 +55,7 @@ void Buffer::wrapGL(GLuint glBuffer)
 {
   FW_ASSERT(glBuffer != 0);
 
-  GLint size;
-  {
-    GLint oldBuffer;
-    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, glBuffer);
-
-    glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-    glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
-    GLContext::checkErrors();
-  }
+  S64 size = GLContext::getBufferSize(glBuffer);
 
   m_glBuffer = glBuffer;
   wrap(GL, size);
@@ -133,14 +127,7 @@ void Buffer::setRange(S64 dstOfs, const void* src, S64 size, bool async, CUstrea
   switch (m_owner)
   {
     case GL:
-    {
-      GLint oldBuffer;
-      glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
-      glBindBuffer(GL_ARRAY_BUFFER, getMutableGLBuffer());
-      glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)dstOfs, (GLsizeiptr)size, src);
-      glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
-      GLContext::checkErrors();
-    }
+      GLContext::setBufferData(getMutableGLBuffer(), dstOfs, size, src);
     break;
 
     case Cuda:
@@ -210,14 +197,7 @@ void Buffer::getRange(void* dst, S64 srcOfs, S64 size, bool async, CUstream cuda
   switch (m_owner)
   {
     case GL:
-    {
-      GLint oldBuffer;
-      glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
-      glBindBuffer(GL_ARRAY_BUFFER, m_glBuffer);
-      glGetBufferSubData(GL_ARRAY_BUFFER, (GLintptr)srcOfs, (GLsizeiptr)size, dst);
-      glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
-      GLContext::checkErrors();
-    }
+      GLContext::getBufferData(m_glBuffer, srcOfs, size, dst);
     break;
 
     case Cuda:
@@ -300,12 +280,7 @@ void Buffer::setOwner(Module module, bool modify, bool async, CUstream cudaStrea
       if (validSize)
       {
         //profilePush("glBufferSubData");
-        GLint oldBuffer;
-        glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
-        glBindBuffer(GL_ARRAY_BUFFER, m_glBuffer);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)validSize, m_cpuPtr);
-        glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
-        GLContext::checkErrors();
+        GLContext::setBufferData(m_glBuffer, 0, validSize, m_cpuPtr);
         //profilePop();
       }
       m_dirty &= ~GL;
@@ -413,7 +388,7 @@ U32 Buffer::validateHints(U32 hints, int align, Module original)
     res |= Hint_PageLock;
   }
 
-  if ((hints & Hint_CudaGL) != 0 && original != Cuda && align == 1) { // && isAvailable_cuGLRegisterBufferObject())
+  if ((hints & Hint_CudaGL) != 0 && original != Cuda && align == 1 && FW_USE_GL) { // && isAvailable_cuGLRegisterBufferObject())
     res |= Hint_CudaGL;
   }
   return res;
@@ -430,8 +405,10 @@ void Buffer::deinit(void)
   if (m_original != GL) {
     glFree(m_glBuffer, m_cudaGLReg);
   } else if (m_cudaGLReg) {
+#if FW_USE_GL
     CudaModule::checkError("cuGLUnregisterBufferObject", 
                            cuGLUnregisterBufferObject(m_glBuffer));
+#endif
     assert( "cuGLUnregisterBufferObject" && 0 );
   }
 
@@ -566,12 +543,7 @@ void Buffer::validateCPU(bool async, CUstream cudaStream, S64 validSize)
   if (source == GL)
   {
     //profilePush("glGetBufferSubData");
-    GLint oldBuffer;
-    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_glBuffer);
-    glGetBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)validSize, m_cpuPtr);
-    glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
-    GLContext::checkErrors();
+    GLContext::getBufferData(m_glBuffer, 0, validSize, m_cpuPtr);
     //profilePop();
   }
   else
@@ -626,14 +598,8 @@ void Buffer::glAlloc(GLuint& glBuffer, S64 size, const void* data)
   FW_ASSERT(size >= 0);
   GLContext::staticInit();
 
-  GLint oldBuffer;
-  glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
-  glGenBuffers(1, &glBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, glBuffer);
-  checkSize(size, sizeof(GLsizeiptr) * 8 - 1, "glBufferData");
-  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size, data, GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
-  GLContext::checkErrors();
+  checkSize(size, sizeof(SPTR) * 8 - 1, "glBufferData");
+  glBuffer = GLContext::createBuffer(size, data);
 }
 
 //------------------------------------------------------------------------
@@ -645,11 +611,12 @@ void Buffer::glFree(GLuint& glBuffer, bool& cudaGLReg)
     if (cudaGLReg)
     {
       assert( "cuGLUnregisterBufferObject" && 0 );
+#if FW_USE_GL
       CudaModule::checkError("cuGLUnregisterBufferObject", cuGLUnregisterBufferObject(glBuffer));
+#endif
       cudaGLReg = false;
     }
-    glDeleteBuffers(1, &glBuffer);
-    GLContext::checkErrors();
+    GLContext::deleteBuffer(glBuffer);
     glBuffer = 0;
   }
 }
@@ -670,6 +637,7 @@ void Buffer::cudaAlloc(CUdeviceptr& cudaPtr, CUdeviceptr& cudaBase, bool& cudaGL
     }
     else
     {
+#if FW_USE_GL
       if (!cudaGLReg)
       {
         assert( "cuGLRegisterBufferObject" && 0 );
@@ -681,6 +649,11 @@ void Buffer::cudaAlloc(CUdeviceptr& cudaPtr, CUdeviceptr& cudaBase, bool& cudaGL
       assert( "cuGLMapBufferObject" && 0 );
       CudaModule::checkError("cuGLMapBufferObject", cuGLMapBufferObject(&cudaBase, &size, glBuffer));
       cudaPtr = cudaBase;
+#else
+      FW_UNREF(glBuffer);
+      FW_UNREF(cudaGLReg);
+      fail("Buffer: Hint_CudaGL requires FW_USE_GL!");
+#endif
     }
 }
 
@@ -699,7 +672,11 @@ void Buffer::cudaFree(CUdeviceptr& cudaPtr, CUdeviceptr& cudaBase,
     else 
     {
       assert( "cuGLUnmapBufferObject" && 0 );
+#if FW_USE_GL
       CudaModule::checkError("cuGLUnmapBufferObject", cuGLUnmapBufferObject(glBuffer));
+#else
+      FW_UNREF(glBuffer);
+#endif
     }
     cudaPtr = NULL;
     cudaBase = NULL;
@@ -27,11 +27,11 @@
 
 #include <string>
 
-#include <GL/glew.h>
 #include <cuda.h>
 
 #include "base/Defs.hpp"
 #include "gpu/CudaModule.hpp"
+#include "gpu/GLContext.hpp"
 #include "io/Stream.hpp"
 
 namespace FW {
@@ -86,10 +86,10 @@ CudaModule* CudaCompiler::compile(bool enablePrints)
 
   // Cached in memory => done.
   U64 memHash = getMemHash();
-  CudaModule* pModule = s_moduleCache[memHash];
+  CudaModule** pModule = s_moduleCache.search(memHash);
   
   if (pModule) {
-    return pModule;
+    return *pModule;
   }
 
   /// Compile CUBIN file.
@@ -104,7 +104,7 @@ CudaModule* CudaCompiler::compile(bool enablePrints)
 
   // Create module and add to memory cache.
   CudaModule* module = new CudaModule(cubinFile);
-  s_moduleCache[memHash] = module;
+  s_moduleCache.add(memHash, module);
   return module;
 }
 
@@ -116,9 +116,9 @@ const std::vector<U8>* CudaCompiler::compileCubin(bool enablePrints)
 
   // Cached in memory => done.
   U64 memHash = getMemHash();
-  std::vector<U8>* pCubin = s_cubinCache[memHash];
+  std::vector<U8>** pCubin = s_cubinCache.search(memHash);
   if (pCubin) {
-    return pCubin;
+    return *pCubin;
   }
   
   // Compile CUBIN file.
@@ -137,7 +137,7 @@ const std::vector<U8>* CudaCompiler::compileCubin(bool enablePrints)
   (*cubin)[size] = '\0';
   
   // Add to memory cache.
-  s_cubinCache[memHash] = cubin;
+  s_cubinCache.add(memHash, cubin);
   
   return cubin;
 }
@@ -320,13 +320,13 @@ void CudaCompiler::staticDeinit(void)
 
 void CudaCompiler::flushMemCache(void)
 {
-  for (CubinCacheMap_t::iterator it=s_cubinCache.begin(); it!=s_cubinCache.end(); ++it) {
-    delete it->second;
+  for (int s=s_cubinCache.firstSlot(); s!=-1; s=s_cubinCache.nextSlot(s)) {
+    delete s_cubinCache.getSlot(s).value;
   }
   s_cubinCache.clear();
 
-  for (ModuleCacheMap_t::iterator it=s_moduleCache.begin(); it!=s_moduleCache.end(); ++it) {
-    delete it->second;
+  for (int s=s_moduleCache.firstSlot(); s!=-1; s=s_moduleCache.nextSlot(s)) {
+    delete s_moduleCache.getSlot(s).value;
   }
   s_moduleCache.clear();
 }
@@ -422,46 +422,42 @@ U64 CudaCompiler::getMemHash(void)
 
   if (!m_sourceFileHashValid)
   {
-    m_sourceFileHash = hash<std::string>(m_sourceFile);
+    m_sourceFileHash = hashString64(m_sourceFile);
     m_sourceFileHashValid = true;
   }
 
   if (!m_optionHashValid)
   {
-    m_optionHash = hash<std::string>(m_options);
+    m_optionHash = hashString64(m_options);
     m_optionHashValid = true;
   }
 
   if (!m_defineHashValid)
   {
-    U32 a = FW_HASH_MAGIC, b = FW_HASH_MAGIC, c = FW_HASH_MAGIC;
+    Hasher h;
     DefinesMap_t::iterator it;
     for (it = m_defines.begin(); it != m_defines.end(); ++it)
     {
-        a += hash<std::string>(it->first);
-        b += hash<std::string>(it->second);
-        FW_JENKINS_MIX(a, b, c);
+        h.updateValue(hashString64(it->first));
+        h.updateValue(hashString64(it->second));
     }
-    m_defineHash = ((U64)b << 32) | c;
+    m_defineHash = h.finalize();
     m_defineHashValid = true;
   }
 
   if (!m_preambleHashValid)
   {
-    m_preambleHash = hash<std::string>(m_preamble);
+    m_preambleHash = hashString64(m_preamble);
     m_preambleHashValid = true;
   }
 
-  U32 a = FW_HASH_MAGIC + m_sourceFileHash;
-  U32 b = FW_HASH_MAGIC + m_optionHash;
-  U32 c = FW_HASH_MAGIC + m_preambleHash;
+  Hasher h;
+  h.updateValue(m_sourceFileHash);
+  h.updateValue(m_optionHash);
+  h.updateValue(m_preambleHash);
+  h.updateValue(m_defineHash);
   
-  FW_JENKINS_MIX(a, b, c);
-  a += (U32)(m_defineHash >> 32);
-  b += (U32)m_defineHash;
-  FW_JENKINS_MIX(a, b, c);
-  
-  m_memHash = ((U64)b << 32) | c;
+  m_memHash = h.finalize();
   m_memHashValid = true;
   
   return m_memHash;
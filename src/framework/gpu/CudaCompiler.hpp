@@ -32,6 +32,7 @@
 #include <vector>
 
 #include "base/Defs.hpp"
+#include "base/Hash.hpp"
 
 
 namespace FW {
@@ -42,9 +43,9 @@ class CudaCompiler
 {
   private:
     typedef std::vector<U8> uint8Array_t;
-    typedef std::map<U64, uint8Array_t*> CubinCacheMap_t;
+    typedef Hash<U64, uint8Array_t*> CubinCacheMap_t;
         
-    typedef std::map<U64, CudaModule*> ModuleCacheMap_t;
+    typedef Hash<U64, CudaModule*> ModuleCacheMap_t;
     
     typedef std::map<std::string, std::string> DefinesMap_t;
     
@@ -71,10 +72,10 @@ class CudaCompiler
     DefinesMap_t m_defines;
     std::string m_preamble;
 
-    U32 m_sourceFileHash;
-    U32 m_optionHash;
+    U64 m_sourceFileHash;
+    U64 m_optionHash;
     U64 m_defineHash;
-    U32 m_preambleHash;
+    U64 m_preambleHash;
     U64 m_memHash;
     bool m_sourceFileHashValid;
     bool m_optionHashValid;
@@ -23,9 +23,12 @@
  
 #include "CudaModule.hpp"
 
-#include <GL/glew.h>
 #include <cuda.h>
+
+#if FW_USE_GL
+#include <GL/glew.h>
 #include <cudaGL.h>
+#endif
 
 #include "gpu/Buffer.hpp"
 #include "gpu/CudaCompiler.hpp"
@@ -41,6 +44,7 @@ CUcontext   CudaModule::s_context       = NULL;
 CUevent     CudaModule::s_startEvent    = NULL;
 CUevent     CudaModule::s_endEvent      = NULL;
 bool        CudaModule::s_preferL1      = true;
+bool        CudaModule::s_glInterop     = (FW_USE_GL != 0);
 
 
 //------------------------------------------------------------------------
@@ -65,41 +69,40 @@ CudaModule::~CudaModule(void)
 
 //------------------------------------------------------------------------
 
-Buffer& CudaModule::getGlobal(const std::string& name)
+Buffer& CudaModule::getGlobal(const HashKey<std::string>& key)
 {
-  Buffer* found = m_globalHash[name];
+  Buffer** found = m_globalHash.search(key);
   
   if (found) {
-    return *found;
+    return **found;
   }
 
   CUdeviceptr ptr;
   size_t size;
   
   checkError( "cuModuleGetGlobal", 
-              cuModuleGetGlobal(&ptr, &size, m_module, name.c_str()));
+              cuModuleGetGlobal(&ptr, &size, m_module, key.key.c_str()));
 
   Buffer* buffer = new Buffer;  
   buffer->wrapCuda(ptr, size);
 
-  m_globalHash[name] = buffer;
+  m_globalHash.add(key) = buffer;
   return *buffer;
 }
 
 void CudaModule::updateGlobals(bool async, CUstream stream)
 { 
-  GlobalMap_t::iterator it;
-  for (it=m_globalHash.begin(); it != m_globalHash.end(); ++it) {
-    it->second->setOwner( Buffer::Cuda, true, async, stream);
+  for (int s=m_globalHash.firstSlot(); s != -1; s=m_globalHash.nextSlot(s)) {
+    m_globalHash.getSlot(s).value->setOwner( Buffer::Cuda, true, async, stream);
   }
 }
 
 void CudaModule::destroysGlobals()
 {
-  GlobalMap_t::iterator it;
-  for (it=m_globalHash.begin(); it!=m_globalHash.end(); ++it) {
-    delete it->second;
+  for (int s=m_globalHash.firstSlot(); s != -1; s=m_globalHash.nextSlot(s)) {
+    delete m_globalHash.getSlot(s).value;
   }
+  m_globalHash.clear();
 }
 
 
@@ -147,12 +150,12 @@ int CudaModule::setParamPtr(CUfunction kernel, int offset, CUdeviceptr value)
 
 //------------------------------------------------------------------------
 
-CUtexref CudaModule::getTexRef(const std::string& name)
+CUtexref CudaModule::getTexRef(const HashKey<std::string>& key)
 {
-  CUtexref &texref = m_texrefHash[name];
+  CUtexref &texref = m_texrefHash[key];
 
   if (0 == texref) {
-    checkError("cuModuleGetTexRef", cuModuleGetTexRef( &texref, m_module, name.c_str()));  
+    checkError("cuModuleGetTexRef", cuModuleGetTexRef( &texref, m_module, key.key.c_str()));  
   } 
 
   return texref;
@@ -224,11 +227,10 @@ void CudaModule::updateTexRefs(CUfunction kernel)
     return;
   }
 
-  TexrefMap_t::iterator it;
-  for (it=m_texrefHash.begin(); it!=m_texrefHash.end(); ++it)
+  for (int s=m_texrefHash.firstSlot(); s!=-1; s=m_texrefHash.nextSlot(s))
   {
     checkError("cuParamSetTexRef", 
-               cuParamSetTexRef( kernel, CU_PARAM_TR_DEFAULT, it->second));
+               cuParamSetTexRef( kernel, CU_PARAM_TR_DEFAULT, m_texrefHash.getSlot(s).value));
   }
 }
 
@@ -357,8 +359,17 @@ void CudaModule::staticInit(void)
   }
 #endif
 
-  // OpenGL & window context must have been initialized !
-  checkError("cuGLCtxCreate", cuGLCtxCreate( &s_context, flags, s_device));
+#if FW_USE_GL
+  if (s_glInterop) 
+  {
+    // OpenGL & window context must have been initialized !
+    checkError("cuGLCtxCreate", cuGLCtxCreate( &s_context, flags, s_device));
+  }
+  else
+#endif
+  {
+    checkError("cuCtxCreate", cuCtxCreate( &s_context, flags, s_device));
+  }
 
   checkError("cuEventCreate", cuEventCreate(&s_startEvent, 0));
   checkError("cuEventCreate", cuEventCreate(&s_endEvent, 0));
@@ -25,13 +25,13 @@
 #ifndef FRAMEWORK_GPU_CUDAMODULE_HPP_
 #define FRAMEWORK_GPU_CUDAMODULE_HPP_
 
-#include <map>
 #include <string>
 #include <vector>
 
 #include <cuda.h>
 #include "base/Defs.hpp"
 #include "base/Math.hpp"
+#include "base/Hash.hpp"
 
 
 namespace FW {
@@ -41,9 +41,9 @@ class Buffer;
 class CudaModule
 {
   private:
-    typedef std::map<std::string, Buffer*> GlobalMap_t;
+    typedef Hash<std::string, Buffer*> GlobalMap_t;
     
-    typedef std::map<std::string, CUtexref> TexrefMap_t;    
+    typedef Hash<std::string, CUtexref> TexrefMap_t;    
     
     
   private:
@@ -54,6 +54,7 @@ class CudaModule
     static CUevent   s_startEvent;
     static CUevent   s_endEvent;
     static bool      s_preferL1;
+    static bool      s_glInterop;
 
     CUmodule m_module;
     
@@ -71,7 +72,10 @@ class CudaModule
     inline CUmodule getHandle(void) { return m_module; }
 
     //++++++++++++
-    Buffer& getGlobal(const std::string& name);
+    Buffer& getGlobal(const std::string& name) { return getGlobal(HashKey<std::string>(name)); }
+    
+    // Precomputed-key variant, for globals accessed on every draw.
+    Buffer& getGlobal(const HashKey<std::string>& key);
     
     // copy to the device if modified
     void updateGlobals(bool async = false, CUstream stream = NULL);
@@ -86,7 +90,8 @@ class CudaModule
 
 
     //++++++++++++
-    CUtexref getTexRef(const std::string& name);
+    CUtexref getTexRef(const std::string& name) { return getTexRef(HashKey<std::string>(name)); }
+    CUtexref getTexRef(const HashKey<std::string>& key);
     
     void setTexRef(const std::string& name, Buffer& buf, CUarray_format format, 
                    int numComponents);
@@ -165,6 +170,13 @@ class CudaModule
       return old; 
     }
 
+    // Create the context with OpenGL interoperability (default, requires a 
+    // current GL context) or as a plain CUDA context for headless tools.
+    // Must be called before staticInit(). Always off when FW_USE_GL is 0.
+    static void setGLInterop(bool enable) { FW_ASSERT(!s_inited); s_glInterop = enable && FW_USE_GL; }
+    
+    static bool isGLInterop(void) { return s_glInterop; }
+
 
   private:
     static CUdevice selectDevice(void);
@@ -27,20 +27,28 @@
 #pragma once
 
 #include <cassert>
-#include <GL/glew.h>
 
 #include "base/Defs.hpp"
 
+#if FW_USE_GL
+#include <GL/glew.h>
+#else
+typedef unsigned int GLuint;
+#endif
+
 
 namespace FW {
 
+//------------------------------------------------------------------------
+// Thin OpenGL layer. Buffer objects go through here so that the framework
+// builds without GL when FW_USE_GL is 0; the calls then fail at runtime.
+//------------------------------------------------------------------------
 
 class GLContext
 {
   public:
     static void staticInit(void)
     {
-      fprintf( stderr, "%s %s : [TODO] remove", __FILE__, __FUNCTION__ );
       /*
       static bool bInit=false;
       
@@ -54,6 +62,7 @@ class GLContext
 
     static void checkErrors(void)
     {
+#if FW_USE_GL
       GLenum err = glGetError();
       const char* name;
       
@@ -73,6 +82,92 @@ class GLContext
       if (name) {
         fail("Caught GL error 0x%04x (%s)!", err, name);
       }
+#endif
+    }
+
+    // Buffer objects (GL_ARRAY_BUFFER), the previous binding is preserved.
+    static GLuint createBuffer(S64 size, const void* data)
+    {
+#if FW_USE_GL
+      GLuint buffer;
+      GLint oldBuffer;
+      glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
+      glGenBuffers(1, &buffer);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)size, data, GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
+      checkErrors();
+      return buffer;
+#else
+      FW_UNREF(size); FW_UNREF(data);
+      failNoGL();
+      return 0;
+#endif
+    }
+
+    static void deleteBuffer(GLuint buffer)
+    {
+#if FW_USE_GL
+      glDeleteBuffers(1, &buffer);
+      checkErrors();
+#else
+      FW_UNREF(buffer);
+      failNoGL();
+#endif
+    }
+
+    static S64 getBufferSize(GLuint buffer)
+    {
+#if FW_USE_GL
+      GLint size;
+      GLint oldBuffer;
+      glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+      glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
+      checkErrors();
+      return size;
+#else
+      FW_UNREF(buffer);
+      failNoGL();
+      return 0;
+#endif
+    }
+
+    static void setBufferData(GLuint buffer, S64 ofs, S64 size, const void* src)
+    {
+#if FW_USE_GL
+      GLint oldBuffer;
+      glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)ofs, (GLsizeiptr)size, src);
+      glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
+      checkErrors();
+#else
+      FW_UNREF(buffer); FW_UNREF(ofs); FW_UNREF(size); FW_UNREF(src);
+      failNoGL();
+#endif
+    }
+
+    static void getBufferData(GLuint buffer, S64 ofs, S64 size, void* dst)
+    {
+#if FW_USE_GL
+      GLint oldBuffer;
+      glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &oldBuffer);
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glGetBufferSubData(GL_ARRAY_BUFFER, (GLintptr)ofs, (GLsizeiptr)size, dst);
+      glBindBuffer(GL_ARRAY_BUFFER, oldBuffer);
+      checkErrors();
+#else
+      FW_UNREF(buffer); FW_UNREF(ofs); FW_UNREF(size); FW_UNREF(dst);
+      failNoGL();
+#endif
+    }
+
+  private:
+    static void failNoGL(void)
+    {
+      fail("GLContext: Built without OpenGL support (FW_USE_GL=0)!");
     }
 };
 
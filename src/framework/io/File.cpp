@@ -0,0 +1,257 @@
+/*
+ * Modified version, originally from Samuli Laine's and Tero Karras' CudaRaster.
+ * (http://code.google.com/p/cudaraster/)
+ * 
+ * 04-2012 - Thibault Coppex
+ * 
+ * ---------------------------------------------------------------------------
+ * 
+ *  Copyright 2009-2010 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef _GNU_SOURCE
+#   define _GNU_SOURCE // O_DIRECT
+#endif
+
+#include "io/File.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace FW {
+
+//------------------------------------------------------------------------
+
+File::File(const std::string& name, Mode mode, U32 flags)
+    : m_name(name),
+      m_mode(mode),
+      m_flags(flags),
+      m_fd(-1),
+      m_directFd(-1),
+      m_size(0),
+      m_offset(0)
+{
+  int oflags = (mode == Read)   ? O_RDONLY :
+               (mode == Create) ? O_RDWR | O_CREAT | O_TRUNC : 
+                                  O_RDWR | O_CREAT;
+
+  m_fd = open( m_name.c_str(), oflags, 0644);
+  if (m_fd == -1) {
+    fail("File: cannot open '%s' (%s)!", m_name.c_str(), strerror(errno));
+  }
+
+#ifdef O_DIRECT
+  if (flags & Flag_Direct)
+  {
+    // Not supported by every filesystem (e.g. tmpfs) => stay cached.
+    m_directFd = open( m_name.c_str(), (oflags & ~(O_CREAT | O_TRUNC)) | O_DIRECT);
+  }
+#endif
+
+  struct stat st;
+  if (fstat( m_fd, &st) == 0) {
+    m_size = (S64)st.st_size;
+  }
+
+  if (flags & Flag_Sequential) {
+    posix_fadvise( m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+}
+
+//------------------------------------------------------------------------
+
+File::~File(void) 
+{ 
+  if (m_directFd != -1) {
+    close(m_directFd);
+  }
+  if (m_fd != -1) {
+    close(m_fd);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void File::seek(S64 ofs)
+{
+  FW_ASSERT(ofs >= 0);
+  m_offset = ofs;
+}
+
+//------------------------------------------------------------------------
+
+S64 File::readAt(S64 ofs, void* ptr, S64 size)
+{
+  FW_ASSERT(ofs >= 0 && size >= 0);
+  FW_ASSERT(ptr || !size);
+
+  int fd = selectHandle(ofs, ptr, size);
+  S64 done = 0;
+
+  while (done < size)
+  {
+    ssize_t num = pread( fd, (U8*)ptr + done, (size_t)(size - done), (off_t)(ofs + done));
+    
+    if (num < 0 && errno == EINTR) {
+      continue;
+    }
+    if (num < 0 && fd == m_directFd) 
+    {
+      // O_DIRECT refused this request => retry through the page cache.
+      fd = m_fd;
+      continue;
+    }
+    if (num <= 0) {
+      break;
+    }
+    done += num;
+  }
+
+  return done;
+}
+
+//------------------------------------------------------------------------
+
+void File::writeAt(S64 ofs, const void* ptr, S64 size)
+{
+  FW_ASSERT(ofs >= 0 && size >= 0);
+  FW_ASSERT(ptr || !size);
+
+  if (!checkWritable()) {
+    fail("File: '%s' is read-only!", m_name.c_str());
+  }
+
+  int fd = selectHandle(ofs, ptr, size);
+  S64 done = 0;
+
+  while (done < size)
+  {
+    ssize_t num = pwrite( fd, (const U8*)ptr + done, (size_t)(size - done), (off_t)(ofs + done));
+    
+    if (num < 0 && errno == EINTR) {
+      continue;
+    }
+    if (num < 0 && fd == m_directFd) 
+    {
+      fd = m_fd;
+      continue;
+    }
+    if (num <= 0) {
+      fail("File: write to '%s' failed (%s)!", m_name.c_str(), strerror(errno));
+    }
+    done += num;
+  }
+
+  m_size = max(m_size, ofs + size);
+}
+
+//------------------------------------------------------------------------
+
+int File::read(void* ptr, int size)
+{
+  S64 num = readAt(m_offset, ptr, size);
+  m_offset += num;
+  return (int)num;
+}
+
+//------------------------------------------------------------------------
+
+void File::write(const void* ptr, int size) 
+{
+  writeAt(m_offset, ptr, size);
+  m_offset += size;
+}
+
+//------------------------------------------------------------------------
+
+void File::prefetch(S64 ofs, S64 size)
+{
+  posix_fadvise( m_fd, (off_t)ofs, (off_t)size, POSIX_FADV_WILLNEED);
+}
+
+//------------------------------------------------------------------------
+
+int File::selectHandle(S64 ofs, const void* ptr, S64 size) const
+{
+  const S64 mask = getDirectAlignment() - 1;
+
+  if (m_directFd != -1 && ((ofs | size | (S64)(UPTR)ptr) & mask) == 0) {
+    return m_directFd;
+  }
+  return m_fd;
+}
+
+//------------------------------------------------------------------------
+
+MappedInputStream::MappedInputStream(const std::string& name, bool populate)
+    : m_name(name),
+      m_ptr(NULL),
+      m_size(0)
+{
+  int fd = open( m_name.c_str(), O_RDONLY);
+  if (fd == -1) {
+    fail("MappedInputStream: cannot open '%s' (%s)!", m_name.c_str(), strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat( fd, &st) != 0) {
+    fail("MappedInputStream: cannot stat '%s' (%s)!", m_name.c_str(), strerror(errno));
+  }
+  m_size = (S64)st.st_size;
+
+  // MemoryInputStream offsets are 32-bit.
+  if (m_size > INT_MAX) {
+    fail("MappedInputStream: '%s' exceeds 2GB!", m_name.c_str());
+  }
+
+  if (m_size > 0)
+  {
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (populate) {
+      flags |= MAP_POPULATE;
+    }
+#endif
+    m_ptr = mmap( NULL, (size_t)m_size, PROT_READ, flags, fd, 0);
+    if (m_ptr == MAP_FAILED) {
+      fail("MappedInputStream: cannot map '%s' (%s)!", m_name.c_str(), strerror(errno));
+    }
+    madvise( m_ptr, (size_t)m_size, MADV_SEQUENTIAL);
+  }
+
+  // The mapping keeps its own reference to the file.
+  close(fd);
+
+  reset( m_ptr, (int)m_size);
+}
+
+//------------------------------------------------------------------------
+
+MappedInputStream::~MappedInputStream(void)
+{
+  if (m_ptr) {
+    munmap( m_ptr, (size_t)m_size);
+  }
+}
+
+//------------------------------------------------------------------------
+
+} // namespace FW
@@ -24,13 +24,24 @@
 #ifndef FRAMEWORK_IO_FILE_HPP
 #define FRAMEWORK_IO_FILE_HPP
 
-#include <cstdio>
+#include <string>
 #include <io/Stream.hpp>
 
 namespace FW {
 
-// Wrapper to read and write file.
-// This class is a simple rewrite of the CudaRaster File class.
+//------------------------------------------------------------------------
+// File stream on a raw POSIX file descriptor.
+//
+// Reads and writes go through pread/pwrite at the current offset, so no
+// stdio buffering is involved: wrap the file in a BufferedInputStream /
+// BufferedOutputStream for small accesses, and use large transfers (bulk
+// vector serialization, Buffer chunks) for dumps.
+//
+// Flag_Direct opens an additional O_DIRECT descriptor that is used for
+// every transfer whose pointer, offset and size are multiples of
+// getDirectAlignment(); other transfers fall back to the cached one.
+//------------------------------------------------------------------------
+
 class File : public InputStream, public OutputStream
 {
   public:
@@ -40,73 +51,92 @@ class File : public InputStream, public OutputStream
       Create, // created or truncated - can be read or written
       Modify  // opened or created - can be read or written
     };
+
+    enum Flags
+    {
+      Flag_Sequential = 1 << 0, // posix_fadvise(SEQUENTIAL) hint
+      Flag_Direct     = 1 << 1, // bypass the page cache for aligned transfers
+
+      Flag_Default    = Flag_Sequential
+    };
     
   private:
     std::string m_name;
     Mode m_mode;
+    U32 m_flags;
     
-    FILE* m_fd;
+    int m_fd;
+    int m_directFd;
 
     S64 m_size;
     S64 m_offset;
 
   public:
-    File(const std::string& name, Mode mode)
-        : m_name(name),
-          m_mode(mode),
-          m_fd(NULL),
-          m_size(0),
-          m_offset(0)
-    {    
-      m_fd = fopen( m_name.c_str(), (mode==Read)?"r":(mode==Create)?"w":"w+");
-      assert( NULL != m_fd );
-      
-      fseek( m_fd, 0, SEEK_END);
-      m_size = ftell(m_fd);
-      fseek( m_fd, 0, SEEK_SET);
-    }
-    
-    virtual ~File(void) 
-    { 
-      if (m_fd) {
-        fclose(m_fd); 
-        m_fd = NULL; 
-      }
-    }
+    File(const std::string& name, Mode mode, U32 flags = Flag_Default);
+    virtual ~File(void);
 
     const std::string& getName(void) const { return m_name; }
     Mode getMode(void) const { return m_mode; }
+    U32 getFlags(void) const { return m_flags; }
     bool checkWritable(void) const { return m_mode != Read; }
+    int getHandle(void) const { return m_fd; }
+    bool isDirect(void) const { return m_directFd != -1; }
 
     S64 getSize(void) const { return m_size; }
     
     S64 getOffset(void) const { return m_offset; }
     
-    void seek(S64 ofs)
-    {
-      if (fseek( m_fd, ofs, SEEK_SET) == 0) {
-        m_offset = ofs;
-      }
-    }
+    void seek(S64 ofs);
 
-    virtual int read(void* ptr, int size)
-    {
-      m_offset += fread( ptr, 1, size, m_fd);
-    }
-    
-    virtual void write(const void* ptr, int size) 
-    {
-      m_offset += fwrite( ptr, 1, size, m_fd);
-      m_size = max( m_size, m_offset);
-    }
-    
+    // Positional access, does not move the current offset.
+    S64 readAt(S64 ofs, void* ptr, S64 size);
+    void writeAt(S64 ofs, const void* ptr, S64 size);
+
+    virtual int read(void* ptr, int size);
+    virtual void write(const void* ptr, int size);
+
+    // Data is handed to the kernel on every write => nothing to do.
     virtual void flush(void) {}
+
+    // Ask the kernel to start reading [ofs, ofs+size) in the background.
+    void prefetch(S64 ofs, S64 size);
+
+    static int getDirectAlignment(void) { return 4096; }
     
+  private:
+    int selectHandle(S64 ofs, const void* ptr, S64 size) const;
+
   private:
     File(const File&);              // forbidden
     File& operator= (const File&);  // forbidden
 };
 
+//------------------------------------------------------------------------
+// Read-only memory mapping of a whole file, exposed as a 
+// MemoryInputStream: streaming from it is a memcpy out of the page cache
+// and getPtr() gives zero-copy access to the contents.
+//------------------------------------------------------------------------
+
+class MappedInputStream : public MemoryInputStream
+{
+  private:
+    std::string m_name;
+    void*       m_ptr;
+    S64         m_size;
+
+  public:
+    explicit MappedInputStream(const std::string& name, bool populate = false);
+    virtual ~MappedInputStream(void);
+
+    const std::string& getName(void) const { return m_name; }
+    const void* getPtr(void) const { return m_ptr; }
+    S64 getSize(void) const { return m_size; }
+
+  private:
+    MappedInputStream(const MappedInputStream&);              // forbidden
+    MappedInputStream& operator= (const MappedInputStream&);  // forbidden
+};
+
 } // namespace FW
 
 #endif // FRAMEWORK_IO_FILE_HPP
@@ -70,6 +70,18 @@ int BufferedInputStream::read(void* ptr, int size)
     int ofs = 0;
     while (ofs < size)
     {
+      // Large request on a drained buffer => bypass it.
+      if (getBufferSize() == 0 && size - ofs >= (int)m_buffer.size())
+      {
+        int num = m_stream.read((U8*)ptr + ofs, size - ofs);
+        if (num <= 0) {
+          break;
+        }
+        ofs += num;
+        continue;
+      }
+
+
       fillBuffer(1);
       int num = min(size - ofs, getBufferSize());
       if (!num) {
@@ -230,6 +242,15 @@ void BufferedOutputStream::write(const void* ptr, int size)
     return;
   }
 
+  // Large write without line processing => bypass the buffer.
+  if (!m_writeOnLF && !m_emulateCR && size >= (int)m_buffer.size())
+  {
+    flushInternal();
+    m_stream.write(ptr, size);
+    m_numFlushed += size;
+    return;
+  }
+
   int ofs = 0;
 
   while (1)
@@ -393,11 +414,12 @@ MemoryOutputStream::~MemoryOutputStream(void)
 
 void MemoryOutputStream::write(const void* ptr, int size)
 {
-  const U8 *data = (const U8*)ptr;
-  
-  for (size_t i=0u; i<size; ++i) {
-    m_data.push_back(data[i]);
+  if (size <= 0) {
+    return;
   }
+  
+  const U8 *data = (const U8*)ptr;
+  m_data.insert(m_data.end(), data, data + size);
 }
 
 //------------------------------------------------------------------------
@@ -408,4 +430,30 @@ void MemoryOutputStream::flush(void)
 
 //------------------------------------------------------------------------
 
+void readArray(InputStream& s, void* ptr, S64 size)
+{
+  FW_ASSERT(size >= 0);
+  FW_ASSERT(ptr || !size);
+
+  const S64 maxChunk = (S64)1 << 30;
+  for (S64 ofs = 0; ofs < size; ofs += maxChunk) {
+    s.readFully((U8*)ptr + ofs, (int)min(size - ofs, maxChunk));
+  }
+}
+
+//------------------------------------------------------------------------
+
+void writeArray(OutputStream& s, const void* ptr, S64 size)
+{
+  FW_ASSERT(size >= 0);
+  FW_ASSERT(ptr || !size);
+
+  const S64 maxChunk = (S64)1 << 30;
+  for (S64 ofs = 0; ofs < size; ofs += maxChunk) {
+    s.write((const U8*)ptr + ofs, (int)min(size - ofs, maxChunk));
+  }
+}
+
+//------------------------------------------------------------------------
+
 }
@@ -158,7 +158,7 @@ class MemoryInputStream : public InputStream
 
     void                    reset                   (void)                      { m_ptr = NULL; m_size = 0; m_ofs = 0; }
     void                    reset                   (const void* ptr, int size) { FW_ASSERT(size >= 0); FW_ASSERT(ptr || !size); m_ptr = (const U8*)ptr; m_size = size; m_ofs = 0; }
-    template <class T> void reset                   (const std::vector<T>& data)      { reset(data.getPtr(), data.getNumBytes()); }
+    template <class T> void reset                   (const std::vector<T>& data)      { reset((data.empty()) ? NULL : &data[0], (int)(data.size() * sizeof(T))); }
 
 private:
                             MemoryInputStream       (const MemoryInputStream&); // forbidden
@@ -232,6 +232,51 @@ inline OutputStream&    operator<<  (OutputStream& s, F64 v)        { s.writeU64
 inline OutputStream&    operator<<  (OutputStream& s, char v)       { s.writeU8(v); return s; }
 inline OutputStream&    operator<<  (OutputStream& s, bool v)       { s.writeU8((v) ? 1 : 0); return s; }
 
+//------------------------------------------------------------------------
+// Bulk transfer of trivially-copyable arrays.
+//------------------------------------------------------------------------
+
+#define FW_STREAM_ARRAY_TAG   0x31415246u // "FRA1", bump the digit on format change.
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#   define FW_STREAM_LITTLE_ENDIAN 0
+#else
+#   define FW_STREAM_LITTLE_ENDIAN 1
+#endif
+
+// Describes how T is laid out on the stream. 'size' is the serialized size
+// of one element (0 = variable), 'bulk' tells whether an array of T can be
+// transferred as raw memory. Flag additional types with FW_STREAM_POD().
+template <class T> struct StreamPOD                   { enum { size = 0, bulk = 0 }; };
+
+#define FW_STREAM_POD(T) \
+  template <> struct StreamPOD<T> { enum { size = sizeof(T), bulk = FW_STREAM_LITTLE_ENDIAN }; };
+
+FW_STREAM_POD(U8)
+FW_STREAM_POD(U16)
+FW_STREAM_POD(U32)
+FW_STREAM_POD(U64)
+FW_STREAM_POD(S8)
+FW_STREAM_POD(S16)
+FW_STREAM_POD(S32)
+FW_STREAM_POD(S64)
+FW_STREAM_POD(F32)
+FW_STREAM_POD(F64)
+FW_STREAM_POD(char)
+FW_STREAM_POD(Vec2i)
+FW_STREAM_POD(Vec3i)
+FW_STREAM_POD(Vec4i)
+FW_STREAM_POD(Vec2f)
+FW_STREAM_POD(Vec3f)
+FW_STREAM_POD(Vec4f)
+FW_STREAM_POD(Mat2f)
+FW_STREAM_POD(Mat3f)
+FW_STREAM_POD(Mat4f)
+
+// Raw transfers, split in chunks that fit the int-sized stream interface.
+void readArray  (InputStream& s, void* ptr, S64 size);
+void writeArray (OutputStream& s, const void* ptr, S64 size);
+
 //------------------------------------------------------------------------
 // Types defined or included by this header.
 //------------------------------------------------------------------------
@@ -252,12 +297,46 @@ inline OutputStream& operator<<(OutputStream& s, const Serializable& v)
 
 //------------------------------------------------------------------------
 
+// std::vector is stored as
+//
+//   U32 FW_STREAM_ARRAY_TAG, U32 element size (0 = element-wise), S64 count
+//
+// followed by the elements. Elements flagged as StreamPOD are transferred
+// with a single bulk read/write on little-endian hosts (their in-memory
+// image is the on-disk one); others go through their own operator>> / <<.
+//------------------------------------------------------------------------
+
 template <class T> InputStream& operator>>(InputStream& s, std::vector<T>& v)
 {
-  S32 len;
-  s >> len;
-  v.reset(len);
-  for (size_t i = 0u; i < len; ++i) {
+  U32 tag, elemSize;
+  S64 len;
+  s >> tag >> elemSize >> len;
+  
+  if (tag != FW_STREAM_ARRAY_TAG) {
+    fail("Stream: unsupported array header (0x%08x)!", tag);
+  }
+  if (len < 0) {
+    fail("Stream: invalid array length!");
+  }
+  
+  v.resize((size_t)len);
+
+  if (elemSize && StreamPOD<T>::bulk) 
+  {
+    if (elemSize != sizeof(T)) {
+      fail("Stream: array element size mismatch (%u vs %u)!", elemSize, (U32)sizeof(T));
+    }
+    if (len) {
+      readArray(s, &v[0], (S64)len * sizeof(T));
+    }
+    return s;
+  }
+  
+  if (elemSize && elemSize != StreamPOD<T>::size) {
+    fail("Stream: array element size mismatch (%u vs %u)!", elemSize, StreamPOD<T>::size);
+  }
+  
+  for (size_t i = 0u; i < v.size(); ++i) {
     s >> v[i];
   }
   return s;
@@ -267,8 +346,17 @@ template <class T> InputStream& operator>>(InputStream& s, std::vector<T>& v)
 
 template <class T> OutputStream& operator<<(OutputStream& s, const std::vector<T>& v)
 {
-  s << v.getSize();
-  for (size_t i = 0u; i < v.getSize(); ++i) {
+  s << (U32)FW_STREAM_ARRAY_TAG << (U32)StreamPOD<T>::size << (S64)v.size();
+
+  if (StreamPOD<T>::bulk) 
+  {
+    if (!v.empty()) {
+      writeArray(s, &v[0], (S64)v.size() * sizeof(T));
+    }
+    return s;
+  }
+  
+  for (size_t i = 0u; i < v.size(); ++i) {
     s << v[i];
   }
   return s;
@@ -281,13 +369,10 @@ inline InputStream& operator>>(InputStream& s, std::string& v)
   S32 len;
   s >> len;
   
-  std::vector<char> t(len + 1u);    
-  for (size_t i = 0u; i < len; ++i) {
-    s >> t[i];
+  v.resize(len);
+  if (len > 0) {
+    s.readFully(&v[0], len);
   }
-  t[len] = '\0';
-  
-  v = std::string(&t[0]);
   
   return s;
 }
@@ -297,9 +382,7 @@ inline InputStream& operator>>(InputStream& s, std::string& v)
 inline OutputStream& operator<<(OutputStream& s, const std::string& v)
 {
   s << (U32)(v.length());
-  for (size_t i = 0u; i < v.length(); ++i) {
-    s << v[i];
-  }
+  s.write(v.c_str(), (int)v.length());
   return s;
 }
 
@@ -3,6 +3,7 @@
 #include "SceneCR.hpp"
 
 #include <glsw/glsw.h>
+#include <cudaraster/MeshOptimizer.hpp>
 #include "App.hpp"
 #include "Data.hpp"
 #include "shader/PassThrough.hpp" // kernel shader
@@ -128,6 +129,10 @@ void SceneCR::initGeometry(const Data& data)
     id.y = data.indices[3*i+1];
     id.z = data.indices[3*i+2];
   }
+  
+  // Reorder for vertex fetch locality in triangle setup.
+  FW::MeshOptimizer::optimize( vertexIndexPtr, m_numTriangles, 
+                               inputVertexPtr, m_numVertices, sizeof(FW::InputVertex));
 }
 
 void SceneCR::initShader()
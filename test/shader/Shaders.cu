@@ -103,8 +103,8 @@ void FW::vertexShader_texPhong(const InputVertex* inPtr,
 
     out.clipPos         = c_constants.posToClip * Vec4f(in.modelPos, 1.0f);
     out.cameraPos       = c_constants.posToCamera * Vec4f(in.modelPos, 1.0f);
-    out.cameraNormal    = Vec4f(c_constants.normalToCamera * in.modelNormal, 0.0f);
-    out.texCoord        = Vec4f(in.texCoord, 0.0f, 1.0f);
+    encodeVertexAttrib(&out.cameraNormal, VertexFormat_SNorm10, Vec4f(normalize(c_constants.normalToCamera * in.modelNormal), 0.0f));
+    encodeVertexAttrib(out.texCoord, VertexFormat_F16x4, Vec4f(in.texCoord, 0.0f, 1.0f));
 }
 
 
@@ -151,21 +151,24 @@ class FragmentShader_texPhong : public FragmentShaderBase
     {
         // Interpolate attributes.
 
+        const int normalOfs = CR_VARYING_OFFSET(ShadedVertex_texPhong, cameraNormal);
+        const int texOfs    = CR_VARYING_OFFSET(ShadedVertex_texPhong, texCoord);
+
         Vec3f cameraPos = interpolateVarying(0, m_centroid).getXYZ();
-        Vec3f cameraNormal = interpolateVarying(1, m_centroid).getXYZ();
+        Vec3f cameraNormal = interpolateVarying(normalOfs, VertexFormat_SNorm10, m_centroid).getXYZ();
         Vec2f tex, texDX, texDY;
 
         if ((RENDER_MODE_FLAGS & RenderModeFlag_EnableQuads) == 0)
         {
           // Sample at pixel centroid, use analytical derivatives.
-          tex = interpolateVarying(2, m_centroid).getXY();
-          texDX = interpolateVarying(2, m_centroidDX).getXY();
-          texDY = interpolateVarying(2, m_centroidDY).getXY();
+          tex = interpolateVarying(texOfs, VertexFormat_F16x4, m_centroid).getXY();
+          texDX = interpolateVarying(texOfs, VertexFormat_F16x4, m_centroidDX).getXY();
+          texDY = interpolateVarying(texOfs, VertexFormat_F16x4, m_centroidDY).getXY();
         }
         else
         {
           // Sample at pixel center, use numerical derivatices.
-          tex = interpolateVarying(2, m_center).getXY();
+          tex = interpolateVarying(texOfs, VertexFormat_F16x4, m_center).getXY();
           texDX = dFdx(tex);
           texDY = dFdy(tex);
         }
@@ -86,8 +86,9 @@ typedef GouraudVertex ShadedVertex_gouraud;
 struct ShadedVertex_texPhong : ShadedVertexBase
 {
     Vec4f       cameraPos;      // Varying 0.
-    Vec4f       cameraNormal;   // Varying 1.
-    Vec4f       texCoord;       // Varying 2.
+    U32         cameraNormal;   // VertexFormat_SNorm10, normalized.
+    U32         texCoord[2];    // VertexFormat_F16x4.
+    U32         pad;
 };
 
 //------------------------------------------------------------------------